@@ -1,4 +1,5 @@
 #include <stdbool.h>
+#include <string.h>
 #include "../include/app.h"
 #include "../include/router/router_api.h"
 #include "../include/router/router_static.h"
@@ -28,6 +29,7 @@ int app_init(const struct app_mount *mounts, size_t mount_count){
     api_router_init(&api_router, "/api", route_table, MAX_ROUTES);
     if(api_router_add(&api_router, APP_GET,  "/echo", handle_route_echo)<0) return -1;
     if(api_router_add(&api_router, APP_POST, "/echo", handle_route_echo)<0) return -1;
+    if(api_router_add(&api_router, APP_GET,  "/count", handle_route_count)<0) return -1;
 
 
     /* #### STATIC ROUTERS #### */
@@ -69,13 +71,33 @@ int app_make_redirect(struct app_response *res, const char *location,
 }
 
 
+ssize_t app_request_read_body(const struct app_request *req, void *buf, size_t len){
+
+    if(!req || (!buf && len > 0)) return -1;
+    if(!req->body.read || len == 0) return 0;
+    return req->body.read(req->body.ctx, buf, len);
+}
+
+
+const char *app_request_param(const struct app_request *req, const char *name, size_t *len_out){
+
+    if(!req || !name) return NULL;
+    for(size_t i = 0; i < req->param_count; i++){
+        if(strcmp(req->params[i].name, name) != 0) continue;
+        if(len_out) *len_out = req->params[i].value_len;
+        return req->params[i].value;
+    }
+    return NULL;
+}
+
+
 int app_handle_client(const struct app_request *req, struct app_response *res){
 
     if(!req || !res) return -1;
 	if(!app_inited)  return -1;
 
 	struct redirect_result redirect_res = {0};
-	int redirect_ret = redirect_lookup(&redirects, req->path, &redirect_res);
+	int redirect_ret = redirect_lookup(&redirects, req->path, req->path_len, &redirect_res);
 	if (redirect_ret == 0){
     	return app_make_redirect(res, redirect_res.target, redirect_res.target_owned, redirect_res.type);
 	}
@@ -0,0 +1,163 @@
+/**
+ * @file crlf_scan_bench.c
+ * @brief Microbenchmark of request head framing.
+ *
+ * Compares the byte-at-a-time CRLF searches the parser used before
+ * (reproduced here) with @ref http_scan_cr and @ref http_head_scan:
+ *  - locating every line end of a complete head;
+ *  - finding the end of a head that arrives in small segments, where the
+ *    old search restarted at byte 0 after every read.
+ *
+ * Build and run with `make bench`.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "../include/http/http_scan.h"
+
+/** @brief Rounds of the line-splitting measurement. */
+#define BENCH_ROUNDS 200000
+
+/** @brief Rounds of the segmented-arrival measurement (the old search is quadratic). */
+#define BENCH_SEGMENT_ROUNDS 1000
+
+/** @brief Sink that keeps the compiler from dropping the measured work. */
+static volatile size_t bench_sink;
+
+
+/**
+ * @brief Previous CRLF search: compare every byte.
+ */
+static int old_find_crlf(const char *string, size_t len){
+	for(size_t i = 0; i + 1 < len; i++){
+		if(string[i]=='\r' && string[i+1]=='\n') return (int)i;
+	}
+	return -1;
+}
+
+
+/**
+ * @brief Previous head-end search: compare every byte, always from the start.
+ */
+static int old_find_double_crlf(const char *string, size_t len){
+	for(size_t i = 0; i + 3 < len; i++){
+		if(string[i]=='\r' && string[i+1]=='\n' && string[i+2]=='\r' && string[i+3]=='\n') return (int)i;
+	}
+	return -1;
+}
+
+
+/**
+ * @brief CRLF search on top of the vectorized CR scan.
+ */
+static int new_find_crlf(const char *string, size_t len){
+	size_t i = 0;
+	while(i + 1 < len){
+		i += http_scan_cr(string + i, len - i - 1);
+		if(i + 1 >= len) break;
+		if(string[i+1] == '\n') return (int)i;
+		i++;
+	}
+	return -1;
+}
+
+
+/**
+ * @brief CLOCK_MONOTONIC time in nanoseconds.
+ */
+static double now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+
+/**
+ * @brief Build a browser-like request head with @p extra headers of padding.
+ *
+ * @return Length of the head (including the final "\r\n\r\n").
+ */
+static size_t build_head(char *out, size_t cap, int extra){
+	size_t len = (size_t)snprintf(out, cap,
+		"GET /public/napoleon-cake.jpg?size=large&format=webp HTTP/1.1\r\n"
+		"Host: localhost:8080\r\n"
+		"User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+		"Accept: image/avif,image/webp,image/png,image/svg+xml,image/*;q=0.8,*/*;q=0.5\r\n"
+		"Accept-Language: en-US,en;q=0.5\r\n"
+		"Accept-Encoding: gzip, deflate, br, zstd\r\n"
+		"Referer: http://localhost:8080/public/index.html\r\n"
+		"Connection: keep-alive\r\n");
+	for(int i = 0; i < extra; i++){
+		len += (size_t)snprintf(out + len, cap - len,
+			"X-Padding-%02d: 0123456789abcdef0123456789abcdef0123456789abcdef\r\n", i);
+	}
+	len += (size_t)snprintf(out + len, cap - len, "\r\n");
+	return len;
+}
+
+
+/**
+ * @brief Time splitting a complete head into lines.
+ */
+static void bench_lines(const char *head, size_t len){
+	int (*const impls[])(const char *, size_t) = { old_find_crlf, new_find_crlf };
+	const char *const names[] = { "byte loop", "http_scan_cr" };
+
+	for(int k = 0; k < 2; k++){
+		double start = now_ns();
+		for(int r = 0; r < BENCH_ROUNDS; r++){
+			size_t pos = 0;
+			int idx;
+			while((idx = impls[k](head + pos, len - pos)) >= 0) pos += (size_t)idx + 2;
+			bench_sink += pos;
+		}
+		printf("  all line ends, %-13s %8.1f ns/head\n", names[k], (now_ns() - start) / BENCH_ROUNDS);
+	}
+}
+
+
+/**
+ * @brief Time locating the head end when it arrives @p segment bytes at a time.
+ */
+static void bench_segments(const char *head, size_t len, size_t segment){
+	double start = now_ns();
+	for(int r = 0; r < BENCH_SEGMENT_ROUNDS; r++){
+		int idx = -1;
+		for(size_t have = segment; idx < 0; have += segment){
+			idx = old_find_double_crlf(head, have < len ? have : len);
+		}
+		bench_sink += (size_t)idx;
+	}
+	double old_ns = (now_ns() - start) / BENCH_SEGMENT_ROUNDS;
+
+	start = now_ns();
+	for(int r = 0; r < BENCH_SEGMENT_ROUNDS; r++){
+		struct http_head_scan scan;
+		http_head_scan_reset(&scan);
+		int idx = -1;
+		for(size_t have = segment; idx < 0; have += segment){
+			idx = http_head_scan(&scan, head, have < len ? have : len);
+		}
+		bench_sink += (size_t)idx;
+	}
+	double new_ns = (now_ns() - start) / BENCH_SEGMENT_ROUNDS;
+
+	printf("  %4zu-byte reads, rescan %10.1f ns/head, resumed %8.1f ns/head\n", segment, old_ns, new_ns);
+}
+
+
+int main(void){
+	static char head[16384];
+	const int paddings[] = { 0, 24 };
+
+	printf("http_scan_cr implementation: %s\n", http_scan_impl());
+	for(size_t i = 0; i < sizeof(paddings) / sizeof(paddings[0]); i++){
+		size_t len = build_head(head, sizeof(head), paddings[i]);
+		printf("\nhead of %zu bytes\n", len);
+		bench_lines(head, len);
+		bench_segments(head, len, 1);
+		bench_segments(head, len, 16);
+		bench_segments(head, len, 256);
+	}
+	return 0;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file output_policy_bench.c
+ * @brief Packets per response under each output policy.
+ *
+ * Starts the server once per @ref http_output_policy ("immediate" is the
+ * behaviour before policies existed) and fetches a few targets over one
+ * keep-alive connection, one request at a time. The data segments the
+ * client received (TCP_INFO) divided by the responses is the number of
+ * packets a response took:
+ *  - a small static file (head written, body sent with sendfile);
+ *  - a large static file (several segments in any case);
+ *  - a small API response (head and body in one write).
+ *
+ * Loopback has a large MSS, so every extra packet comes from how the
+ * response was written, not from its size. Build and run with
+ * `make bench-output` (uses the debug server binary, from the repository root).
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <linux/tcp.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+/** @brief Requests per target (below the keep-alive request limit). */
+#define BENCH_REQUESTS 90
+
+/** @brief Port the server is started on. */
+#define BENCH_PORT 3091
+
+/** @brief Receive buffer for one response (large enough for any of the targets' heads). */
+#define BENCH_BUFFER 65536
+
+
+/** @brief Targets fetched under every policy. */
+static const char *const bench_targets[] = {
+	"/public/index.html",
+	"/public/napoleon-cake.jpg",
+	"/api/echo"
+};
+
+/** @brief Policies compared, as named on the server command line. */
+static const char *const bench_policies[] = { "immediate", "more", "cork" };
+
+
+/**
+ * @brief Connect to the benchmark port, retrying while the server starts.
+ *
+ * @return Connected socket, or -1.
+ */
+static int bench_connect(void){
+	struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(BENCH_PORT) };
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	for(int attempt = 0; attempt < 100; attempt++){
+		int fd = socket(AF_INET, SOCK_STREAM, 0);
+		if(fd < 0) return -1;
+		if(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0){
+			int one = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+			return fd;
+		}
+		close(fd);
+		usleep(20000);
+	}
+	return -1;
+}
+
+
+/**
+ * @brief Data segments received on @p fd so far.
+ */
+static long bench_segments(int fd){
+	struct tcp_info info;
+	socklen_t len = sizeof(info);
+	if(getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) < 0) return -1;
+	return (long)info.tcpi_data_segs_in;
+}
+
+
+/**
+ * @brief Send one GET for @p target and read its complete response.
+ *
+ * @return 0 on success, -1 on a short or malformed response.
+ */
+static int bench_fetch(int fd, const char *target, char *buf){
+	char req[256];
+	int req_len = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", target);
+	if(write(fd, req, (size_t)req_len) != req_len) return -1;
+
+	size_t have = 0;
+	char *head_end = NULL;
+	while(!head_end){
+		ssize_t n = read(fd, buf + have, BENCH_BUFFER - 1 - have);
+		if(n <= 0) return -1;
+		have += (size_t)n;
+		buf[have] = '\0';
+		head_end = strstr(buf, "\r\n\r\n");
+		if(!head_end && have == BENCH_BUFFER - 1) return -1;
+	}
+
+	const char *cl = strstr(buf, "Content-Length: ");
+	if(!cl || cl > head_end) return -1;
+	size_t total = (size_t)(head_end + 4 - buf) + strtoul(cl + 16, NULL, 10);
+
+	while(have < total){
+		size_t want = total - have < BENCH_BUFFER ? total - have : BENCH_BUFFER;
+		ssize_t n = read(fd, buf, want);
+		if(n <= 0) return -1;
+		have += (size_t)n;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Start the server with @p policy, measure every target and stop it.
+ *
+ * @return 0 on success, -1 if the server could not be run or a request failed.
+ */
+static int bench_policy(const char *server, const char *policy, char *buf){
+	char port[16];
+	snprintf(port, sizeof(port), "%d", BENCH_PORT);
+
+	fflush(stdout);
+	pid_t pid = fork();
+	if(pid < 0) return -1;
+	if(pid == 0){
+		freopen("/dev/null", "w", stdout);
+		execl(server, server, port, "1", "epoll", "default", policy, (char*)NULL);
+		_exit(127);
+	}
+
+	int ret = 0;
+	printf("%-10s", policy);
+	for(size_t t = 0; t < sizeof(bench_targets) / sizeof(bench_targets[0]); t++){
+		int fd = bench_connect();
+		if(fd < 0){
+			ret = -1;
+			break;
+		}
+
+		long before = bench_segments(fd);
+		for(int i = 0; i < BENCH_REQUESTS && ret == 0; i++) ret = bench_fetch(fd, bench_targets[t], buf);
+		long after = bench_segments(fd);
+		close(fd);
+		if(ret < 0) break;
+
+		printf("  %-26s %6.2f", bench_targets[t], (double)(after - before) / BENCH_REQUESTS);
+	}
+	printf("\n");
+
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+	return ret;
+}
+
+
+int main(int argc, char **argv){
+	if(argc != 2){
+		fprintf(stderr, "Usage: %s <server binary>\n", argv[0]);
+		return 1;
+	}
+
+	static char buf[BENCH_BUFFER];
+	printf("packets per response (%d sequential keep-alive requests per target)\n", BENCH_REQUESTS);
+	for(size_t p = 0; p < sizeof(bench_policies) / sizeof(bench_policies[0]); p++){
+		if(bench_policy(argv[1], bench_policies[p], buf) < 0){
+			fprintf(stderr, "%s: server or request failed\n", bench_policies[p]);
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -97,7 +97,7 @@ static ssize_t write_all(int fd, const void *buffer, size_t len){
 
 static int app_handler(const struct app_request *req, struct app_response *res) {
     struct redirect_result redirect_res = {0};
-    int redirect_ret = redirect_lookup(&redirects, req->path, &redirect_res);
+    int redirect_ret = redirect_lookup(&redirects, req->path, req->path_len, &redirect_res);
     if (redirect_ret == 0) return app_make_redirect(res, redirect_res.target, redirect_res.target_owned, redirect_res.type);
     if (redirect_ret < 0) return -1;
 
@@ -156,6 +156,7 @@ int main(){
 	api_router_init(&api_router, "/api", routes, MAX_ROUTES);
 	api_router_add(&api_router, APP_GET,  "/echo", handle_route_echo);
 	api_router_add(&api_router, APP_POST, "/echo", handle_route_echo);
+	api_router_add(&api_router, APP_GET,  "/count", handle_route_count);
 
 	static_router_init(&static_routers[0], "/public", &vfs_public, "index.html", 500*1024);
 	static_router_init(&static_routers[1], "/docs",   &vfs_docs,   "index.html", 500*1024);
@@ -0,0 +1,449 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+
+#include "../../include/http/http_parser.h"
+#include "../../include/http/http_request.h"
+#include "../../include/http/http_limits.h"
+#include "../../include/reader.h"
+
+/**
+ * @brief Push parser harness.
+ *
+ * Drives @ref http_parser_feed over a byte stream the way the connection
+ * core does: bytes are appended to a growing buffer, the parser is fed until
+ * it needs more, chunk framing is compacted away, decoded body pieces are
+ * held behind the head and dropped in batches, and complete messages are
+ * dropped from the front (pipelining). The stream is fed whole, split at
+ * every offset and one byte at a time, with bodies dropped piece by piece or
+ * held whole; every run must yield exactly the result of the single feed,
+ * decoded bodies included. A split inside a pipelined head makes that head
+ * cross a compact/refill boundary, and the small initial buffer moves the
+ * request views mid-head (@ref http_request_rebase).
+ */
+
+
+/**
+ * @def FEED_SPLIT_MAX
+ * @brief Longest input split at every offset; longer ones are split at a stride.
+ */
+#define FEED_SPLIT_MAX 2048
+
+/**
+ * @def FEED_TRICKLE_MAX
+ * @brief Longest input also fed one byte at a time.
+ */
+#define FEED_TRICKLE_MAX 1024
+
+/**
+ * @def FEED_INITIAL_BUFFER
+ * @brief Initial size of the feed buffer; small so that heads outgrow it.
+ */
+#define FEED_INITIAL_BUFFER 64
+
+/**
+ * @def FEED_BODY_KEEP
+ * @brief Decoded body bytes kept verbatim for the known cases (the rest only enters the digest).
+ */
+#define FEED_BODY_KEEP 256
+
+/**
+ * @def FEED_HOLD
+ * @brief Body bytes held before they are dropped in the split runs.
+ */
+#define FEED_HOLD 16
+
+
+/**
+ * @struct feed_result
+ * @brief Everything one run observed, reduced to what must not depend on the split.
+ */
+struct feed_result {
+	int      status;	/**< HTTP_PARSE_ERROR, or HTTP_PARSE_NEED_MORE once the input ran out. */
+	unsigned messages;	/**< Messages completed. */
+	uint64_t digest;	/**< FNV-1a over the parsed heads and decoded bodies, in order. */
+	size_t   body_len;	/**< Decoded body bytes of all messages. */
+	char     body[FEED_BODY_KEEP]; /**< First decoded body bytes. */
+};
+
+
+static void digest_bytes(uint64_t *hash, const void *data, size_t len){
+	const uint8_t *p = (const uint8_t*)data;
+	for(size_t i = 0; i < len; i++){
+		*hash ^= p[i];
+		*hash *= 1099511628211ULL;
+	}
+}
+
+
+static void digest_value(uint64_t *hash, uint64_t value){
+	digest_bytes(hash, &value, sizeof(value));
+}
+
+
+static void digest_string(uint64_t *hash, const char *s, size_t len){
+	digest_value(hash, s ? len : UINT64_MAX);
+	if(s) digest_bytes(hash, s, len);
+}
+
+
+static void digest_head(uint64_t *hash, const struct http_request *req, const struct http_parser *parser){
+	digest_string(hash, req->method, req->method_len);
+	digest_string(hash, req->path, req->path_len);
+	digest_string(hash, req->version, req->version_len);
+	digest_value(hash, (uint64_t)req->method_id);
+	digest_value(hash, (uint64_t)req->version_id);
+	digest_value(hash, req->param_count);
+	for(size_t i = 0; i < req->param_count; i++){
+		digest_string(hash, req->params[i].name, req->params[i].name_len);
+		digest_string(hash, req->params[i].value, req->params[i].value_len);
+	}
+	digest_value(hash, req->num_headers);
+	for(size_t i = 0; i < req->num_headers; i++){
+		digest_string(hash, req->headers[i].name, strlen(req->headers[i].name));
+		digest_string(hash, req->headers[i].value, strlen(req->headers[i].value));
+	}
+	digest_value(hash, parser->head_len);
+	digest_value(hash, parser->content_len);
+	digest_value(hash, parser->chunked);
+}
+
+
+/**
+ * @brief Take the decoded body bytes held behind the head and drop them from @p buffer.
+ */
+static void feed_take_body(struct http_parser *parser, char *buffer, size_t *len, struct feed_result *out){
+	const char *body = buffer + parser->head_len;
+	size_t held = parser->body_held;
+	digest_bytes(&out->digest, body, held);
+	if(out->body_len < FEED_BODY_KEEP){
+		size_t keep = FEED_BODY_KEEP - out->body_len < held ? FEED_BODY_KEEP - out->body_len : held;
+		memcpy(out->body + out->body_len, body, keep);
+	}
+	out->body_len += held;
+	http_parser_discard_body(parser, buffer, len);
+}
+
+
+/**
+ * @brief Feed @p data in segments: @p first bytes, then @p step bytes at a time.
+ *
+ * @param hold  Body bytes to let pile up behind the head before they are taken
+ *              (0 → every piece right away, SIZE_MAX → the whole body at the end);
+ *              whatever is still held when the input ends or fails is taken too.
+ *
+ * @return 0 on success, -1 on allocation failure.
+ */
+static int feed_run(const uint8_t *data, size_t size, size_t first, size_t step, size_t hold,
+					struct feed_result *out){
+	const struct http_limits *limits = http_limits_profile_get(HTTP_LIMITS_DEFAULT);
+	struct http_parser parser;
+	struct http_request req;
+	http_parser_init(&parser, limits);
+	http_request_init(&req);
+	*out = (struct feed_result){ .status = HTTP_PARSE_NEED_MORE, .digest = 14695981039346656037ULL };
+
+	char *buffer = malloc(FEED_INITIAL_BUFFER);
+	if(!buffer) return -1;
+	size_t cap = FEED_INITIAL_BUFFER;
+	size_t len = 0;
+	size_t pos = 0;
+
+	while(pos < size){
+		size_t seg = pos == 0 ? first : step;
+		if(seg > size - pos) seg = size - pos;
+
+		if(len + seg > cap){
+			size_t new_cap = cap;
+			while(new_cap < len + seg) new_cap *= 2;
+			uintptr_t old_base = (uintptr_t)buffer;
+			char *tmp = realloc(buffer, new_cap);
+			if(!tmp){
+				http_request_clear(&req);
+				free(buffer);
+				return -1;
+			}
+			if((uintptr_t)tmp != old_base) http_request_rebase(&req, old_base, tmp);
+			buffer = tmp;
+			cap = new_cap;
+		}
+		memcpy(buffer + len, data + pos, seg);
+		len += seg;
+		pos += seg;
+
+		int more = 0;
+		while(!more){
+			switch(http_parser_feed(&parser, buffer, len, &req)){
+				case HTTP_PARSE_HEADERS_DONE:
+					digest_head(&out->digest, &req, &parser);
+					break;
+				case HTTP_PARSE_BODY_CHUNK:
+					if(parser.body_held >= hold) feed_take_body(&parser, buffer, &len, out);
+					break;
+				case HTTP_PARSE_DONE: {
+					feed_take_body(&parser, buffer, &len, out);
+					out->messages++;
+					digest_value(&out->digest, out->messages);
+					size_t end = parser.consumed < len ? parser.consumed : len;
+					memmove(buffer, buffer + end, len - end);
+					len -= end;
+					http_request_clear(&req);
+					http_request_init(&req);
+					http_parser_init(&parser, limits);
+					break;
+				}
+				case HTTP_PARSE_NEED_MORE:
+					http_parser_compact(&parser, buffer, &len);
+					more = 1;
+					break;
+				default:
+					out->status = HTTP_PARSE_ERROR;
+					if(parser.body_held) feed_take_body(&parser, buffer, &len, out);
+					http_request_clear(&req);
+					free(buffer);
+					return 0;
+			}
+		}
+	}
+
+	if(parser.body_held) feed_take_body(&parser, buffer, &len, out);
+	http_request_clear(&req);
+	free(buffer);
+	return 0;
+}
+
+
+static int feed_same(const struct feed_result *a, const struct feed_result *b){
+	return a->status == b->status && a->messages == b->messages && a->digest == b->digest
+		&& a->body_len == b->body_len;
+}
+
+
+/**
+ * @brief Feed @p data whole, split at every offset and byte by byte; abort on any difference.
+ *
+ * The single feed takes body pieces right away and is also checked against
+ * holding each body whole; the split runs alternate between both and
+ * batches of @ref FEED_HOLD bytes.
+ *
+ * @param result  [out] Result of the single feed (may be NULL).
+ */
+static void feed_check(const uint8_t *data, size_t size, struct feed_result *result){
+	static const size_t holds[] = { 0, FEED_HOLD, SIZE_MAX };
+	struct feed_result whole, split;
+	if(feed_run(data, size, size, size, 0, &whole) < 0) return;
+	if(feed_run(data, size, size, size, SIZE_MAX, &split) < 0) return;
+	if(!feed_same(&whole, &split)){
+		fprintf(stderr, "feed: holding the body differs\n");
+		abort();
+	}
+
+	size_t stride = size > FEED_SPLIT_MAX ? size / FEED_SPLIT_MAX + 1 : 1;
+	for(size_t k = 1; k < size; k += stride){
+		if(feed_run(data, size, k, size, holds[k % 3], &split) < 0) return;
+		if(!feed_same(&whole, &split)){
+			fprintf(stderr, "feed: split at %zu differs (status %d/%d, messages %u/%u, body %zu/%zu)\n",
+					k, whole.status, split.status, whole.messages, split.messages, whole.body_len, split.body_len);
+			abort();
+		}
+	}
+	if(size <= FEED_TRICKLE_MAX){
+		if(feed_run(data, size, 1, 1, FEED_HOLD, &split) < 0) return;
+		if(!feed_same(&whole, &split)){
+			fprintf(stderr, "feed: byte-by-byte feed differs\n");
+			abort();
+		}
+	}
+	if(result) *result = whole;
+}
+
+
+/**
+ * @struct feed_case
+ * @brief Input with a known outcome.
+ */
+struct feed_case {
+	const char *name;
+	const char *input;
+	int 		status;		/**< Expected @ref feed_result::status. */
+	unsigned 	messages;	/**< Expected @ref feed_result::messages. */
+	const char *body;		/**< Expected decoded bodies, concatenated (NULL → not checked). */
+};
+
+
+static const struct feed_case feed_cases[] = {
+	{ "get", "GET / HTTP/1.1\r\nHost: x\r\n\r\n", HTTP_PARSE_NEED_MORE, 1, NULL },
+	{ "partial head", "GET / HTTP/1.1\r\nHost: x\r\n", HTTP_PARSE_NEED_MORE, 0, NULL },
+	{ "pipelined heads",
+	  "GET /a?x=1&y HTTP/1.1\r\nHost: x\r\n\r\nGET /b HTTP/1.1\r\nHost: x\r\nAccept: */*\r\n\r\n",
+	  HTTP_PARSE_NEED_MORE, 2, NULL },
+	{ "head behind a body",
+	  "POST /a HTTP/1.1\r\nContent-Length: 5\r\n\r\nhelloGET /b HTTP/1.1\r\nHost: x\r\n\r\n",
+	  HTTP_PARSE_NEED_MORE, 2, NULL },
+	{ "head behind a compacted chunked body",
+	  "POST /a HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n2\r\nde\r\n0\r\n\r\n"
+	  "GET /b HTTP/1.1\r\nHost: x\r\n\r\n",
+	  HTTP_PARSE_NEED_MORE, 2, NULL },
+	{ "head beyond the initial buffer",
+	  "GET /a/rather/long/path/that/does/not/fit HTTP/1.1\r\nHost: example.org\r\n"
+	  "User-Agent: feed-harness\r\nAccept: text/plain\r\nX-Padding: 0123456789abcdef0123456789\r\n\r\n",
+	  HTTP_PARSE_NEED_MORE, 1, NULL },
+	{ "bare LF is no head end", "GET / HTTP/1.1\nHost: x\n\n", HTTP_PARSE_NEED_MORE, 0, NULL },
+	{ "malformed line", "GET\r\n\r\n", HTTP_PARSE_ERROR, 0, NULL },
+	{ "malformed after pipelined", "GET / HTTP/1.1\r\n\r\nBAD\r\n\r\n", HTTP_PARSE_ERROR, 1, NULL },
+
+	/* Chunked decoding; the split runs cut every size line and CRLF. */
+	{ "chunked",
+	  "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n10\r\n0123456789abcdef\r\n0\r\n\r\n",
+	  HTTP_PARSE_NEED_MORE, 1, "abc0123456789abcdef" },
+	{ "chunked upper-case hex and leading zeros",
+	  "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n000A\r\n0123456789\r\n0\r\n\r\n",
+	  HTTP_PARSE_NEED_MORE, 1, "0123456789" },
+	{ "chunk extensions",
+	  "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3;name=value\r\nabc\r\n2 ;x\r\nde\r\n0;last\r\n\r\n",
+	  HTTP_PARSE_NEED_MORE, 1, "abcde" },
+	{ "trailers",
+	  "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n0\r\nExpires: never\r\nX-Sum: 1\r\n\r\n"
+	  "GET /next HTTP/1.1\r\n\r\n",
+	  HTTP_PARSE_NEED_MORE, 2, "abc" },
+	{ "chunked body not finished", "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nabc",
+	  HTTP_PARSE_NEED_MORE, 0, NULL },
+	{ "chunk without size", "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n\r\nabc\r\n0\r\n\r\n",
+	  HTTP_PARSE_ERROR, 0, NULL },
+	{ "chunk size not hex", "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nxyz\r\nabc\r\n0\r\n\r\n",
+	  HTTP_PARSE_ERROR, 0, NULL },
+	{ "chunk data without CRLF", "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabcX\r\n0\r\n\r\n",
+	  HTTP_PARSE_ERROR, 0, NULL },
+	{ "chunk size beyond the body limit",
+	  "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nfffffffff\r\nabc\r\n",
+	  HTTP_PARSE_ERROR, 0, NULL },
+	{ "chunk size overflowing",
+	  "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n10000000000000000\r\nabc\r\n",
+	  HTTP_PARSE_ERROR, 0, NULL },
+	{ "chunk size line too long",
+	  "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3;"
+	  "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
+	  "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
+	  "\r\nabc\r\n0\r\n\r\n",
+	  HTTP_PARSE_ERROR, 0, NULL },
+
+	/* Content-Length and Transfer-Encoding selection. */
+	{ "content-length", "POST / HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello", HTTP_PARSE_NEED_MORE, 1, "hello" },
+	{ "identical content-lengths", "POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 5\r\n\r\nhello",
+	  HTTP_PARSE_NEED_MORE, 1, "hello" },
+	{ "conflicting content-lengths", "POST / HTTP/1.1\r\nContent-Length: 5\r\nContent-Length: 6\r\n\r\nhello!",
+	  HTTP_PARSE_ERROR, 0, NULL },
+	{ "content-length list", "POST / HTTP/1.1\r\nContent-Length: 5, 5\r\n\r\nhello", HTTP_PARSE_ERROR, 0, NULL },
+	{ "signed content-length", "POST / HTTP/1.1\r\nContent-Length: +5\r\n\r\nhello", HTTP_PARSE_ERROR, 0, NULL },
+	{ "overflowing content-length", "POST / HTTP/1.1\r\nContent-Length: 99999999999999999999999\r\n\r\n",
+	  HTTP_PARSE_ERROR, 0, NULL },
+	{ "transfer-encoding with content-length",
+	  "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nContent-Length: 3\r\n\r\n3\r\nabc\r\n0\r\n\r\n",
+	  HTTP_PARSE_ERROR, 0, NULL },
+	{ "content-length with transfer-encoding",
+	  "POST / HTTP/1.1\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n0\r\n\r\n",
+	  HTTP_PARSE_ERROR, 0, NULL },
+	{ "transfer-encoding on HTTP/1.0",
+	  "POST / HTTP/1.0\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n0\r\n\r\n",
+	  HTTP_PARSE_ERROR, 0, NULL },
+	{ "chunked not the last coding",
+	  "POST / HTTP/1.1\r\nTransfer-Encoding: chunked, gzip\r\n\r\n3\r\nabc\r\n0\r\n\r\n",
+	  HTTP_PARSE_ERROR, 0, NULL },
+	{ "unknown coding only", "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\nabc", HTTP_PARSE_ERROR, 0, NULL },
+};
+
+
+/**
+ * @brief Run @ref feed_cases through @ref feed_check; abort if one ends unexpectedly.
+ */
+static void feed_self_test(void){
+	for(size_t i = 0; i < sizeof(feed_cases) / sizeof(feed_cases[0]); i++){
+		const struct feed_case *c = &feed_cases[i];
+		struct feed_result result = { .status = INT_MIN };
+		feed_check((const uint8_t*)c->input, strlen(c->input), &result);
+		if(result.status != c->status || result.messages != c->messages){
+			fprintf(stderr, "feed case \"%s\": status %d, messages %u (expected %d, %u)\n",
+					c->name, result.status, result.messages, c->status, c->messages);
+			abort();
+		}
+		if(c->body && (result.body_len != strlen(c->body) || memcmp(result.body, c->body, result.body_len) != 0)){
+			fprintf(stderr, "feed case \"%s\": body of %zu bytes differs\n", c->name, result.body_len);
+			abort();
+		}
+	}
+}
+
+
+static int read_all_from_stdin(uint8_t **buffer_out, size_t *buff_out_len){
+	const size_t chunk_size = 2048;
+	uint8_t *buffer = NULL;
+	size_t limit = chunk_size;
+	size_t total_read = 0;
+	uint8_t tmp[chunk_size];
+
+	while(1){
+		ssize_t curr_read = read_some(STDIN_FILENO, tmp, chunk_size);
+		if(curr_read < 0){
+			free(buffer);
+			return -1;
+		}
+		if(curr_read == 0) break;
+
+		if(buffer == NULL){
+			buffer = calloc(1, limit);
+			if(!buffer) return -1;
+		}
+		if(total_read + (size_t)curr_read > limit){
+			while(limit < total_read + (size_t)curr_read){
+				if(limit > SIZE_MAX / 2){
+					free(buffer);
+					return -1;
+				}
+				limit *= 2;
+			}
+			uint8_t *new_buffer = realloc(buffer, limit);
+			if(!new_buffer){
+				free(buffer);
+				return -1;
+			}
+			buffer = new_buffer;
+		}
+		memcpy(buffer + total_read, tmp, (size_t)curr_read);
+		total_read += (size_t)curr_read;
+	}
+	*buffer_out = buffer; *buff_out_len = total_read;
+	return 0;
+}
+
+
+static void fuzz(const uint8_t *data, size_t size){
+	if(!data || size == 0) return;
+	feed_check(data, size, NULL);
+}
+
+
+#ifdef __AFL_HAVE_MANUAL_CONTROL
+int main(void) {
+	feed_self_test();
+	__AFL_FUZZ_INIT();
+
+	while (__AFL_LOOP(1000)) {
+		uint8_t *buf = __AFL_FUZZ_TESTCASE_BUF;
+		size_t   len = (size_t)__AFL_FUZZ_TESTCASE_LEN;
+		if (len > 0) fuzz(buf, len);
+	}
+	return 0;
+}
+#else
+int main(void) {
+	feed_self_test();
+	uint8_t *data = NULL;
+	size_t   size = 0;
+	if (read_all_from_stdin(&data, &size) != 0) return 1;
+	fuzz(data, size);
+	free(data);
+	return 0;
+}
+#endif
@@ -0,0 +1,172 @@
+#ifndef ACCESS_LOG_H
+#define ACCESS_LOG_H
+
+/**
+ * @file access_log.h
+ * @brief Asynchronous access log.
+ *
+ * Request and connection events are logged as fixed-size binary records.
+ * Every producing thread owns a single-producer/single-consumer ring, so
+ * logging takes no lock and makes no system call: the producer copies a
+ * record into its ring and publishes it with one atomic store. A background
+ * thread collects the records of all rings, formats them as text and writes
+ * them in batches.
+ *
+ * Volume is controlled at the producer, before a record is even built:
+ *  - records below the configured level are skipped;
+ *  - of the INFO and DEBUG records, only one in @ref access_log_config::sample_every
+ *    is kept per thread (WARN and ERROR are never sampled).
+ *
+ * If a ring is full the record is dropped and counted; the writer reports
+ * the number of lost records with the next batch. The log never blocks a
+ * worker.
+ *
+ * Until @ref access_log_start is called, nothing is logged.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct sockaddr_in;
+
+
+/**
+ * @def ACCESS_LOG_METHOD_MAX
+ * @brief Bytes kept of the request method (including the terminator).
+ */
+#define ACCESS_LOG_METHOD_MAX 8
+
+/**
+ * @def ACCESS_LOG_PATH_MAX
+ * @brief Bytes kept of the request path (including the terminator); longer paths are truncated.
+ */
+#define ACCESS_LOG_PATH_MAX 64
+
+/**
+ * @def ACCESS_LOG_BYTES_UNKNOWN
+ * @brief @ref access_log_record::bytes of a body whose length is not known when the request is logged (printed as "-").
+ */
+#define ACCESS_LOG_BYTES_UNKNOWN UINT64_MAX
+
+
+/**
+ * @enum access_log_level
+ * @brief Severity of a record; lower values are more severe.
+ */
+enum access_log_level {
+    ACCESS_LOG_ERROR = 0,  /**< Failures. */
+    ACCESS_LOG_WARN  = 1,  /**< Refused connections, 5xx responses. */
+    ACCESS_LOG_INFO  = 2,  /**< Served requests. */
+    ACCESS_LOG_DEBUG = 3   /**< Connection events. */
+};
+
+
+/**
+ * @enum access_log_event
+ * @brief What a record describes.
+ */
+enum access_log_event {
+    ACCESS_LOG_REQUEST = 0,  /**< A request was answered. */
+    ACCESS_LOG_ACCEPT  = 1,  /**< A connection was accepted. */
+    ACCESS_LOG_REFUSE  = 2   /**< A connection was refused under overload. */
+};
+
+
+/**
+ * @struct access_log_record
+ * @brief One log entry, copied as a whole into the ring.
+ *
+ * Fields that do not apply to the event are zero.
+ */
+struct access_log_record {
+    int64_t  time_ms;                       /**< Wall-clock time (ms since the epoch, filled in on submit). */
+    uint64_t bytes;                         /**< Response body length (@ref ACCESS_LOG_BYTES_UNKNOWN for a generated body). */
+    uint32_t duration_us;                   /**< Time spent producing the response. */
+    uint32_t addr;                          /**< Peer IPv4 address (network byte order, 0 → unknown). */
+    uint16_t port;                          /**< Peer port (host byte order). */
+    uint16_t status;                        /**< Response status code. */
+    uint8_t  event;                         /**< @ref access_log_event */
+    uint8_t  level;                         /**< @ref access_log_level */
+    char     method[ACCESS_LOG_METHOD_MAX]; /**< Request method, NUL-terminated. */
+    char     path[ACCESS_LOG_PATH_MAX];     /**< Request path, NUL-terminated. */
+};
+
+
+/**
+ * @struct access_log_config
+ * @brief Settings of the access log.
+ */
+struct access_log_config {
+    int                   fd;                 /**< Destination (e.g. STDOUT_FILENO); not closed by the log. */
+    enum access_log_level level;              /**< Most verbose level that is logged. */
+    unsigned              sample_every;       /**< Keep one in this many INFO/DEBUG records (0 or 1 → all). */
+    unsigned              flush_interval_ms;  /**< Longest time a record waits before it is written (0 → 100 ms). */
+};
+
+
+/**
+ * @brief Start the writer thread.
+ *
+ * @param config  Settings (must not be NULL).
+ *
+ * @return 0 on success, -1 if the log is already running or the thread could not be started.
+ */
+int access_log_start(const struct access_log_config *config);
+
+
+/**
+ * @brief Write every pending record and stop the writer thread.
+ *
+ * Producers must not log concurrently; records submitted afterwards are discarded.
+ */
+void access_log_stop(void);
+
+
+/**
+ * @brief Decide whether a record of @p level is to be logged by the calling thread.
+ *
+ * Cheap enough to call before every potential record: a level check and,
+ * for sampled levels, a thread-local counter. Callers only build and submit
+ * the record if it returns true.
+ */
+bool access_log_sample(enum access_log_level level);
+
+
+/**
+ * @brief Whether records of @p level pass the level filter at all (no sampling).
+ *
+ * Lets a producer skip work that only logging needs, e.g. looking up a
+ * peer address once per connection.
+ */
+bool access_log_enabled(enum access_log_level level);
+
+
+/**
+ * @brief Queue a record for the writer thread.
+ *
+ * Never blocks. Drops the record if the calling thread's ring is full.
+ *
+ * @param record  Record to copy; @ref access_log_record::time_ms is set here.
+ */
+void access_log_submit(struct access_log_record *record);
+
+
+/**
+ * @brief Queue a connection event with its peer address.
+ *
+ * Like @ref access_log_submit, the caller decides with @ref access_log_sample
+ * whether to log the event at all.
+ *
+ * @param event  @ref ACCESS_LOG_ACCEPT or @ref ACCESS_LOG_REFUSE.
+ * @param level  Level of the record.
+ * @param peer   Peer address (may be NULL if unknown).
+ */
+void access_log_conn(enum access_log_event event, enum access_log_level level, const struct sockaddr_in *peer);
+
+
+/**
+ * @brief Current CLOCK_MONOTONIC time in microseconds, for @ref access_log_record::duration_us.
+ */
+uint64_t access_log_clock_us(void);
+
+#endif /* ACCESS_LOG_H */
@@ -26,6 +26,14 @@ struct app_adapter_ctx {
  * then converts the @ref app_response to an @ref http_response. Ownership of any
  * heap-allocated payload is respected via @ref app_response->payload_owned.
  *
+ * Request payload: @ref app_request::payload is the complete body if it had
+ * arrived before dispatch (@ref app_request::payload_len is its length);
+ * otherwise payload == NULL and payload_len == 0, never the announced length.
+ * @ref app_request::body reads what has arrived without blocking and returns
+ * @ref APP_BODY_PENDING after that. An @ref app_response::consumer becomes
+ * the @ref http_response::sink the core feeds the rest of the body to; its
+ * finish callback is converted like a handler's response.
+ *
  * @param req  				Parsed HTTP request (not owned by adapter).
  * @param res_out  			Response to be sent by the core (filled here).
  * @param adapter_context   Pointer to @ref app_adapter_ctx.
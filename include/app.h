@@ -3,6 +3,8 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
 #include "./redirect/redirect_types.h"
 
 /**
@@ -40,6 +42,12 @@
 struct fs;
 
 
+/**
+ * @brief Opaque open file of a virtual filesystem (see @ref filesystem.h).
+ */
+struct fs_file;
+
+
 /**
  * @def MAX_STATIC_ROUTERS
  * @brief Maximum number of static mounts (routers) the app will register.
@@ -139,19 +147,115 @@ struct app_redirect {
 };
 
 
+/**
+ * @def APP_BODY_PENDING
+ * @brief Returned by @ref app_request_read_body when the rest of the payload has not arrived yet.
+ */
+#define APP_BODY_PENDING (-2)
+
+
+/**
+ * @struct app_body_reader
+ * @brief Pull interface to the part of a request payload that has arrived.
+ *
+ * Provided by the adapter. Each call to @ref read copies the next bytes of
+ * the payload into the caller's buffer. It never waits for the client: once
+ * the bytes received so far are used up it returns @ref APP_BODY_PENDING,
+ * and a handler that needs the rest sets @ref app_response::consumer.
+ * Payload the handler leaves unread is discarded after the response, so a
+ * handler that ignores it never pays for receiving it.
+ */
+struct app_body_reader {
+    ssize_t (*read)(void *ctx, void *buf, size_t len); /**< Returns bytes copied, 0 at the end, -1 on error, @ref APP_BODY_PENDING. */
+    void    *ctx;                                      /**< Passed to @ref read. */
+};
+
+
+/**
+ * @struct app_param
+ * @brief One named request parameter (e.g. from the query string).
+ *
+ * Both strings are decoded and NUL-terminated; @ref value_len counts
+ * embedded NUL bytes, if any.
+ */
+struct app_param {
+    const char *name;       /**< Parameter name (never empty). */
+    const char *value;      /**< Parameter value ("" if given without one). */
+    size_t      value_len;  /**< Length of @ref value. */
+};
+
+
 /**
  * @struct app_request
  * @brief Request forwarded to the application.
  * 
  * Populated by the adapter.
+ *
+ * @ref payload is set only if the complete payload had already arrived when
+ * the handler was called; it is valid for the duration of the call and not
+ * NUL-terminated, and @ref payload_len is its length. Otherwise @ref payload
+ * is NULL and @ref payload_len 0, whatever length the client announced; the
+ * payload is then read with @ref app_request_read_body (which also works
+ * when @ref payload is set) and, beyond what has arrived, received through
+ * an @ref app_body_consumer.
+ *
+ * @ref path carries no parameters; they are in @ref params, in the order the
+ * client sent them, and are looked up with @ref app_request_param. A path
+ * starting with '/' is canonical: no empty, "." or ".." segments, so it can
+ * be matched and mapped onto a filesystem without further checks.
  */
 struct app_request{
     enum app_method 	method;      	/**< App method classification */
-    const char 			*path;          /**< Opaque resource identifier as provided by the adapter. */
-    const void 			*payload;       /**< Request payload (read-only; may be NULL). */
-    size_t 				payload_len;    /**< Payload length in bytes (may be 0). */
+    const char 			*path;          /**< Resource identifier as provided by the adapter (decoded, without parameters). */
+    size_t 				path_len;       /**< Length of @ref path. */
+    const struct app_param *params;     /**< Request parameters (may be NULL if @ref param_count is 0). */
+    size_t 				param_count;    /**< Number of elements in @ref params. */
+    const void 			*payload;       /**< Complete request payload (read-only; NULL unless all of it arrived). */
+    size_t 				payload_len;    /**< Length of @ref payload (0 if it is NULL). */
     enum app_media 		media_type;     /**< Media classification of @ref payload. */
     const char 			*accept;        /**< Optional client preference string (may be NULL). */
+    struct app_body_reader body;        /**< Streaming access to the payload (read == NULL if there is none). */
+};
+
+
+/**
+ * @struct app_body_producer
+ * @brief Push side of a payload that is generated while it is sent.
+ *
+ * The framework calls @ref produce whenever the client can take more and
+ * sends each piece as it comes, so the payload never has to exist in memory
+ * as a whole and its first bytes leave before the last are computed. Its
+ * length need not be known in advance. @ref release is called exactly once,
+ * after the end or when the response is abandoned (client gone, error).
+ */
+struct app_body_producer {
+    ssize_t (*produce)(void *ctx, void *buf, size_t len); /**< Fills up to @p len bytes; returns the count, 0 at the end, -1 on error. */
+    void    (*release)(void *ctx);                        /**< Frees @ref ctx (may be NULL). */
+    void    *ctx;                                         /**< Passed to both callbacks. */
+};
+
+
+struct app_response;
+
+/**
+ * @struct app_body_consumer
+ * @brief Receiver of the part of a request payload that arrives after the handler returned.
+ *
+ * A handler that needs more of the payload than has arrived (the reader
+ * returned @ref APP_BODY_PENDING) sets @ref app_response::consumer and
+ * leaves the rest of the response unset. The framework parks the request
+ * without blocking and passes every further piece to @ref consume as it
+ * arrives, starting right behind the last byte the handler read. Once the
+ * payload is complete, @ref finish fills the response just as a handler
+ * would (it cannot set another consumer). @ref release is called exactly
+ * once, after @ref finish or when the request is abandoned (client gone,
+ * timeout, error).
+ */
+struct app_body_consumer {
+    int     (*consume)(void *ctx, const void *data, size_t len); /**< Takes the next piece; 0 on success, -1 to fail the request. */
+    int     (*finish)(void *ctx, struct app_response *res);      /**< Fills the response; 0 on success, <0 on internal error. */
+    void    (*release)(void *ctx);                               /**< Frees @ref ctx (may be NULL). */
+    void    *ctx;                                                /**< Passed to all callbacks. */
 };
 
 
@@ -165,6 +269,16 @@ struct app_request{
  * - If payload points to static storage or memory owned elsewhere, set
  *   payload_owned == false (it will not be freed by the framework).
  * - For APP_NO_CONTENT, set payload_len to 0 and leave payload as NULL.
+ * - Instead of a buffer, the payload may be @ref payload_len bytes of an
+ *   open file starting at @ref file_offset (@ref payload NULL). The
+ *   framework then sends it without copying it through user space and
+ *   closes @ref file afterwards; the file's backend must support
+ *   fs_native_fd().
+ * - Or the payload is generated piecewise by @ref stream (produce != NULL,
+ *   with @ref payload and @ref file left unset). It goes out with chunked
+ *   transfer coding, in constant memory.
+ * - Or, while the request payload is still arriving, only @ref consumer is
+ *   set; its @ref app_body_consumer::finish fills the response later.
  */
 struct app_response{
     enum app_status 	status; 		/**< Outcome status code. */
@@ -172,6 +286,10 @@ struct app_response{
     const void 			*payload;    	/**< Response payload (read-only; may be NULL). */
     size_t 				payload_len;    /**< Payload length in bytes (0 if none). */
 	bool 				payload_owned;  /**< true if framework should free(payload) after send. */
+	struct fs_file 		*file;			/**< File supplying the payload instead of @ref payload (may be NULL); closed by the framework. */
+	uint64_t 			file_offset;	/**< Offset of the payload in @ref file. */
+	struct app_body_producer stream;	/**< Producer of a streamed payload (produce == NULL if none); released by the framework. */
+	struct app_body_consumer consumer;	/**< Receiver of the rest of the request payload (consume == NULL if none); released by the framework. */
 	struct app_redirect redirect;		/**< Optional redirect; takes precedence if enabled. */
 };
 
@@ -217,6 +335,39 @@ int app_make_redirect(struct app_response *res, const char *location, bool locat
 					  enum app_redirect_type type);
 
 
+/**
+ * @brief Read the next bytes of the request payload.
+ *
+ * Streams the payload from its first byte, independent of
+ * @ref app_request::payload, as far as it has arrived. Only valid while the
+ * request is handled.
+ *
+ * @param req  Request being handled (must not be NULL).
+ * @param buf  Destination buffer.
+ * @param len  Capacity of @p buf.
+ *
+ * @return Bytes copied into @p buf, 0 at the end of the payload (or if the
+ *         request has none), @ref APP_BODY_PENDING if the next bytes have not
+ *         arrived yet (see @ref app_body_consumer), -1 on error (e.g. the
+ *         client closed the connection).
+ */
+ssize_t app_request_read_body(const struct app_request *req, void *buf, size_t len);
+
+
+/**
+ * @brief Look up a request parameter by name.
+ *
+ * If the name occurs more than once, the first occurrence wins.
+ *
+ * @param req       Request being handled (must not be NULL).
+ * @param name      Parameter name (case-sensitive).
+ * @param len_out   [out] Optional; receives the value length.
+ *
+ * @return The parameter's value, or NULL if @p req has no such parameter.
+ */
+const char *app_request_param(const struct app_request *req, const char *name, size_t *len_out);
+
+
 /**
  * @brief Handle a single normalized request and produce a response.
  *
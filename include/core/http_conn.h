@@ -0,0 +1,172 @@
+#ifndef HTTP_CONN_H
+#define HTTP_CONN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct iovec;
+
+/**
+ * @file http_conn.h
+ * @brief Readiness-driven HTTP connection state for non-blocking transports.
+ *
+ * Where @ref http_handle_connection owns a blocking socket for the whole
+ * exchange, an http connection object keeps everything needed to resume
+ * between readiness events: the bytes received so far, the parsed request
+ * and the part of the response that is still unsent. A transport (e.g. the
+ * epoll loop in server.c) creates one per accepted socket and calls
+ * @ref http_conn_on_ready whenever the socket becomes readable or writable.
+ *
+ * Each call performs at most one read(2) and never waits, so a client that
+ * trickles its request cannot stall other connections.
+ *
+ * Pipelined requests are dispatched as soon as they are buffered. Their
+ * responses queue up in request order; heads and small bodies are packed
+ * into one output buffer so consecutive responses leave in a single write.
+ * Once the queue is full the connection stops asking for input until the
+ * client has consumed some of it.
+ *
+ * Completion-based transports (io_uring) do their own I/O instead: they push
+ * received bytes with @ref http_conn_on_data, fetch the response with
+ * @ref http_conn_pending_output and report progress with
+ * @ref http_conn_output_sent. Both styles share one state machine.
+ *
+ * The functions use `void *` handles so they can be plugged directly into
+ * the transport's connection-handler table without the core knowing about
+ * the transport.
+ */
+
+
+/**
+ * @brief Create connection state for an accepted, non-blocking socket.
+ *
+ * @param client_fd Connected client socket (ownership stays with the caller).
+ * @param context   Pointer to a @ref http_core_ctx.
+ *
+ * @return Opaque connection handle, or NULL on allocation failure.
+ */
+void *http_conn_open(int client_fd, void *context);
+
+
+/**
+ * @brief Advance the connection after a readiness event.
+ *
+ * Reads available request bytes, dispatches every complete request and
+ * writes as much of the queued responses as the socket accepts.
+ *
+ * @param conn     Handle returned by @ref http_conn_open.
+ * @param revents  Readiness reported by the transport (POLLIN/POLLOUT/POLLHUP/POLLERR).
+ * @param context  Pointer to a @ref http_core_ctx.
+ *
+ * @return Events the connection waits for next (POLLIN and/or POLLOUT),
+ *         or 0 when the exchange is finished or failed and the socket
+ *         should be closed.
+ */
+int http_conn_on_ready(void *conn, int revents, void *context);
+
+
+/**
+ * @brief Feed bytes received by the transport into the connection.
+ *
+ * Every complete request in the data is dispatched; a trailing partial
+ * request is kept until more bytes arrive.
+ *
+ * @param conn     Handle returned by @ref http_conn_open.
+ * @param data     Received bytes (only read during the call).
+ * @param len      Number of bytes, 0 for EOF.
+ * @param context  Pointer to a @ref http_core_ctx.
+ *
+ * @return POLLOUT while responses are queued, POLLIN while more requests
+ *         are accepted (both may be set), 0 if the connection should be closed.
+ */
+int http_conn_on_data(void *conn, const void *data, size_t len, void *context);
+
+
+/**
+ * @brief Describe the unsent part of the response.
+ *
+ * @param conn     Handle returned by @ref http_conn_open.
+ * @param iov      Output segments of the queued responses, in request order.
+ * @param iov_max  Capacity of @p iov.
+ * @param context  Pointer to a @ref http_core_ctx.
+ *
+ * @return Number of segments filled, 0 if nothing is pending.
+ */
+int http_conn_pending_output(void *conn, struct iovec *iov, int iov_max, void *context);
+
+
+/**
+ * @brief Account for response bytes the transport has sent.
+ *
+ * @param conn     Handle returned by @ref http_conn_open.
+ * @param n        Number of bytes sent, in the order given by @ref http_conn_pending_output.
+ * @param context  Pointer to a @ref http_core_ctx.
+ *
+ * @return Next interest as for @ref http_conn_on_data; sending may free queue
+ *         slots and dispatch requests that were waiting in the input buffer.
+ */
+int http_conn_output_sent(void *conn, size_t n, void *context);
+
+
+/**
+ * @brief Deadline of the connection's current phase.
+ *
+ *  - output pending: @ref HTTP_WRITE_TIMEOUT_MS after the last sent byte;
+ *  - reading a head: @ref HTTP_HEADER_TIMEOUT_MS after its first byte (or
+ *    after the connection opened), regardless of how it trickles in;
+ *  - reading a body: @ref HTTP_BODY_TIMEOUT_MS after the last received byte;
+ *  - kept alive between requests: @ref HTTP_KEEPALIVE_IDLE_TIMEOUT_MS after
+ *    the previous request.
+ *
+ * Transports should re-query it after every call into the connection.
+ *
+ * @param conn     Handle returned by @ref http_conn_open.
+ * @param context  Pointer to a @ref http_core_ctx.
+ *
+ * @return CLOCK_MONOTONIC time in ms (see @ref timer_now_ms) at which the
+ *         connection should be closed, or -1 for no deadline.
+ */
+int64_t http_conn_deadline(void *conn, void *context);
+
+
+/**
+ * @brief Number of requests the connection holds.
+ *
+ * Counts the responses still queued for sending plus the request currently
+ * being received, if any.
+ *
+ * @param conn     Handle returned by @ref http_conn_open.
+ * @param context  Pointer to a @ref http_core_ctx.
+ *
+ * @return Requests received (or partly received) but not fully answered.
+ */
+unsigned http_conn_in_flight(void *conn, void *context);
+
+
+/**
+ * @brief Let the connection finish for a server shutdown.
+ *
+ * Requests already received are still answered, the last of them with
+ * "Connection: close". A kept-alive connection waiting for its next request
+ * is closed right away; one that has not sent a request yet gets its first
+ * one answered.
+ *
+ * @param conn     Handle returned by @ref http_conn_open.
+ * @param context  Pointer to a @ref http_core_ctx.
+ *
+ * @return Events the connection waits for next, or 0 if it can be closed now.
+ */
+int http_conn_drain(void *conn, void *context);
+
+
+/**
+ * @brief Release connection state.
+ *
+ * Frees buffers, the request and any unsent responses. Does not close the socket.
+ *
+ * @param conn     Handle returned by @ref http_conn_open (may be NULL).
+ * @param context  Pointer to a @ref http_core_ctx.
+ */
+void http_conn_close(void *conn, void *context);
+
+#endif /* HTTP_CONN_H */
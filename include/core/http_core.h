@@ -1,10 +1,78 @@
 #ifndef HTTP_CORE_H
 #define HTTP_CORE_H
 
+#include "../http/http_limits.h"
 #include "../http/http_request.h"
 #include "../http/http_response.h"
 
 
+/**
+ * @def HTTP_KEEPALIVE_MAX_REQUESTS
+ * @brief Maximum number of requests served on one persistent connection.
+ *
+ * The response to the last allowed request carries "Connection: close".
+ */
+#define HTTP_KEEPALIVE_MAX_REQUESTS 100
+
+/**
+ * @def HTTP_KEEPALIVE_IDLE_TIMEOUT_MS
+ * @brief Time a persistent connection may stay silent before it is closed.
+ */
+#define HTTP_KEEPALIVE_IDLE_TIMEOUT_MS 5000
+
+/**
+ * @def HTTP_HEADER_TIMEOUT_MS
+ * @brief Time a client has for a complete request head, from its first byte.
+ *
+ * A total budget rather than a per-read one, so trickling the head one byte
+ * at a time (slowloris) does not keep the connection alive.
+ */
+#define HTTP_HEADER_TIMEOUT_MS 10000
+
+/**
+ * @def HTTP_BODY_TIMEOUT_MS
+ * @brief Longest pause between two reads of a request body.
+ */
+#define HTTP_BODY_TIMEOUT_MS 10000
+
+/**
+ * @def HTTP_WRITE_TIMEOUT_MS
+ * @brief Longest time a client may accept no response bytes while output is pending.
+ */
+#define HTTP_WRITE_TIMEOUT_MS 10000
+
+/**
+ * @def HTTP_LINGER_TIMEOUT_MS
+ * @brief Time a refused client has to stop sending before its connection is closed.
+ *
+ * Closing a socket with unread input resets the connection, and the reset
+ * can destroy the refusal that is still on its way to the client.
+ */
+#define HTTP_LINGER_TIMEOUT_MS 2000
+
+/**
+ * @def HTTP_CONTINUE_RESPONSE
+ * @brief Interim response inviting a client that sent "Expect: 100-continue" to send its body.
+ */
+#define HTTP_CONTINUE_RESPONSE "HTTP/1.1 100 Continue\r\n\r\n"
+
+/**
+ * @def HTTP_OVERLOAD_RESPONSE
+ * @brief Preformatted reply for connections refused under overload.
+ *
+ * Complete and constant, so a transport can send it without parsing the
+ * request or allocating anything.
+ */
+#define HTTP_OVERLOAD_RESPONSE \
+	"HTTP/1.1 503 Service Unavailable\r\n" \
+	"Content-Type: text/plain\r\n" \
+	"Content-Length: 20\r\n" \
+	"Retry-After: 1\r\n" \
+	"Connection: close\r\n" \
+	"\r\n" \
+	"Service Unavailable\n"
+
+
 /**
  * @brief Core glue that drives request parsing, adapter dispatch, and response writeout.
  *
@@ -18,6 +86,21 @@
  */
 
 
+/**
+ * @enum http_output_policy
+ * @brief How a connection lets the kernel split its responses into segments.
+ *
+ * A response whose head and body leave with separate calls (a file body sent
+ * with sendfile(2), or more segments than one writev(2) takes) would otherwise
+ * put a small head-only packet on the wire, as listeners run with TCP_NODELAY.
+ */
+enum http_output_policy {
+	HTTP_OUTPUT_MORE = 0,		/**< Write with MSG_MORE while the same flush has more to send (no extra syscalls). */
+	HTTP_OUTPUT_IMMEDIATE,		/**< Every write is pushed out as it is. */
+	HTTP_OUTPUT_CORK			/**< Set TCP_CORK while a flush needs several calls, uncork when it ends. */
+};
+
+
 /**
  * @struct http_core_ctx
  * @brief Callback context for the core request handler.
@@ -52,6 +135,27 @@ struct http_core_ctx {
     
 	/** Opaque user data forwarded to @ref adapter_handler on each invocation. */
 	void* adapter_context;
+
+	/**
+	 * Request size limits of the listener started with this context (NULL →
+	 * default profile). Listeners that need other limits are started with a
+	 * context of their own. Must outlive the server.
+	 */
+	const struct http_limits *limits;
+
+	/**
+	 * Running average of the request head sizes seen (bytes), maintained by
+	 * the connections to size new read buffers (see @ref http_limits::adaptive_buffer).
+	 * Shared by all workers; start it at 0.
+	 */
+	size_t head_hint;
+
+	/**
+	 * Segment coalescing of the listener's connections (zero value →
+	 * @ref HTTP_OUTPUT_MORE). Output is always uncorked once a flush ends,
+	 * so the policy never delays the last bytes of a batch of responses.
+	 */
+	enum http_output_policy output_policy;
 };
 
 
@@ -59,16 +163,26 @@ struct http_core_ctx {
  * @brief Handle one HTTP connection on a client socket.
  *
  * This function is called by the server accept loop for each connected
- * client. It:
+ * client. For every request on the connection it:
  *   - parses the HTTP request from the socket,
  *   - invokes the adapter callback to obtain a response,
  *   - sends the response,
  *   - and performs cleanup.
  *
+ * Persistent connections (HTTP/1.1 by default, HTTP/1.0 with
+ * "Connection: keep-alive") are served until the client closes, asks for
+ * "Connection: close", sends nothing for @ref HTTP_KEEPALIVE_IDLE_TIMEOUT_MS
+ * or reaches @ref HTTP_KEEPALIVE_MAX_REQUESTS. One read buffer is reused for
+ * all requests. The connection is also closed when it misses the header,
+ * body or write deadline (see @ref http_conn_deadline).
+ *
+ * Uses the same state machine as the event loop (@ref http_conn_on_ready),
+ * waiting with poll(2) between steps.
+ *
  * @param client_fd Connected client socket file descriptor.
  * @param context   Pointer to a @ref http_core_ctx provided by the caller.
  *
- * @return 0 on success, -1 on parse or send errors, or adapter return code.
+ * @return 0 when the connection is finished, -1 if no state could be allocated.
  */
 int http_handle_connection(int client_fd, void *context);
 
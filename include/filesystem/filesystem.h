@@ -101,6 +101,18 @@ struct fs_file_ops {
     int (*seek)(struct fs_file *file, uint64_t offset);
 
 
+    /**
+     * @brief Descriptor of the underlying OS file, for zero-copy sending.
+     * @note Optional; may be NULL if the file is not backed by a descriptor.
+     *
+     * The descriptor stays owned by the handle (closed by @ref close) and
+     * is only read with positional calls (e.g. sendfile(2) with an offset).
+     *
+     * @return The descriptor (>= 0), or a negative error code.
+     */
+    int (*native_fd)(struct fs_file *file);
+
+
     /**
      * @brief Close the file and release resources.
 	 *
@@ -132,7 +144,11 @@ struct fs_file {
  * Semantics & conventions:
  *  - All @p path arguments are interpreted **relative to** @ref fs::root.
  *    A leading '/' MAY be accepted and treated as relative to the root.
- *  - Backends MUST prevent path traversal outside the root (reject "..").
+ *  - Paths MUST be canonical: no "." or ".." segments. Request paths are
+ *    canonicalized once by the HTTP parser (see @ref http_request::path);
+ *    callers passing paths from any other untrusted source must canonicalize
+ *    them first. Backends still reject ".." segments with @ref FS_INVALID as
+ *    a last line of defense.
  *  - Return values follow @ref fs_return_codes (non-negative success, negative error).
  *  - Thread-safety is implementation-defined; document if additional external
  *    synchronization is required.
@@ -172,7 +188,7 @@ struct fs_ops {
      *
      * @return @ref FS_OK on success (including when the directory already exists);
      *         @ref FS_NOT_FOUND if parents are missing and @p recursive is false;
-     *         @ref FS_INVALID on bad arguments or rejected traversal;
+     *         @ref FS_INVALID on bad arguments;
      *         @ref FS_NOT_SUPPORTED if the filesystem does not support directory creation;
      *         @ref FS_ERROR on other failures.
      */
@@ -250,7 +266,7 @@ int fs_open (struct fs *vfs, const char *path, struct fs_file **file_out);
  * @param recursive If true, create missing parents; if false, create only the leaf.
  *
  * @return @ref FS_OK on success;
- *         @ref FS_INVALID on bad arguments or rejected traversal;
+ *         @ref FS_INVALID on bad arguments;
  *         @ref FS_NOT_FOUND if parents are missing and @p recursive is false;
  *         @ref FS_NOT_SUPPORTED if the concrete filesystem cannot create directories;
  *         @ref FS_ERROR on other failures (e.g., permission denied, type conflicts).
@@ -273,7 +289,7 @@ int fs_mkdir(struct fs *vfs, const char *path, bool recursive);
  * @param recursive If true, create missing parents (mkdir -p semantics) when absent.
  *
  * @return @ref FS_OK on success;
- *         @ref FS_INVALID on bad arguments or rejected traversal;
+ *         @ref FS_INVALID on bad arguments;
  *         @ref FS_NOT_FOUND if parents are missing and @p recursive is false;
  *         @ref FS_NOT_SUPPORTED if the concrete filesystem does not support directory creation;
  *         @ref FS_ERROR on other failures (e.g., permission denied, type conflict).
@@ -334,6 +350,18 @@ ssize_t fs_read_all (struct fs_file *file, void *buffer, size_t cap);
 int fs_seek (struct fs_file *file, uint64_t offset);
 
 
+/**
+ * @brief Descriptor of the OS file behind @p file (if the backend has one).
+ *
+ * Lets callers hand the file to the kernel (sendfile(2)) instead of reading
+ * it. The descriptor remains owned by @p file and is valid until @ref fs_close.
+ *
+ * @return The descriptor (>= 0), @ref FS_NOT_SUPPORTED if not available,
+ *         or a negative error code.
+ */
+int fs_native_fd(struct fs_file *file);
+
+
 /**
  * @brief Close an open file handle.
  *
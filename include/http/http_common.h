@@ -2,6 +2,7 @@
 #define HTTP_COMMON_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
  * @struct http_header
@@ -21,6 +22,8 @@
 struct http_header {
     const char *name;        /**< Header field name (e.g., "Content-Type"), null-terminated. */
     const char *value;       /**< Header field value (e.g., "text/plain"), null-terminated. */
+    size_t name_len;   /**< Length of @ref name (set by the request parser; 0 → use strlen). */
+    size_t value_len;  /**< Length of @ref value (set by the request parser; 0 → use strlen). */
     bool name_owned;   /**< true if @ref name is heap-owned and should be freed.  */
 	bool value_owned;  /**< true if @ref value is heap-owned and should be freed. */
 };
@@ -0,0 +1,32 @@
+#ifndef HTTP_DATE_H
+#define HTTP_DATE_H
+
+/**
+ * @file http_date.h
+ * @brief Current time as an HTTP date, formatted once per second.
+ *
+ * Every response carries a Date header (RFC 9110, section 6.6.1). The
+ * value only changes once per second, so it is formatted by whichever
+ * thread first notices a new second and shared by all others; a response
+ * costs a 29-byte copy instead of a gmtime/strftime round.
+ */
+
+#include <stddef.h>
+
+/**
+ * @def HTTP_DATE_LEN
+ * @brief Length of an IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT").
+ */
+#define HTTP_DATE_LEN 29
+
+
+/**
+ * @brief Copy the current date (IMF-fixdate, GMT) into @p out.
+ *
+ * Thread-safe and lock-free for readers; never blocks.
+ *
+ * @param out 	Destination of @ref HTTP_DATE_LEN bytes (not NUL-terminated).
+ */
+void http_date_now(char *out);
+
+#endif /* HTTP_DATE_H */
@@ -0,0 +1,105 @@
+#ifndef HTTP_FIELDS_H
+#define HTTP_FIELDS_H
+
+/**
+ * @file http_fields.h
+ * @brief Interned identifiers for methods, versions and well-known header names.
+ *
+ * The parser classifies every header name once, with a perfect hash over
+ * the names below, and records where each well-known header sits (see
+ * @ref http_request_header). Looking up Host, Content-Length, Connection
+ * and the like then costs one table access instead of a case-insensitive
+ * comparison against every header of the request. Method and version are
+ * classified the same way, so nothing downstream compares them as strings.
+ */
+
+#include <stddef.h>
+
+/**
+ * @enum http_header_id
+ * @brief Well-known header fields.
+ */
+enum http_header_id {
+	HTTP_HEADER_OTHER = 0,			/**< Not one of the well-known headers. */
+	HTTP_HEADER_HOST,				/**< Host */
+	HTTP_HEADER_CONTENT_LENGTH,		/**< Content-Length */
+	HTTP_HEADER_CONTENT_TYPE,		/**< Content-Type */
+	HTTP_HEADER_CONNECTION,			/**< Connection */
+	HTTP_HEADER_TRANSFER_ENCODING,	/**< Transfer-Encoding */
+	HTTP_HEADER_TE,					/**< TE */
+	HTTP_HEADER_EXPECT,				/**< Expect */
+	HTTP_HEADER_ACCEPT,				/**< Accept */
+	HTTP_HEADER_ACCEPT_ENCODING,	/**< Accept-Encoding */
+	HTTP_HEADER_USER_AGENT,			/**< User-Agent */
+	HTTP_HEADER_UPGRADE,			/**< Upgrade */
+	HTTP_HEADER_IF_NONE_MATCH,		/**< If-None-Match */
+	HTTP_HEADER_IF_MODIFIED_SINCE,	/**< If-Modified-Since */
+	HTTP_HEADER_RANGE,				/**< Range */
+	HTTP_HEADER_COOKIE,				/**< Cookie */
+	HTTP_HEADER_AUTHORIZATION,		/**< Authorization */
+	HTTP_HEADER_COUNT				/**< Number of identifiers (table size). */
+};
+
+
+/**
+ * @enum http_method
+ * @brief Request methods (RFC 9110, section 9, plus PATCH).
+ */
+enum http_method {
+	HTTP_METHOD_OTHER = 0,	/**< Any other token. */
+	HTTP_METHOD_GET,
+	HTTP_METHOD_HEAD,
+	HTTP_METHOD_POST,
+	HTTP_METHOD_PUT,
+	HTTP_METHOD_DELETE,
+	HTTP_METHOD_CONNECT,
+	HTTP_METHOD_OPTIONS,
+	HTTP_METHOD_TRACE,
+	HTTP_METHOD_PATCH
+};
+
+
+/**
+ * @enum http_version
+ * @brief Protocol versions of the request line.
+ */
+enum http_version {
+	HTTP_VERSION_OTHER = 0,	/**< Anything but the versions below. */
+	HTTP_VERSION_1_0,		/**< "HTTP/1.0" */
+	HTTP_VERSION_1_1		/**< "HTTP/1.1" */
+};
+
+
+/**
+ * @brief Classify a header name (case-insensitive).
+ *
+ * @param name 	Header name (need not be NUL-terminated).
+ * @param len 	Length of @p name.
+ *
+ * @return enum http_header_id 	Its identifier, or @ref HTTP_HEADER_OTHER.
+ */
+enum http_header_id http_header_id_of(const char *name, size_t len);
+
+
+/**
+ * @brief Canonical spelling of a well-known header name (NULL for @ref HTTP_HEADER_OTHER).
+ */
+const char *http_header_name(enum http_header_id id);
+
+
+/**
+ * @brief Classify a method token (case-sensitive, as methods are).
+ *
+ * @return enum http_method 	Its identifier, or @ref HTTP_METHOD_OTHER.
+ */
+enum http_method http_method_of(const char *method, size_t len);
+
+
+/**
+ * @brief Classify a protocol version ("HTTP/1.1", "HTTP/1.0").
+ *
+ * @return enum http_version 	Its identifier, or @ref HTTP_VERSION_OTHER.
+ */
+enum http_version http_version_of(const char *version, size_t len);
+
+#endif /* HTTP_FIELDS_H */
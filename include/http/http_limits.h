@@ -0,0 +1,89 @@
+#ifndef HTTP_LIMITS_H
+#define HTTP_LIMITS_H
+
+/**
+ * @file http_limits.h
+ * @brief Runtime limits for request parsing and buffering.
+ *
+ * A @ref http_limits is chosen per listener through its @ref http_core_ctx:
+ * start from a named profile (@ref http_limits_profile_get), override single
+ * fields where needed, and pass the result through @ref http_limits_normalize.
+ * The HTTP_MAX_* constants of http_request.h are the values of the default
+ * profile; @ref HTTP_MAX_HEADERS is additionally the capacity of the
+ * per-request header table and thus an upper bound for every profile.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @struct http_limits
+ * @brief Size limits applied to every request of a listener.
+ */
+struct http_limits {
+	size_t max_head;		/**< Request line plus headers, including the blank line (bytes). */
+	size_t max_headers;		/**< Header fields kept per request; further ones are dropped. */
+	size_t max_path;		/**< Longest request target; a longer one fails the request. */
+	size_t max_body_buffer;	/**< Body bytes buffered before the handler runs (the rest is streamed). */
+	size_t max_body;		/**< Largest body accepted (0 → unlimited): a larger Content-Length is refused
+								 with 413 before the body is read, a chunked body growing beyond it fails. */
+	size_t initial_buffer;	/**< Initial read buffer of a connection (bytes). */
+	bool   adaptive_buffer;	/**< Grow the initial buffer beyond @ref initial_buffer to fit the heads seen so far. */
+};
+
+
+/**
+ * @enum http_limits_profile
+ * @brief Named sets of limits.
+ */
+enum http_limits_profile {
+	HTTP_LIMITS_DEFAULT,		/**< General purpose: 4 KiB heads, 4 KiB buffered body, bodies up to 8 MiB. */
+	HTTP_LIMITS_TINY,			/**< Small, fixed memory per connection (embedded targets). */
+	HTTP_LIMITS_LARGE_UPLOAD	/**< Large heads, 64 KiB of body buffered before dispatch, no body size limit. */
+};
+
+
+/**
+ * @brief Limits of a named profile (static storage; copy it to override fields).
+ *
+ * Unknown values yield the default profile.
+ */
+const struct http_limits *http_limits_profile_get(enum http_limits_profile profile);
+
+
+/**
+ * @brief Look up a profile by name ("default", "tiny", "large-upload").
+ *
+ * @return 0 on success, -1 if @p name is unknown.
+ */
+int http_limits_profile_from_name(const char *name, enum http_limits_profile *profile);
+
+
+/**
+ * @brief Clamp overridden fields into the range the parser supports.
+ *
+ * Ensures at least one header and a non-empty path fit, caps
+ * @ref http_limits::max_headers at @ref HTTP_MAX_HEADERS and keeps the
+ * initial buffer within the head limit. @ref http_limits::max_body_buffer
+ * is kept between 64 bytes and 1 MiB, and never above
+ * @ref http_limits::max_body when that is set: buffering more than a body
+ * may hold would only reserve memory no request can use.
+ */
+void http_limits_normalize(struct http_limits *limits);
+
+
+/**
+ * @brief Initial read buffer for a new connection.
+ *
+ * With @ref http_limits::adaptive_buffer the size follows @p head_hint
+ * (typical head size seen on the listener) with some headroom, doubling
+ * @ref http_limits::initial_buffer until it fits, so a typical head needs
+ * no realloc. It never drops below @ref http_limits::initial_buffer, which
+ * keeps pipelined requests from piling up in the socket.
+ *
+ * @param limits 	Limits of the listener.
+ * @param head_hint Typical head size observed so far (0 if none yet).
+ */
+size_t http_limits_initial_buffer(const struct http_limits *limits, size_t head_hint);
+
+#endif /* HTTP_LIMITS_H */
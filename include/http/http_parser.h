@@ -1,8 +1,11 @@
 #ifndef HTTP_PARSER_H
 #define HTTP_PARSER_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include "http_limits.h"
 #include "http_request.h"
+#include "http_scan.h"
 
 /**
  * @brief Parse the HTTP request line ("METHOD PATH VERSION") into request struct.
@@ -53,11 +56,212 @@ int read_body(int fd, char **buffer, size_t buffer_len, size_t headers_end,
               size_t content_len, size_t max_body, size_t already_read, struct http_request *req);
 
 
+/**
+ * @brief Locate the end of the header section ("\r\n\r\n") in a buffer.
+ *
+ * @param buffer 	Buffer holding the bytes received so far.
+ * @param len 		Number of valid bytes in @p buffer.
+ *
+ * @return int 		Index of the first CR of "\r\n\r\n", or -1 if not (yet) present.
+ */
+int http_find_headers_end(const char *buffer, size_t len);
+
+
+/**
+ * @brief Parse request line and headers from an in-memory header section.
+ *
+ * Fills method, path, version and headers of @p req and reports the declared
+ * Content-Length. Does not read from any file descriptor, so it can be used by
+ * transports that collect the bytes themselves (e.g. an event loop).
+ *
+ * @param buffer 				Buffer starting with the request line.
+ * @param headers_end 			Index of "\r\n\r\n" in @p buffer (see @ref http_find_headers_end).
+ * @param content_len_out [out] Declared Content-Length (0 if absent).
+ * @param req 					HTTP request struct to populate.
+ *
+ * @return int 					0 on success, -1 on error (including a Content-Length that is
+ * 								not a plain decimal number, or repeated with different values).
+ */
+int http_parse_request_head(const char *buffer, size_t headers_end, size_t *content_len_out, 
+							struct http_request *req);
+
+
+/**
+ * @brief Zero-copy variant of @ref http_parse_request_head.
+ *
+ * Instead of allocating a copy of every field, @p req receives views into
+ * @p buffer: the request line and header lines are split in place by
+ * overwriting separators with NUL, and the headers are stored in
+ * @ref http_request::header_slots. A typical request head needs no heap
+ * allocation at all.
+ *
+ * The views stay valid as long as @p buffer is not freed or moved; after a
+ * realloc() call @ref http_request_rebase. Bytes after the head (the body)
+ * are not touched.
+ *
+ * @param buffer 				Writable buffer starting with the request line.
+ * @param headers_end 			Index of "\r\n\r\n" in @p buffer (see @ref http_head_scan).
+ * @param scan 					Scan that found @p headers_end; its recorded line ends
+ * 								spare a second search (may be NULL).
+ * @param limits 				Header count and path length limits (NULL → default profile).
+ * @param content_len_out [out] Declared Content-Length (0 if absent).
+ * @param req 					HTTP request struct to populate (initialized with @ref http_request_init).
+ *
+ * @return int 					0 on success, -1 on error (including a path longer
+ * 								than @ref http_limits::max_path or an invalid Content-Length).
+ */
+int http_parse_request_head_inplace(char *buffer, size_t headers_end, const struct http_head_scan *scan,
+									const struct http_limits *limits, size_t *content_len_out,
+									struct http_request *req);
+
+
+/**
+ * @brief Store a copy of the received body bytes in @p req.
+ *
+ * Allocates a null-terminated copy of @p body and sets @ref http_request::content_length
+ * to @p body_len. Logs a warning if fewer bytes than declared were received.
+ *
+ * @param body 			Body bytes (may be NULL if @p body_len is 0).
+ * @param body_len 		Number of body bytes received.
+ * @param content_len 	Declared Content-Length.
+ * @param req 			HTTP request struct to populate with body pointer.
+ *
+ * @return int 			0 on success, -1 on error.
+ */
+int http_parse_request_body(const char *body, size_t body_len, size_t content_len, struct http_request *req);
+
+
+/**
+ * @enum http_parse_status
+ * @brief Result of one @ref http_parser_feed call.
+ */
+enum http_parse_status {
+	HTTP_PARSE_ERROR 		= -1,	/**< Malformed message; the connection cannot continue. */
+	HTTP_PARSE_NEED_MORE 	= 0,	/**< Everything received is processed; call again once more bytes arrived. */
+	HTTP_PARSE_HEADERS_DONE = 1,	/**< The head was parsed into the request. */
+	HTTP_PARSE_BODY_CHUNK 	= 2,	/**< Body bytes are available in @ref http_parser::chunk. */
+	HTTP_PARSE_DONE 		= 3		/**< The message is complete. */
+};
+
+
+/**
+ * @enum http_parser_phase
+ * @brief Part of the message a @ref http_parser expects next.
+ */
+enum http_parser_phase {
+	HTTP_PARSER_HEAD,		/**< Looking for the end of the head. */
+	HTTP_PARSER_BODY,		/**< Head parsed, Content-Length body bytes outstanding. */
+	HTTP_PARSER_CHUNK_SIZE,	/**< Chunked body: expecting a chunk-size line. */
+	HTTP_PARSER_CHUNK_DATA,	/**< Chunked body: inside a chunk's data. */
+	HTTP_PARSER_CHUNK_END,	/**< Chunked body: expecting the CRLF behind a chunk's data. */
+	HTTP_PARSER_TRAILER,	/**< Chunked body: skipping trailer lines up to the empty one. */
+	HTTP_PARSER_COMPLETE	/**< Message complete. */
+};
+
+
+/**
+ * @struct http_parser
+ * @brief Resumable request parser for non-blocking transports.
+ *
+ * The parser never reads from a socket: the transport appends whatever
+ * bytes arrived to its buffer and calls @ref http_parser_feed, which
+ * returns after every step (head parsed, body piece available) or once it
+ * needs more input. All progress is kept here as offsets, so the buffer
+ * may be grown (moved) between calls; the request's views then need
+ * @ref http_request_rebase.
+ *
+ * The head is parsed in place (see @ref http_parse_request_head_inplace).
+ * The body is delimited by Content-Length or, with "Transfer-Encoding:
+ * chunked", by chunk framing. Either way the decoded body is handed out in
+ * pieces as it arrives and lies back to back right behind the head: chunk
+ * data is moved down over the framing that preceded it, inside the buffer,
+ * so a chunked body needs neither a second buffer nor to be complete
+ * before the first piece is delivered. Trailer fields are skipped.
+ * Pieces a consumer has taken can be dropped with
+ * @ref http_parser_discard_body, which keeps the buffer bounded however
+ * long the body is.
+ */
+struct http_parser {
+	const struct http_limits *limits;	/**< Limits applied to the head (never NULL after init). */
+	enum http_parser_phase phase;		/**< What comes next. */
+	struct http_head_scan  scan;		/**< Search for the end of the head. */
+	size_t 				   head_len;	/**< Length of the head including "\r\n\r\n" (0 until parsed). */
+	size_t 				   content_len;	/**< Declared Content-Length (0 for a chunked body). */
+	bool 				   chunked;		/**< Body uses chunked transfer coding. */
+	size_t 				   chunk_left;	/**< Data bytes left in the current chunk. */
+	size_t 				   body_read;	/**< Decoded body bytes handed out so far. */
+	size_t 				   body_held;	/**< Decoded body bytes lying behind the head (not discarded). */
+	size_t 				   consumed;	/**< Bytes of the buffer processed (head and body so far). */
+	const char 			  *chunk;		/**< Body piece of the last @ref HTTP_PARSE_BODY_CHUNK. */
+	size_t 				   chunk_len;	/**< Length of @ref chunk. */
+};
+
+
+/**
+ * @brief Prepare @p parser for a new message.
+ *
+ * @param parser 	Parser state.
+ * @param limits 	Limits for the message (NULL → default profile); must
+ * 					outlive the parser.
+ */
+void http_parser_init(struct http_parser *parser, const struct http_limits *limits);
+
+
+/**
+ * @brief Drop the framing of a chunked body from the buffer.
+ *
+ * Moves the unprocessed bytes down to the end of the decoded body, so the
+ * buffer holds nothing but head, decoded body and unprocessed input. Lets a
+ * transport bound its buffer by the body size rather than by the framing.
+ * Does nothing for other messages.
+ *
+ * @param parser 	Parser state.
+ * @param buffer 	Buffer passed to @ref http_parser_feed.
+ * @param len 		[in,out] Valid bytes in @p buffer; reduced by the dropped framing.
+ */
+void http_parser_compact(struct http_parser *parser, char *buffer, size_t *len);
+
+
+/**
+ * @brief Drop the decoded body bytes held behind the head.
+ *
+ * Moves the unprocessed bytes down to the end of the head; the next body
+ * piece is then decoded right there. Call once the pieces delivered so far
+ * have been consumed.
+ *
+ * @param parser 	Parser state (head parsed).
+ * @param buffer 	Buffer passed to @ref http_parser_feed.
+ * @param len 		[in,out] Valid bytes in @p buffer; reduced by the dropped body bytes and framing.
+ */
+void http_parser_discard_body(struct http_parser *parser, char *buffer, size_t *len);
+
+
+/**
+ * @brief Advance the parser over the bytes received so far.
+ *
+ * Call repeatedly until it returns @ref HTTP_PARSE_NEED_MORE, @ref HTTP_PARSE_DONE
+ * or @ref HTTP_PARSE_ERROR. After @ref HTTP_PARSE_DONE the first
+ * @ref http_parser::consumed bytes of @p buffer belong to this message; the
+ * rest (pipelined requests) starts the next one, after @ref http_parser_init.
+ *
+ * @param parser 	Parser state.
+ * @param buffer 	Writable buffer starting with the message's first byte.
+ * @param len 		Number of valid bytes in @p buffer.
+ * @param req 		Request to populate (initialized with @ref http_request_init).
+ *
+ * @return enum http_parse_status 	What happened in this step.
+ */
+enum http_parse_status http_parser_feed(struct http_parser *parser, char *buffer, size_t len, struct http_request *req);
+
+
 /**
  * @brief Parse a complete request from @p fd into @p req.
  *
- * On success returns 0 and fills `req` (allocates fields if necessery).
- * On error returns -1. Caller must call http_request_clear(req). 
+ * Blocking driver of @ref http_parser: reads until the message is complete.
+ * On success returns 0 and fills `req`: method, path and headers point into
+ * `*buffer`, the body is an allocated copy (truncated at the default
+ * profile's @ref http_limits::max_body_buffer).
+ * On error returns -1. Caller must call http_request_clear(req) before freeing `*buffer`.
  *
  * @param fd 			File descriptor to read from.
  * @param buffer 		Pointer to buffer pointer (gets reallocated if needed).
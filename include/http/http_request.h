@@ -3,7 +3,9 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <sys/types.h>
 #include "./http_common.h"
+#include "./http_fields.h"
 
 /**
  * @file http_request.h
@@ -38,6 +40,12 @@
  */
 #define HTTP_MAX_HEADERS 		32
 
+/**
+ * @def HTTP_MAX_QUERY_PARAMS
+ * @brief Maximum number of query parameters stored in a single request (further ones are dropped).
+ */
+#define HTTP_MAX_QUERY_PARAMS 	16
+
 /**
  * @def HTTP_MAX_HEADER_VALUE
  * @brief (Optional/Advisory) Maximum number of bytes for a single header value
@@ -51,6 +59,13 @@
  */
 #define HTTP_MAX_HEADERS_BUFFER 4096
 
+/**
+ * @def HTTP_MAX_CHUNK_LINE
+ * @brief Upper bound for a chunk-size line or a trailer line of a chunked body
+ * (including its CRLF).
+ */
+#define HTTP_MAX_CHUNK_LINE 	256
+
 /**
  * @def HTTP_MAX_BODY_BUFFER
  * @brief Upper bound for the size (in bytes) of the request body to be read/stored.
@@ -58,26 +73,90 @@
 #define HTTP_MAX_BODY_BUFFER 	4096
 
 
+/**
+ * @struct http_query_param
+ * @brief One "name=value" pair of the query string, percent-decoded.
+ *
+ * Both strings are NUL-terminated views into the request line; the lengths
+ * count a decoded "%00" as a byte.
+ */
+struct http_query_param {
+    const char *name;   /**< Parameter name (never empty). */
+    size_t name_len;    /**< Length of @ref name. */
+    const char *value;  /**< Parameter value ("" if the pair has no '='). */
+    size_t value_len;   /**< Length of @ref value. */
+};
+
+
+/**
+ * @def HTTP_BODY_PENDING
+ * @brief Returned by @ref http_body_reader::read when the next body bytes have not arrived yet.
+ */
+#define HTTP_BODY_PENDING 		(-2)
+
+
+/**
+ * @struct http_body_reader
+ * @brief Pull interface to the part of a request body that has arrived.
+ *
+ * Installed by the transport while the request is being handled. Every
+ * call copies the next bytes of the (decoded) body into the caller's
+ * buffer. It never waits for the client: once the received bytes are used
+ * up it returns @ref HTTP_BODY_PENDING, and a handler that needs the rest
+ * returns a @ref http_body_sink instead of a response.
+ */
+struct http_body_reader {
+    ssize_t (*read)(void *ctx, void *buf, size_t len); /**< Returns bytes copied, 0 at the end of the body, -1 on error, @ref HTTP_BODY_PENDING. */
+    void    *ctx;                                      /**< Passed to @ref read. */
+};
+
+
 /**
  * @brief HTTP request struct for representation of a parsed HTTP request.
  *
  * Fields @ref method, @ref path, @ref version, and each header name/value are
- * heap-allocated, null-terminated strings. They are freed by @ref http_request_clear().
+ * null-terminated strings. The request target is split once by the parser:
+ * @ref path is the percent-decoded path without query and fragment, the
+ * query string is split into @ref params and the fragment is dropped. An
+ * origin-form path is canonical: it starts with '/', holds no empty, "."
+ * or ".." segments, and cannot reach above the root. Depending on the parser they are either
+ *  - heap-allocated copies (@ref line_owned and the header *_owned flags set),
+ *    freed by @ref http_request_clear(), or
+ *  - views into the caller's read buffer (zero-copy parsing, see
+ *    @ref http_parse_request_head_inplace), valid as long as that buffer is.
  *
- * The @ref headers array is also heap-allocated (size: @ref num_headers).
- * The @ref body pointer is an optional heap-allocated, null-terminated copy of
- * the message body (present only if a body was read/parsed).
+ * The @ref headers array is either heap-allocated or points to @ref header_slots.
+ * The parser also classifies the method and version (@ref method_id,
+ * @ref version_id) and records the position of each well-known header in
+ * @ref header_index, for constant-time lookups with @ref http_request_header.
+ * The @ref body pointer is optional and present only if the whole body was
+ * received before the request was handed on: either a heap-allocated,
+ * null-terminated copy (@ref body_owned) or a view into the read buffer
+ * (not null-terminated). The body can always be consumed through
+ * @ref body_reader when one is installed.
  */
 struct http_request {
     char *method;   /**< Request method (e.g., "GET", "POST"), null-terminated. */
-    char *path;     /**< Request target/path (e.g., "/index.html"), null-terminated. */
+    char *path;     /**< Canonical, percent-decoded path of the request target (e.g., "/index.html"), null-terminated. */
     char *version;  /**< HTTP version (e.g., "HTTP/1.1"), null-terminated. */
+    size_t method_len;  /**< Length of @ref method. */
+    size_t path_len;    /**< Length of @ref path. */
+    size_t version_len; /**< Length of @ref version. */
+    bool line_owned;    /**< true if @ref method, @ref path, @ref version (and @ref params) are heap-owned. */
+    enum http_method method_id;   /**< Classified @ref method. */
+    enum http_version version_id; /**< Classified @ref version. */
+    struct http_query_param params[HTTP_MAX_QUERY_PARAMS]; /**< Query parameters, in order of appearance. */
+    size_t param_count; /**< Number of elements in @ref params. */
 
     struct http_header *headers; /**< Array of headers (length: @ref num_headers). */
     size_t num_headers;          /**< Number of elements in @ref headers. */
+    struct http_header header_slots[HTTP_MAX_HEADERS]; /**< In-place storage for @ref headers (zero-copy parsing). */
+    uint8_t header_index[HTTP_HEADER_COUNT]; /**< 1 + index into @ref headers of the first header with each id (0 → absent). */
 
-    size_t content_length; /**< Parsed Content-Length value (if present), else 0. */
-    char  *body;           /**< Optional body buffer, null-terminated; may be NULL if no body. */
+    size_t content_length; /**< Length of @ref body (declared Content-Length before the body was read), else 0. */
+    char  *body;           /**< Optional complete body; may be NULL. */
+    bool   body_owned;     /**< true if @ref body is heap-owned (freed by @ref http_request_clear). */
+    struct http_body_reader body_reader; /**< Streaming access to the body (read == NULL if unavailable). */
 };
 
 
@@ -96,7 +175,7 @@ void http_request_init(struct http_request *req);
  * @brief Free all heap-allocated memory in an @ref http_request struct.
  *
  * Frees @ref method, @ref path, @ref version, each header name/value, the
- * @ref headers array itself, and @ref body if present. After this call, the
+ * @ref headers array itself, and @ref body if it is owned. After this call, the
  * structure is reset to an empty state (NULL pointers, zero counters).
  * 
  * Does not free the struct itself!
@@ -107,11 +186,46 @@ void http_request_init(struct http_request *req);
 void http_request_clear(struct http_request *req);
 
 
+/**
+ * @brief Re-point the views of a zero-copy request after its buffer moved.
+ *
+ * Call after realloc() returned @p new_base for the buffer that started at
+ * @p old_base; heap-owned fields are left alone.
+ *
+ * @param req       Request parsed with @ref http_parse_request_head_inplace.
+ * @param old_base  Previous start of the buffer (only used as a number).
+ * @param new_base  New start of the buffer.
+ */
+void http_request_rebase(struct http_request *req, uintptr_t old_base, char *new_base);
+
+
+/**
+ * @brief Fill @ref http_request::header_index from the parsed headers.
+ *
+ * Called by the parsers once the headers are stored.
+ *
+ * @param req Request whose @ref http_request::headers are set.
+ */
+void http_request_index_headers(struct http_request *req);
+
+
+/**
+ * @brief Value of a well-known header in constant time.
+ *
+ * @param req  Parsed request (must not be NULL).
+ * @param id   Header to look up.
+ *
+ * @return Value of the first header with that name, or NULL if absent.
+ */
+const char *http_request_header(const struct http_request *req, enum http_header_id id);
+
+
 /**
  * @brief Look up a header value by name (case-insensitive).
  *
- * Scans @p req->headers and returns the value pointer of the first header
- * whose name matches @p header_name, using a case-insensitive comparison.
+ * Well-known names (see @ref http_header_id) are answered from
+ * @ref http_request::header_index; any other name is searched by comparing
+ * it against every header, case-insensitively.
  *
  * @param req          Parsed request to search (must not be NULL).
  * @param header_name  Header field-name to look up (must not be NULL).
@@ -127,4 +241,21 @@ void http_request_clear(struct http_request *req);
  */
 const char* http_request_get_header_value(const struct http_request *req, const char *header_name);
 
+
+/**
+ * @brief Decide whether the client wants the connection kept open after this request.
+ *
+ * Follows the HTTP/1.x persistence rules:
+ *  - HTTP/1.1: persistent unless the Connection header contains "close".
+ *  - HTTP/1.0: persistent only if the Connection header contains "keep-alive".
+ *  - Any other version: not persistent.
+ *
+ * Connection tokens are matched case-insensitively in a comma-separated list.
+ *
+ * @param req Parsed request (must have been parsed successfully).
+ *
+ * @return true if the client allows another request on the same connection.
+ */
+bool http_request_keep_alive(const struct http_request *req);
+
 #endif /* HTTP_REQUEST_H */
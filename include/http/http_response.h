@@ -4,6 +4,7 @@
 #include "http_common.h"
 #include <stdbool.h>
 #include <stddef.h>
+#include <sys/types.h>
 
 /**
  * @brief Response description and helpers for writing a serialized response.
@@ -13,6 +14,31 @@
  * This header also provides a convenience helper to send plain text.
  */
 
+/**
+ * @def HTTP_RESPONSE_HEAD_MAX
+ * @brief Upper bound for the size (in bytes) of a serialized status line plus headers.
+ */
+#define HTTP_RESPONSE_HEAD_MAX 2048
+
+/**
+ * @def HTTP_SENDFILE_MAX
+ * @brief Most file bytes handed to one sendfile(2) call.
+ */
+#define HTTP_SENDFILE_MAX (1u << 30)
+
+/**
+ * @def HTTP_FILE_PIECE
+ * @brief Most file bytes read into memory at a time (see @ref http_response_file_next).
+ */
+#define HTTP_FILE_PIECE 65536
+
+/**
+ * @def HTTP_STREAM_CHUNK
+ * @brief Most bytes requested from a body producer at a time (one chunk on the wire).
+ */
+#define HTTP_STREAM_CHUNK 16384
+
+
 /**
  * @enum http_status
  * @brief Common status codes.
@@ -30,9 +56,81 @@ enum http_status{
 	HTTP_BAD_REQUEST		= 400,
 	HTTP_FORBIDDEN  		= 403,
     HTTP_NOT_FOUND  		= 404,
+	HTTP_METHOD_NOT_ALLOWED	= 405,
+	HTTP_PAYLOAD_TOO_LARGE	= 413,
 	HTTP_UNSUPPORTED		= 415,
+	HTTP_HEADERS_TOO_LARGE	= 431,
 	HTTP_SERVER_ERROR		= 500,
-	HTTP_NOT_IMPLEMENTED	= 501
+	HTTP_NOT_IMPLEMENTED	= 501,
+	HTTP_SERVICE_UNAVAILABLE = 503
+};
+
+
+/**
+ * @struct http_file_body
+ * @brief Body taken from a range of an open file, sent with sendfile(2).
+ *
+ * The descriptor is only read at explicit offsets, so its file position is
+ * irrelevant. @ref release (if set) is called once by
+ * @ref http_response_clear and gives the file back to its owner.
+ *
+ * Transports that can only send memory read the body piece by piece into
+ * @ref buffer instead (@ref http_response_file_next).
+ */
+struct http_file_body {
+	bool   enabled;				/**< true → the body is @ref http_response::content_length bytes of @ref fd. */
+	int    fd;					/**< Readable descriptor of the file. */
+	off_t  offset;				/**< Offset of the first body byte in the file. */
+	void (*release)(void *ctx);	/**< Releases the file (may be NULL). */
+	void  *ctx;					/**< Passed to @ref release. */
+	char  *buffer;				/**< Current piece (@ref HTTP_FILE_PIECE bytes, owned, allocated on first use). */
+	size_t piece_start;			/**< Body offset of the first byte in @ref buffer. */
+	size_t piece_len;			/**< Valid bytes in @ref buffer (0 before the first piece). */
+};
+
+
+/**
+ * @struct http_stream_body
+ * @brief Body generated piecewise by a producer while it is sent.
+ *
+ * Its length is not known up front: with @ref chunked every piece becomes
+ * one chunk and an empty chunk ends the body, otherwise (HTTP/1.0 clients)
+ * the body ends when the connection closes. Only one piece is held at a
+ * time, so memory stays constant whatever the length. @ref release (if set)
+ * is called once by @ref http_response_clear.
+ */
+struct http_stream_body {
+	bool     enabled;										/**< true → the body comes from @ref produce. */
+	bool     chunked;										/**< Set by the core: frame the pieces with chunked transfer coding. */
+	ssize_t (*produce)(void *ctx, void *buf, size_t len);	/**< Fills up to @p len bytes; returns the count, 0 at the end, -1 on error. */
+	void    (*release)(void *ctx);							/**< Releases the producer (may be NULL). */
+	void    *ctx;											/**< Passed to @ref produce and @ref release. */
+	char    *buffer;										/**< Piece buffer (owned, allocated on first use). */
+	char    *piece;											/**< Framed bytes of the current piece, inside @ref buffer. */
+	size_t   piece_len;										/**< Length of @ref piece (0 before the first piece). */
+	bool     finished;										/**< The producer ended; @ref piece is the last one. */
+};
+
+
+struct http_response;
+
+/**
+ * @struct http_body_sink
+ * @brief Receiver of the part of a request body that arrives after the handler returned.
+ *
+ * Returned by a handler in place of a response when it needs more of the
+ * body than had arrived. The core parks the request and hands every
+ * further piece to @ref consume as it is decoded, starting right behind
+ * the last byte the handler read; once the body is complete @ref finish
+ * fills the actual response. @ref release (if set) is called once at the
+ * end, or when the request is abandoned (client gone, timeout).
+ */
+struct http_body_sink {
+	bool  enabled;													/**< true → no response yet; feed the body to this sink. */
+	int (*consume)(void *ctx, const void *data, size_t len);		/**< Takes the next body piece; 0 on success, -1 to fail the request. */
+	int (*finish)(void *ctx, struct http_response *res);			/**< Fills the response at the end of the body; <0 on error. */
+	void (*release)(void *ctx);										/**< Releases the sink (may be NULL). */
+	void *ctx;														/**< Passed to all callbacks. */
 };
 
 
@@ -48,8 +146,11 @@ enum http_status{
  *    of length @ref extra_headers_count; each name/value must be NUL-terminated
  *    and must not contain CR/LF.
  *  - @ref body may be NULL or point to a buffer of length @ref content_length.
+ *    Alternatively @ref file supplies the body from a file (then @ref body is NULL),
+ *    or @ref stream generates it (then @ref body is NULL and @ref content_length 0).
  *  - @ref http_response_clear() will free @ref extra_headers and @ref body when
- *    the corresponding owned flags are set.
+ *    the corresponding owned flags are set, and release @ref file, @ref stream
+ *    and @ref sink.
  *    The struct itself is never freed by @ref http_response_clear().
  */
 struct http_response {
@@ -61,22 +162,102 @@ struct http_response {
     const void *body;					/**< Optional response body buffer (may be NULL). */
     size_t content_length;				/**< Length of @ref body in bytes (0 if none). */
 	bool body_owned;					/**< If true, clear() frees body. */
+	struct http_file_body file;			/**< File body (instead of @ref body), if enabled. */
+	struct http_stream_body stream;		/**< Generated body (instead of @ref body), if enabled. */
+	struct http_body_sink sink;			/**< Set by a handler still waiting for the request body (nothing else is set then). */
+	bool keep_alive;					/**< Set by the core: announce "Connection: keep-alive" instead of "close". */
 };
 
+/**
+ * @brief Serialize status line and headers of a response into a buffer.
+ *
+ * Produces exactly the bytes @ref http_send_response writes before the body
+ * (status line, Date, Content-Length, optional Content-Type, extra headers,
+ * "Connection: close" or "Connection: keep-alive" depending on
+ * @ref http_response::keep_alive, and the terminating empty line). The body
+ * is not copied. A generated body announces "Transfer-Encoding: chunked"
+ * instead of Content-Length, or no length at all if it is not chunked.
+ *
+ * No formatted printing is involved: status lines come preformatted from a
+ * table indexed by status code, Date from the once-per-second cache of
+ * @ref http_date_now, and every other field is copied in place.
+ *
+ * @param res          Http response struct to serialize (must not be NULL).
+ * @param headers      Destination buffer (must not be NULL).
+ * @param headers_cap  Capacity of @p headers in bytes.
+ *
+ * @return Number of bytes written into @p headers, or -1 if the headers do
+ *         not fit or on invalid arguments.
+ */
+ssize_t http_response_serialize_head(const struct http_response *res, char *headers, size_t headers_cap);
+
 /**
  * @brief Send a HTTP response over a socket file descriptor.
  * 
  * Writes a status line, Content-Length, optional Content-Type (if a body is
- * sent and a type is known), any extra headers, "Connection: close", CRLF,
- * and then the body if Content_length > 0.
+ * sent and a type is known), any extra headers, the Connection header, CRLF,
+ * and then the body if Content_length > 0. Head and body are gathered into
+ * a single writev(2); partial writes are resumed until everything is sent.
+ * A file body (@ref http_response::file) follows with sendfile(2).
+ * Generated bodies (@ref http_response::stream) are only sent by the core.
  *
  * @param fd                  Socket file descriptor.
  * @param res                 Http response struct to serialize (must not be NULL).
  *
- * @return 0 on success, -1 on error.
+ * @return 0 on success, -1 on error (EINVAL for a generated body).
  */
 int http_send_response(int fd, const struct http_response* res);
 
+/**
+ * @brief Send the next part of a response's file body with one sendfile(2).
+ *
+ * The file is read at its own offsets; the kernel copies it to @p fd
+ * without passing through user space.
+ *
+ * @param fd    Destination socket (may be non-blocking).
+ * @param res   Response with @ref http_file_body::enabled set (must not be NULL).
+ * @param sent  Body bytes already sent (less than @ref http_response::content_length).
+ *
+ * @return Bytes sent (> 0), or -1 with errno set (EAGAIN on a full
+ *         non-blocking socket, EIO if the file ended early).
+ */
+ssize_t http_response_send_file(int fd, const struct http_response *res, size_t sent);
+
+
+/**
+ * @brief Read the next piece of a file body into memory.
+ *
+ * For transports that can only send memory (e.g. io_uring sends). Reads up
+ * to @ref HTTP_FILE_PIECE bytes starting at body offset @p sent into
+ * @ref http_file_body::buffer, which is reused for every piece, so memory
+ * stays constant whatever the file size.
+ *
+ * @param res   Response with @ref http_file_body::enabled set (must not be NULL).
+ * @param sent  Body bytes already sent (less than @ref http_response::content_length).
+ *
+ * @return Bytes in the piece, or -1 with errno set (EINVAL, ENOMEM, a read
+ *         error, or EIO if the file ended early).
+ */
+ssize_t http_response_file_next(struct http_response *res, size_t sent);
+
+
+/**
+ * @brief Fetch the next piece of a generated body from its producer.
+ *
+ * Replaces @ref http_stream_body::piece by the framed piece: its chunk
+ * size line, the data and CRLF, or the terminating empty chunk once the
+ * producer reports the end (which sets @ref http_stream_body::finished).
+ * Without @ref http_stream_body::chunked the piece is the bare data, and
+ * empty at the end.
+ *
+ * @param res   Response with @ref http_stream_body::enabled set and not yet finished.
+ *
+ * @return Length of the new piece (0 only for the end of an unchunked body),
+ *         or -1 if the producer failed or no buffer could be allocated.
+ */
+ssize_t http_response_stream_next(struct http_response *res);
+
+
 /**
  * @brief Send a plain text response over a socket file descriptor.
  *
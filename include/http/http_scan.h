@@ -0,0 +1,82 @@
+#ifndef HTTP_SCAN_H
+#define HTTP_SCAN_H
+
+/**
+ * @file http_scan.h
+ * @brief Vectorized, resumable framing of request heads.
+ *
+ * Finding "\r\n" is the innermost loop of request parsing. The scanner
+ * compares 32 (AVX2) or 16 (SSE2) bytes per instruction against '\r' and
+ * only inspects the few positions that match; the implementation is picked
+ * once at runtime from the CPU's features, with a portable fallback on other
+ * architectures.
+ *
+ * A @ref http_head_scan remembers how far a buffer has been examined, so a
+ * head that arrives in many small segments is scanned exactly once in
+ * total instead of from the start after every read. While looking for the
+ * blank line that ends the head it also records where every line ends,
+ * which lets the parser split the head without searching again.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "http_request.h"
+
+/**
+ * @def HTTP_SCAN_MAX_LINES
+ * @brief Line ends recorded per head: the request line plus @ref HTTP_MAX_HEADERS header lines.
+ */
+#define HTTP_SCAN_MAX_LINES (HTTP_MAX_HEADERS + 1)
+
+
+/**
+ * @struct http_head_scan
+ * @brief Progress of the search for the end of one request head.
+ *
+ * Reset it with @ref http_head_scan_reset whenever the scanned buffer
+ * starts over (i.e. for the next request).
+ */
+struct http_head_scan {
+	size_t 	 offset;						/**< Bytes of the buffer already examined. */
+	size_t 	 line_start;					/**< Index of the first byte of the current line. */
+	uint32_t line_count;					/**< Lines terminated so far (may exceed @ref HTTP_SCAN_MAX_LINES). */
+	uint32_t line_ends[HTTP_SCAN_MAX_LINES];/**< Index of the CR ending each of the first lines. */
+};
+
+
+/**
+ * @brief Prepare @p scan for a new head.
+ */
+void http_head_scan_reset(struct http_head_scan *scan);
+
+
+/**
+ * @brief Continue the search for "\r\n\r\n" in @p buffer.
+ *
+ * Only the bytes beyond @ref http_head_scan::offset are examined; call it
+ * again with the same (possibly longer or moved) buffer after more bytes
+ * arrived.
+ *
+ * @param scan 		Scan state of this buffer.
+ * @param buffer 	Bytes received so far (from the start of the head).
+ * @param len 		Number of valid bytes in @p buffer.
+ *
+ * @return int 		Index of the first CR of "\r\n\r\n", or -1 if not (yet) present.
+ */
+int http_head_scan(struct http_head_scan *scan, const char *buffer, size_t len);
+
+
+/**
+ * @brief Index of the first '\r' in @p buffer.
+ *
+ * @return size_t 	Index of the CR, or @p len if there is none.
+ */
+size_t http_scan_cr(const char *buffer, size_t len);
+
+
+/**
+ * @brief Name of the implementation @ref http_scan_cr dispatches to ("avx2", "sse2" or "scalar").
+ */
+const char *http_scan_impl(void);
+
+#endif /* HTTP_SCAN_H */
@@ -171,10 +171,12 @@ int redirect_add(struct redirect_registry *registry, const char *from_path, cons
  *
  * @param registry Registry to query (must not be NULL).
  * @param path     Lookup path (NUL-terminated).
+ * @param path_len Length of @p path.
  * @param result   Output structure to fill on success (must not be NULL).
  *
  * @return 0 on match, 1 on no match, -1 on error.
  */
-int redirect_lookup(struct redirect_registry *registry, const char *path, struct redirect_result *result);
+int redirect_lookup(struct redirect_registry *registry, const char *path, size_t path_len,
+					struct redirect_result *result);
 
 #endif /* REDIRECT_REGISTRY_H */
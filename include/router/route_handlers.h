@@ -11,13 +11,22 @@
  * The adapter/core serializes the response and manages ownership as documented.
  */
 
+/**
+ * @def ECHO_MAX_PAYLOAD
+ * @brief Longest payload the echo route sends back; the rest is not read.
+ */
+#define ECHO_MAX_PAYLOAD 65536
+
 /**
  * @brief Echo route.
  *
  * Behavior:
- * - If the request has a body (`body_len > 0`): the response echoes the body
- *   unchanged (zero-copy). `res->media_type` is taken from `req->content_type`.
- *   Ownership is **not** transferred (`payload_owned = false`).
+ * - If the request has a payload: the response echoes it unchanged, up to
+ *   @ref ECHO_MAX_PAYLOAD bytes. A payload that had not fully arrived yet is
+ *   read through the request's body stream as far as it has arrived; the
+ *   handler then returns a payload consumer that collects the rest and
+ *   answers once it is complete. `res->media_type` is taken from
+ *   `req->media_type`. The echoed bytes are a heap copy (`payload_owned = true`).
  * - If the request has no body: the response is a small text line
  *   `"<METHOD> <path>"`. A heap buffer is allocated, media is
  *   `APP_MEDIA_TEXT`, and ownership **is** transferred (`payload_owned = true`).
@@ -29,13 +38,13 @@
  *
  * Status:
  * - On success paths the handler sets `res->status = APP_OK`.
- * - For client errors it sets `APP_BAD_REQUEST` and still returns 0.
+ * - For client errors (including a payload that could not be read) it sets
+ *   `APP_BAD_REQUEST` and still returns 0.
  *
  * Ownership & lifetime:
- * - Zero-copy branch: `res->payload` points into `req->body` (non-owning). The
- *   caller must ensure the request buffer remains valid until the response is sent.
- * - Formatted branch: buffer is allocated (e.g., `calloc`) and `payload_owned`
- *   is set to true so the framework can `free()` it after sending.
+ * - Both branches allocate the payload and set `payload_owned` to true so the
+ *   framework can `free()` it after sending; the request payload is only valid
+ *   during the call.
  *
  * @param req  [in]  Normalized app request (must not be NULL).
  * @param res  [out] App response to populate (must not be NULL).
@@ -47,4 +56,30 @@
  */
 int handle_route_echo(const struct app_request *req, struct app_response *res);
 
+
+/**
+ * @def COUNT_MAX
+ * @brief Largest count the count route produces.
+ */
+#define COUNT_MAX 1000000
+
+/**
+ * @brief Count route: streams the numbers 1..n, one per line.
+ *
+ * `n` comes from the query parameter of that name (default 10, at most
+ * @ref COUNT_MAX). The text is generated piecewise through
+ * @ref app_response::stream while it is sent, so the response takes the
+ * same memory for any n and its first lines leave before the last are made.
+ *
+ * Status:
+ * - `APP_OK` with `APP_MEDIA_TEXT`;
+ * - `APP_BAD_REQUEST` (returns 0) if `n` is not a number in range.
+ *
+ * @param req  [in]  Normalized app request (must not be NULL).
+ * @param res  [out] App response to populate (must not be NULL).
+ *
+ * @return 0 if handled, -1 on allocation failure.
+ */
+int handle_route_count(const struct app_request *req, struct app_response *res);
+
 #endif /* ROUTE_HANDLERS_H */
@@ -41,6 +41,7 @@ typedef int (*api_route_handler)(const struct app_request *req,
 struct api_route {
     enum app_method method;
     const char *path;
+    size_t path_len;
     api_route_handler handler;
 };
 
@@ -56,6 +57,7 @@ struct api_route {
  */
 struct api_router {
     const char       *prefix;        /**< Path prefix (defaults to "/api"). */
+    size_t            prefix_len;    /**< Length of @c prefix. */
     struct api_route *routes;        /**< Internal route registry array */
     size_t            route_count;   /**< Number of active entries. */
     size_t            max_routes;    /**< Total capacity of @c routes. */
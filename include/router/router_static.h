@@ -10,8 +10,9 @@
  * @brief Simple static-file router using the filesystem abstraction.
  *
  * Matches requests by URL prefix and serves files from a given filesystem root.
- * Only GET is handled. Results are returned as app_response with payload
- * allocated on the heap (payload_owned = true).
+ * Only GET is handled. If the filesystem exposes native descriptors, a file
+ * is returned as the open file itself (app_response::file) and sent without
+ * copying; otherwise its content is read into a heap payload (payload_owned = true).
  */
 
 
@@ -21,9 +22,10 @@
  */
 struct static_router {
   const char *prefix;		/**< Path prefix (defaults to "/public"). */
+  size_t prefix_len;		/**< Length of @c prefix. */
   struct fs *vfs;			/**< Filesystem abstraction (already initialized) */
   const char *index_name;	/**< Default file for directories (defaults to "index.html") */
-  size_t max_bytes;			/**< max file size to read into memory (0 = no limit) */
+  size_t max_bytes;			/**< max file size to serve (0 = no limit) */
 };
 
 
@@ -1,8 +1,41 @@
 #ifndef SERVER_H
 #define SERVER_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+struct iovec;
+
+
+/**
+ * @brief Socket options of the listeners and of accepted connections.
+ *
+ * A zeroed block keeps the kernel defaults. Options the platform does not
+ * know are skipped; options the kernel rejects are logged and ignored.
+ */
+struct server_listener_opts {
+    int  defer_accept_s;    /**< TCP_DEFER_ACCEPT: report a connection only once its first data arrived, waiting up to this many seconds (0 → off; Linux) */
+    int  fastopen_qlen;     /**< TCP_FASTOPEN: queue length for pending TFO handshakes (0 → off) */
+    bool nodelay;           /**< TCP_NODELAY on accepted connections */
+};
+
+/**
+ * @brief Admission control of the event-loop modes.
+ *
+ * The limits are shared out evenly among the workers. A worker at one of its
+ * limits takes no further connections until it is below again: new clients
+ * wait in the kernel's accept queue (see @ref server_config::backlog), or,
+ * with @ref reject_response set, are answered with it and closed right away.
+ * Connections already admitted are not affected.
+ */
+struct server_limits {
+    unsigned    max_conns;           /**< Open connections (0 → unlimited) */
+    unsigned    max_requests;        /**< Requests in flight as reported by @ref server_conn_handler::in_flight (0 → unlimited) */
+    const char *reject_response;     /**< Bytes sent to connections refused at a limit (NULL → pause accepting instead) */
+    size_t      reject_response_len; /**< Length of @ref reject_response */
+};
+
 /**
  * @brief Server configuration structure.
  *
@@ -11,9 +44,98 @@
 struct server_config {
     const char *host;   /**< IP address or hostname */
     uint16_t    port;   /**< Port number to listen on */
-    int         backlog;/**< Maximum number of queued connections */
+    int         backlog;/**< Maximum number of queued connections (0 → SOMAXCONN) */
+    unsigned    workers;/**< Worker threads, each with its own SO_REUSEPORT listener (0 or 1 → single-threaded) */
+    int         idle_timeout_ms; /**< Event-loop modes: close connections without I/O for this long unless the handler sets deadlines (0 → never) */
+    char *const *upgrade_argv;   /**< Command line exec'd by @ref server_upgrade; argv[0] is resolved at startup: a path against the working directory, a bare name as the running executable (NULL → no upgrades) */
+    struct server_listener_opts listener; /**< Listener tuning */
+    struct server_limits limits;          /**< Event-loop modes: admission control */
 };
 
+/**
+ * @brief Per-connection callbacks for the event-loop mode.
+ *
+ * Instead of handing a blocking socket to a single callback, the event loop
+ * keeps one state object per connection and calls @ref on_ready whenever the
+ * socket is ready. Readiness is expressed with the portable poll(2) flags
+ * (POLLIN, POLLOUT, POLLHUP, POLLERR) so implementations stay independent of
+ * the underlying notification mechanism.
+ *
+ * Accepted sockets are switched to non-blocking mode before @ref open is called.
+ */
+struct server_conn_handler {
+    /**
+     * Create per-connection state for @p client_fd.
+     * @return State pointer, or NULL to reject (the socket is closed).
+     */
+    void *(*open)(int client_fd, void *context);
+
+    /**
+     * Make progress after a readiness event.
+     * @param conn    State returned by @ref open.
+     * @param revents Reported readiness (POLLIN/POLLOUT/POLLHUP/POLLERR).
+     * @return Events to wait for next (POLLIN and/or POLLOUT), or 0 to close the connection.
+     */
+    int (*on_ready)(void *conn, int revents, void *context);
+
+    /**
+     * Release per-connection state. The server closes the socket afterwards.
+     */
+    void (*close)(void *conn, void *context);
+
+    /**
+     * Completion-mode input (optional, required by @ref server_start_uring).
+     * The server already received @p len bytes into its own buffer; a length
+     * of 0 signals EOF. The data is only valid during the call.
+     * @return Events the connection waits for next (POLLIN to keep receiving,
+     *         POLLOUT once output is pending), or 0 to close the connection.
+     */
+    int (*on_data)(void *conn, const void *data, size_t len, void *context);
+
+    /**
+     * Completion-mode output (optional, required by @ref server_start_uring).
+     * Describe the unsent output as at most @p iov_max segments. The memory
+     * must stay valid until @ref output_sent reports it as written.
+     * @return Number of segments filled, 0 if nothing is pending.
+     */
+    int (*pending_output)(void *conn, struct iovec *iov, int iov_max, void *context);
+
+    /**
+     * Completion-mode output (optional, required by @ref server_start_uring).
+     * Account for @p n bytes of the pending output that were sent.
+     * @return Events to wait for next (POLLOUT while output remains), or 0
+     *         when the connection is finished and should be closed.
+     */
+    int (*output_sent)(void *conn, size_t n, void *context);
+
+    /**
+     * The server is draining (optional). Finish the exchange in progress
+     * without starting another one, e.g. answer the current request with
+     * "Connection: close". Without this callback, connections are served
+     * until the client closes them or they time out.
+     * @return Events to wait for next, or 0 if the connection is idle and
+     *         can be closed right away.
+     */
+    int (*drain)(void *conn, void *context);
+
+    /**
+     * Event-loop modes: when the connection should be closed (optional).
+     * Queried after every call into the connection, so the handler can give
+     * each phase its own limit. Without this callback, a connection is
+     * closed after @ref server_config::idle_timeout_ms without I/O.
+     * @return CLOCK_MONOTONIC time in milliseconds, or -1 for no deadline.
+     */
+    int64_t (*deadline)(void *conn, void *context);
+
+    /**
+     * Event-loop modes: requests received on the connection but not yet
+     * fully answered (optional). Queried after every call into the
+     * connection and summed up for @ref server_limits::max_requests.
+     */
+    unsigned (*in_flight)(void *conn, void *context);
+};
+
+
 /**
  * @brief Start the server accept loop.
  *
@@ -27,15 +149,99 @@ struct server_config {
  *
  * @return 0 on success, -1 on error.
  *
+ * With @ref server_config::workers > 1, every worker thread opens its own
+ * listening socket with SO_REUSEPORT and runs this loop independently; the
+ * kernel distributes new connections across the workers. @p client_handler
+ * and @p context are then shared by all workers and must be thread-safe.
+ *
  * @note The function typically blocks until @ref server_stop() is called or an error occurs.
  */
 int server_start(const struct server_config *config, int (*client_handler)(int client_fd, void *context), void *context);
 
 /**
- * @brief Stop the server.
+ * @brief Start the server in event-loop mode.
+ *
+ * Opens a non-blocking listening socket and multiplexes all connections in a
+ * single thread (epoll on Linux). Each accepted connection gets its own state
+ * object created by @p handler->open and is driven by readiness events, so a
+ * client that sends its request slowly does not block any other client.
  *
- * Exits the accept loop. Any open sockets are closed.
+ * On platforms without epoll, connections are served one after another with
+ * poll(2) waits, using the same callbacks.
+ *
+ * @ref server_config::workers is honored as in @ref server_start: each worker
+ * runs its own loop on its own SO_REUSEPORT listener.
+ *
+ * @param config   Pointer to server configuration structure (host, port, backlog).
+ * @param handler  Connection callbacks, all members must be set.
+ * @param context  Opaque pointer forwarded to every callback (may be NULL).
+ *
+ * @return 0 on success, -1 on error.
+ */
+int server_start_event_loop(const struct server_config *config, const struct server_conn_handler *handler,
+                            void *context);
+
+
+/**
+ * @brief Start the server with the io_uring backend (Linux only).
+ *
+ * Completion-based variant of @ref server_start_event_loop. Each worker owns
+ * one io_uring instance and keeps these operations in flight:
+ *
+ *  - one multishot accept on its listener, so a single submission keeps
+ *    producing new connections;
+ *  - one multishot recv per connection that takes buffers from a
+ *    kernel-managed provided-buffer ring, so idle connections pin no memory;
+ *  - linked sends for the segments returned by @p handler->pending_output
+ *    (e.g. response head and body), issued together.
+ *
+ * Submissions and completions are batched into one io_uring_enter(2) per loop
+ * iteration, so a request costs a handful of system calls at most instead of
+ * one per read and write.
+ *
+ * If io_uring is unavailable (old kernel, seccomp, io_uring_disabled), the
+ * server logs the reason and falls back to @ref server_start_event_loop.
+ *
+ * @param config   Pointer to server configuration structure (host, port, backlog).
+ * @param handler  Connection callbacks; open, close, on_data, pending_output and
+ *                 output_sent must be set (on_ready is needed for the fallback).
+ * @param context  Opaque pointer forwarded to every callback (may be NULL).
+ *
+ * @return 0 on success, -1 on error.
+ */
+int server_start_uring(const struct server_config *config, const struct server_conn_handler *handler,
+                       void *context);
+
+
+/**
+ * @brief Drain and stop the running server.
+ *
+ * Every worker stops accepting, hands its open connections to
+ * @ref server_conn_handler::drain and returns once they are closed; the
+ * start function then closes its listeners and returns 0. In blocking mode
+ * the connection being served is finished first.
+ *
+ * Only sends a command to the server's control thread, so it is safe to call
+ * from a signal handler. Does nothing if no server is running.
  */
 void server_stop(void);
 
+
+/**
+ * @brief Hand the listening sockets to a new process, then drain.
+ *
+ * Runs @ref server_config::upgrade_argv in a child process and passes it
+ * every worker's listener over a Unix socket (SCM_RIGHTS); the descriptor
+ * number of that socket is in the NAPOLEON_UPGRADE_FD environment variable.
+ * A server started with that variable set adopts the listeners instead of
+ * binding new ones (one worker per listener) and confirms the takeover. Only
+ * then does this process drain as with @ref server_stop, so the listening
+ * sockets never close and no connection is refused during a deploy.
+ *
+ * If the new process fails to start or to confirm, this server keeps running.
+ *
+ * Safe to call from a signal handler. Does nothing if no server is running.
+ */
+void server_upgrade(void);
+
 #endif /* SERVER_H */
@@ -0,0 +1,112 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+/**
+ * @file timer_wheel.h
+ * @brief Hashed timer wheel for per-connection deadlines.
+ *
+ * Time is cut into ticks of @ref timer_wheel::tick_ms; a timer hangs in the
+ * slot of the tick it fires in (modulo @ref TIMER_WHEEL_SLOTS). Scheduling,
+ * rescheduling and cancelling are O(1), and an event loop only ever looks at
+ * the slots of ticks that have passed, so a large number of idle connections
+ * costs nothing until their deadlines come up. Deadlines further away than
+ * one revolution simply stay in their slot for another round.
+ *
+ * Timers fire at most one tick late, never early.
+ *
+ * The wheel is intrusive: embed a @ref timer_node in the object to time and
+ * map the node returned by @ref timer_wheel_expired back to it. All times
+ * are CLOCK_MONOTONIC milliseconds as returned by @ref timer_now_ms.
+ *
+ * @note A wheel is not thread-safe. Use one wheel per event loop.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @def TIMER_WHEEL_SLOTS
+ * @brief Number of slots (power of two).
+ */
+#define TIMER_WHEEL_SLOTS 1024
+
+
+/**
+ * @struct timer_node
+ * @brief A timer embedded in the timed object.
+ *
+ * Zero-initialized means not scheduled.
+ */
+struct timer_node {
+    struct timer_node *prev;    /**< Previous timer in the slot. */
+    struct timer_node *next;    /**< Next timer in the slot. */
+    int64_t            expires; /**< Tick the timer fires in. */
+    bool               linked;  /**< Scheduled in a wheel. */
+};
+
+
+/**
+ * @struct timer_wheel
+ * @brief Slots of pending timers plus a bitmap of the non-empty ones.
+ */
+struct timer_wheel {
+    struct timer_node *slots[TIMER_WHEEL_SLOTS];        /**< Timers by tick modulo the slot count. */
+    uint64_t           used[TIMER_WHEEL_SLOTS / 64];    /**< Bit set for every non-empty slot. */
+    int64_t            current;                         /**< Next tick to process. */
+    unsigned           tick_ms;                         /**< Length of one tick. */
+    size_t             count;                           /**< Scheduled timers. */
+};
+
+
+/**
+ * @brief Current CLOCK_MONOTONIC time in milliseconds.
+ */
+int64_t timer_now_ms(void);
+
+
+/**
+ * @brief Prepare an empty wheel.
+ *
+ * @param wheel    Wheel to initialize (must not be NULL).
+ * @param tick_ms  Resolution in milliseconds (0 → 1).
+ * @param now_ms   Current time.
+ */
+void timer_wheel_init(struct timer_wheel *wheel, unsigned tick_ms, int64_t now_ms);
+
+
+/**
+ * @brief Schedule @p node to fire at @p deadline_ms, replacing an earlier deadline.
+ *
+ * A deadline in the past fires on the next @ref timer_wheel_expired call.
+ */
+void timer_wheel_schedule(struct timer_wheel *wheel, struct timer_node *node, int64_t deadline_ms);
+
+
+/**
+ * @brief Remove @p node from the wheel (no-op if not scheduled).
+ */
+void timer_wheel_cancel(struct timer_wheel *wheel, struct timer_node *node);
+
+
+/**
+ * @brief Pop one timer that is due at @p now_ms.
+ *
+ * Call repeatedly until it returns NULL. The returned node is no longer
+ * scheduled.
+ *
+ * @return Expired node, or NULL if none is due.
+ */
+struct timer_node *timer_wheel_expired(struct timer_wheel *wheel, int64_t now_ms);
+
+
+/**
+ * @brief Milliseconds until the next non-empty slot comes due.
+ *
+ * Suitable as the timeout of poll(2)-style waits.
+ *
+ * @return Delay (0 if a timer is already due), or -1 if no timer is scheduled.
+ */
+int timer_wheel_wait_ms(const struct timer_wheel *wheel, int64_t now_ms);
+
+#endif /* TIMER_WHEEL_H */
@@ -0,0 +1,159 @@
+#ifndef URING_H
+#define URING_H
+
+/**
+ * @file uring.h
+ * @brief Minimal io_uring wrapper on top of the raw Linux system calls.
+ *
+ * Provides just what the server's io_uring backend needs: ring setup and
+ * teardown, SQE acquisition, batched submission, CQE iteration and a
+ * provided-buffer ring (kernel-selected receive buffers). There is no
+ * dependency on liburing.
+ *
+ * Only available on Linux; on other platforms every function fails.
+ *
+ * @note A ring is not thread-safe. Use one ring per thread.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+
+/**
+ * @struct uring
+ * @brief Mapped submission and completion queues of one io_uring instance.
+ */
+struct uring {
+    int       fd;           /**< Ring file descriptor (-1 if not set up). */
+
+    unsigned *sq_head;      /**< Kernel-owned SQ head. */
+    unsigned *sq_tail;      /**< Shared SQ tail. */
+    unsigned *sq_mask;      /**< SQ index mask. */
+    unsigned *sq_array;     /**< SQ index array. */
+    struct io_uring_sqe *sqes; /**< SQE array. */
+    unsigned  sq_entries;   /**< Number of SQEs. */
+    unsigned  sqe_tail;     /**< Locally prepared (not yet published) tail. */
+
+    unsigned *cq_head;      /**< Shared CQ head. */
+    unsigned *cq_tail;      /**< Kernel-owned CQ tail. */
+    unsigned *cq_mask;      /**< CQ index mask. */
+    struct io_uring_cqe *cqes; /**< CQE array. */
+
+    void     *sq_ring_ptr;  /**< Mapping of the SQ ring. */
+    size_t    sq_ring_size; /**< Size of @ref sq_ring_ptr. */
+    void     *cq_ring_ptr;  /**< Mapping of the CQ ring (may equal @ref sq_ring_ptr). */
+    size_t    cq_ring_size; /**< Size of @ref cq_ring_ptr. */
+    size_t    sqes_size;    /**< Size of the @ref sqes mapping. */
+};
+
+
+/**
+ * @struct uring_buf_ring
+ * @brief Group of equally sized receive buffers the kernel picks from.
+ *
+ * Used with IOSQE_BUFFER_SELECT: the kernel fills the next free buffer and
+ * reports its id in the CQE; the application hands it back with
+ * @ref uring_buf_ring_recycle once it has consumed the data.
+ */
+struct uring_buf_ring {
+    struct io_uring_buf_ring *ring;     /**< Shared ring of buffer descriptors. */
+    char     *buffers;                  /**< Backing memory (entries * buf_size bytes). */
+    size_t    ring_size;                /**< Size of the @ref ring mapping. */
+    unsigned  entries;                  /**< Number of buffers (power of two). */
+    unsigned  buf_size;                 /**< Size of each buffer. */
+    uint16_t  bgid;                     /**< Buffer group id used in SQEs. */
+    uint16_t  tail;                     /**< Local copy of the ring tail. */
+};
+
+
+/**
+ * @brief Create an io_uring instance and map its queues.
+ *
+ * @param ring     Ring to initialize (must not be NULL).
+ * @param entries  Requested number of submission queue entries.
+ *
+ * @return 0 on success, -1 on error (errno set, e.g. ENOSYS or EPERM).
+ */
+int uring_init(struct uring *ring, unsigned entries);
+
+
+/**
+ * @brief Unmap the queues and close the ring.
+ *
+ * @param ring Ring to tear down (may be partially initialized).
+ */
+void uring_exit(struct uring *ring);
+
+
+/**
+ * @brief Get a zeroed SQE to fill.
+ *
+ * If the submission queue is full, prepared entries are submitted first.
+ *
+ * @return Pointer to the SQE, or NULL if no entry could be made available.
+ */
+struct io_uring_sqe *uring_get_sqe(struct uring *ring);
+
+
+/**
+ * @brief Submit all prepared SQEs and wait for at least @p wait_nr completions.
+ *
+ * One io_uring_enter(2) call covers both, which is what keeps the number of
+ * system calls per request low.
+ *
+ * @return Number of SQEs submitted (>= 0), or -1 on error (errno set).
+ */
+int uring_submit_and_wait(struct uring *ring, unsigned wait_nr);
+
+
+/**
+ * @brief Return the next unconsumed CQE without blocking.
+ *
+ * @return Pointer to the CQE, or NULL if the completion queue is empty.
+ */
+struct io_uring_cqe *uring_peek_cqe(struct uring *ring);
+
+
+/**
+ * @brief Mark the CQE returned by @ref uring_peek_cqe as consumed.
+ */
+void uring_cqe_seen(struct uring *ring);
+
+
+/**
+ * @brief Allocate and register a provided-buffer ring.
+ *
+ * @param ring      Initialized ring.
+ * @param bufs      Buffer ring to initialize (must not be NULL).
+ * @param bgid      Buffer group id.
+ * @param entries   Number of buffers (power of two, <= 32768).
+ * @param buf_size  Size of each buffer in bytes.
+ *
+ * @return 0 on success, -1 on error (e.g. kernel without buffer rings).
+ */
+int uring_buf_ring_init(struct uring *ring, struct uring_buf_ring *bufs, uint16_t bgid,
+                        unsigned entries, unsigned buf_size);
+
+
+/**
+ * @brief Address of buffer @p bid.
+ */
+void *uring_buf_ring_get(struct uring_buf_ring *bufs, uint16_t bid);
+
+
+/**
+ * @brief Return buffer @p bid to the kernel for reuse.
+ */
+void uring_buf_ring_recycle(struct uring_buf_ring *bufs, uint16_t bid);
+
+
+/**
+ * @brief Unregister and free a provided-buffer ring.
+ */
+void uring_buf_ring_free(struct uring *ring, struct uring_buf_ring *bufs);
+
+#endif /* URING_H */
@@ -16,10 +16,11 @@ struct posix_file {
 /**
  * @brief Build an absolute filesystem path under @p vfs->root and forbid ".." traversal.
  *
- * Strips a leading '/' from @p path, rejects any path that contains a "/.."
- * component or a ".." component at the beginning, and then joins
- * @p vfs->root with the (now relative) @p path. The resulting string is
- * heap-allocated and returned via @p real_path_out.
+ * Strips a leading '/' from @p path, rejects any path with a ".." segment
+ * and then joins @p vfs->root with the (now relative) @p path. Callers pass
+ * canonical paths (see @ref fs_ops), so the check only guards against a
+ * caller that does not; it is a single pass over the path. The resulting
+ * string is heap-allocated and returned via @p real_path_out.
  *
  * Ownership: the caller owns *@p real_path_out and must free() it.
  *
@@ -38,12 +39,10 @@ static int resolve_under_root(struct fs *vfs, const char *path, char **real_path
 	if(path[0]=='/') path++;
 	size_t path_len = strlen(path);
 
-	if(path_len >= 2){
-		if (strncmp(path, "..", 2) == 0) return FS_INVALID;
-		for(size_t i=0; i+2<path_len; i++){
-			if(path[i] == '/' && path[i+1] == '.' && path[i+2] == '.'){
-				return FS_INVALID;
-			}
+	for(size_t i = 0; i + 1 < path_len; i++){
+		if((i == 0 || path[i-1] == '/') && path[i] == '.' && path[i+1] == '.'
+		   && (i + 2 == path_len || path[i+2] == '/')){
+			return FS_INVALID;
 		}
 	}
 	bool need_slash = (vfs->root_len > 0 && vfs->root[vfs->root_len-1] != '/');
@@ -146,6 +145,20 @@ static int posix_seek(struct fs_file *file, uint64_t offset){
 }
 
 
+/**
+ * @brief Return the descriptor of an open file.
+ *
+ * @param file  File handle (non-NULL).
+ *
+ * @return The descriptor, FS_INVALID on bad arguments or a closed file.
+ */
+static int posix_native_fd(struct fs_file *file){
+	if(!file) return FS_INVALID;
+    struct posix_file *pf = (struct posix_file*)file;
+	return pf->fd < 0 ? FS_INVALID : pf->fd;
+}
+
+
 /**
  * @brief Close an open file and free the posix file struct.
  *
@@ -177,6 +190,7 @@ static const struct fs_file_ops posix_file_ops = {
     .read_some  = posix_read_some,
     .read_all   = posix_read_all,
     .seek  		= posix_seek,
+    .native_fd	= posix_native_fd,
     .close 		= posix_close,
 };
 
@@ -208,8 +222,9 @@ static int posix_stat(struct fs *vfs, const char *path, struct fs_stat *stat_out
 	int lstat_ret = 0;
     lstat_ret = lstat(real_path, &s_stat);
 	if(lstat_ret < 0){
-		if(errno == ENOENT || errno == ENOTDIR) return FS_NOT_FOUND;
+		int lstat_errno = errno;
 		free(real_path);
+		if(lstat_errno == ENOENT || lstat_errno == ENOTDIR) return FS_NOT_FOUND;
 		return FS_ERROR;
 	}
 
@@ -288,7 +303,7 @@ static int posix_open(struct fs *vfs, const char *path, struct fs_file **file_ou
 /**
  * @brief Create a directory relative to the configured filesystem root.
  *
- * Resolves @p path under @p vfs->root (rejecting any traversal outside the root)
+ * Resolves @p path (canonical, see @ref fs_ops) under @p vfs->root
  * and calls mkdir(2) with mode @c 0755. When @p recursive is true, this behaves
  * like @c mkdir -p: all missing parent components are created in order and
  * existing components (EEXIST) are treated as success. EINTR is retried.
@@ -304,9 +319,6 @@ static int posix_open(struct fs *vfs, const char *path, struct fs_file **file_ou
  * @return FS_OK        on success (including when the directory already exists).
  * 		   FS_INVALID   on bad arguments or when path resolution rejects traversal.
  * 		   FS_ERROR     on other failures from resolve_under_root() or mkdir(2).
- *
- * @note Path resolution is performed by resolve_under_root(), which prevents
- *       ".." traversal from escaping @p vfs->root.
  */ 
 static int posix_mkdir(struct fs *vfs, const char *path, bool recursive){
     char *real_path = NULL;
@@ -355,8 +367,8 @@ cleanup:
  *  - `stat` via `lstat(2)` (path resolved under the configured root)
  *  - `open` via `open(2)` with `O_RDONLY | O_CLOEXEC`
  *
- * Path resolution is constrained to the configured root (see
- * resolve_under_root) to mitigate directory traversal.
+ * Paths are joined onto the configured root (see resolve_under_root);
+ * callers pass canonical paths, and ".." segments are rejected regardless.
  *
  * @note This object has internal linkage (`static`) and immutable contents.
  *       Obtain a pointer with get_fs_ops(). The pointer is valid for the
@@ -0,0 +1,325 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include "../include/access_log.h"
+
+
+/**
+ * @def ACCESS_LOG_RING_SIZE
+ * @brief Records per thread ring (power of two).
+ */
+#define ACCESS_LOG_RING_SIZE 1024
+
+/**
+ * @def ACCESS_LOG_MAX_THREADS
+ * @brief Producing threads with a ring; further threads log nothing.
+ */
+#define ACCESS_LOG_MAX_THREADS 2048
+
+/**
+ * @def ACCESS_LOG_BATCH
+ * @brief Size of the writer's text buffer; a full buffer is written at once.
+ */
+#define ACCESS_LOG_BATCH 65536
+
+/**
+ * @def ACCESS_LOG_LINE_MAX
+ * @brief Upper bound of one formatted line.
+ */
+#define ACCESS_LOG_LINE_MAX 256
+
+
+/**
+ * @struct access_log_ring
+ * @brief Single-producer/single-consumer queue of one thread's records.
+ *
+ * @ref tail is only written by the producer and @ref head only by the
+ * writer; each side publishes its index with a release store and reads the
+ * other one with an acquire load. The indices run freely and are masked on
+ * access.
+ */
+struct access_log_ring {
+	struct access_log_record records[ACCESS_LOG_RING_SIZE];	/**< Slots. */
+	uint32_t 				 head;		/**< Next record to write out (writer). */
+	uint32_t 				 tail;		/**< Next free slot (producer). */
+	uint64_t 				 dropped;	/**< Records lost to a full ring since the last report. */
+};
+
+
+/**
+ * @struct access_log_state
+ * @brief The process-wide log.
+ */
+struct access_log_state {
+	struct access_log_config config;		/**< Settings of the running log. */
+	pthread_t 				 thread;		/**< Writer thread. */
+	bool 					 running;		/**< Producers may submit (atomic). */
+	bool 					 stopping;		/**< The writer should flush and exit (atomic). */
+	unsigned 				 generation;	/**< Incremented by every start; invalidates thread rings. */
+	struct access_log_ring  *rings[ACCESS_LOG_MAX_THREADS]; /**< Registered rings (atomic pointers). */
+	unsigned 				 ring_count;	/**< Slots of @ref rings handed out (atomic). */
+};
+
+static struct access_log_state log_state;
+
+/** @brief Ring of the calling thread (valid if @ref local_generation matches). */
+static __thread struct access_log_ring *local_ring;
+/** @brief Generation @ref local_ring was registered in. */
+static __thread unsigned local_generation;
+/** @brief Sampling counter of the calling thread. */
+static __thread unsigned local_sample;
+
+
+/**
+ * @brief Return the calling thread's ring, registering one on first use.
+ *
+ * @return Ring, or NULL if the registry is full or allocation failed.
+ */
+static struct access_log_ring *thread_ring(void){
+	unsigned generation = __atomic_load_n(&log_state.generation, __ATOMIC_ACQUIRE);
+	if(local_generation == generation) return local_ring;
+
+	local_generation = generation;
+	local_ring = NULL;
+
+	unsigned slot = __atomic_fetch_add(&log_state.ring_count, 1, __ATOMIC_ACQ_REL);
+	if(slot >= ACCESS_LOG_MAX_THREADS) return NULL;
+
+	struct access_log_ring *ring = calloc(1, sizeof(struct access_log_ring));
+	if(!ring) return NULL;
+	__atomic_store_n(&log_state.rings[slot], ring, __ATOMIC_RELEASE);
+	local_ring = ring;
+	return ring;
+}
+
+
+/**
+ * @brief Wall-clock time in milliseconds since the epoch.
+ */
+static int64_t realtime_ms(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+/**
+ * @brief Write @p len bytes completely (retrying on EINTR and short writes).
+ *
+ * Errors are ignored: a broken log must not take the server down.
+ */
+static void write_all(int fd, const char *data, size_t len){
+	while(len > 0){
+		ssize_t n = write(fd, data, len);
+		if(n < 0){
+			if(errno == EINTR) continue;
+			return;
+		}
+		data += n;
+		len -= (size_t)n;
+	}
+}
+
+
+/**
+ * @brief Format one record as a text line.
+ *
+ * @return Number of bytes written into @p out (at most @p cap - 1).
+ */
+static size_t format_record(const struct access_log_record *rec, char *out, size_t cap){
+	static const char *const levels[] = { "error", "warn", "info", "debug" };
+
+	time_t secs = (time_t)(rec->time_ms / 1000);
+	struct tm tm;
+	gmtime_r(&secs, &tm);
+
+	char stamp[32];
+	strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &tm);
+
+	char peer[INET_ADDRSTRLEN] = "-";
+	if(rec->addr != 0){
+		struct in_addr addr = { .s_addr = rec->addr };
+		inet_ntop(AF_INET, &addr, peer, sizeof(peer));
+	}
+
+	const char *level = rec->level <= ACCESS_LOG_DEBUG ? levels[rec->level] : "?";
+	int n;
+	switch(rec->event){
+		case ACCESS_LOG_REQUEST: {
+			char bytes[24] = "-";
+			if(rec->bytes != ACCESS_LOG_BYTES_UNKNOWN) snprintf(bytes, sizeof(bytes), "%llu", (unsigned long long)rec->bytes);
+			n = snprintf(out, cap, "%s.%03dZ %s %s:%u \"%s %s\" %u %s %u.%03ums\n",
+						 stamp, (int)(rec->time_ms % 1000), level, peer, rec->port, rec->method, rec->path,
+						 rec->status, bytes, rec->duration_us / 1000, rec->duration_us % 1000);
+			break;
+		}
+		case ACCESS_LOG_ACCEPT:
+			n = snprintf(out, cap, "%s.%03dZ %s %s:%u accepted\n", stamp, (int)(rec->time_ms % 1000), level, peer, rec->port);
+			break;
+		case ACCESS_LOG_REFUSE:
+			n = snprintf(out, cap, "%s.%03dZ %s %s:%u refused (overload)\n", stamp, (int)(rec->time_ms % 1000), level, peer, rec->port);
+			break;
+		default:
+			n = 0;
+			break;
+	}
+	if(n < 0) return 0;
+	return (size_t)n < cap ? (size_t)n : cap - 1;
+}
+
+
+/**
+ * @brief Move every pending record of every ring into text and write it out.
+ *
+ * @param batch  Writer-owned buffer of @ref ACCESS_LOG_BATCH bytes.
+ */
+static void drain_rings(char *batch){
+	int fd = log_state.config.fd;
+	size_t len = 0;
+
+	unsigned count = __atomic_load_n(&log_state.ring_count, __ATOMIC_ACQUIRE);
+	if(count > ACCESS_LOG_MAX_THREADS) count = ACCESS_LOG_MAX_THREADS;
+
+	for(unsigned i=0; i<count; i++){
+		struct access_log_ring *ring = __atomic_load_n(&log_state.rings[i], __ATOMIC_ACQUIRE);
+		if(!ring) continue;
+
+		uint32_t head = ring->head;
+		uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+		while(head != tail){
+			if(ACCESS_LOG_BATCH - len < ACCESS_LOG_LINE_MAX){
+				write_all(fd, batch, len);
+				len = 0;
+			}
+			len += format_record(&ring->records[head & (ACCESS_LOG_RING_SIZE - 1)], batch + len, ACCESS_LOG_LINE_MAX);
+			head++;
+			/* Hand the slot back early so a busy producer can refill it. */
+			__atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+		}
+
+		uint64_t dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_ACQ_REL);
+		if(dropped > 0){
+			if(ACCESS_LOG_BATCH - len < ACCESS_LOG_LINE_MAX){
+				write_all(fd, batch, len);
+				len = 0;
+			}
+			int n = snprintf(batch + len, ACCESS_LOG_LINE_MAX, "access log: %llu records dropped\n",
+							 (unsigned long long)dropped);
+			if(n > 0) len += (size_t)n < ACCESS_LOG_LINE_MAX ? (size_t)n : ACCESS_LOG_LINE_MAX - 1;
+		}
+	}
+	if(len > 0) write_all(fd, batch, len);
+}
+
+
+/**
+ * @brief Writer thread: drain the rings every flush interval until stopped.
+ */
+static void *writer_main(void *arg){
+	(void)arg;
+	char *batch = malloc(ACCESS_LOG_BATCH);
+	if(!batch) return NULL;
+
+	unsigned interval_ms = log_state.config.flush_interval_ms;
+	struct timespec interval = { .tv_sec = interval_ms / 1000, .tv_nsec = (long)(interval_ms % 1000) * 1000000 };
+
+	while(!__atomic_load_n(&log_state.stopping, __ATOMIC_ACQUIRE)){
+		nanosleep(&interval, NULL);
+		drain_rings(batch);
+	}
+	drain_rings(batch);
+
+	free(batch);
+	return NULL;
+}
+
+
+int access_log_start(const struct access_log_config *config){
+	if(!config || __atomic_load_n(&log_state.running, __ATOMIC_ACQUIRE)) return -1;
+
+	log_state.config = *config;
+	if(log_state.config.sample_every == 0) log_state.config.sample_every = 1;
+	if(log_state.config.flush_interval_ms == 0) log_state.config.flush_interval_ms = 100;
+	log_state.stopping = false;
+	log_state.ring_count = 0;
+	memset(log_state.rings, 0, sizeof(log_state.rings));
+	__atomic_add_fetch(&log_state.generation, 1, __ATOMIC_RELEASE);
+
+	int ret = pthread_create(&log_state.thread, NULL, writer_main, NULL);
+	if(ret != 0){
+		fprintf(stderr, "access log: could not start writer thread: %s\n", strerror(ret));
+		return -1;
+	}
+	__atomic_store_n(&log_state.running, true, __ATOMIC_RELEASE);
+	return 0;
+}
+
+
+void access_log_stop(void){
+	if(!__atomic_load_n(&log_state.running, __ATOMIC_ACQUIRE)) return;
+
+	__atomic_store_n(&log_state.running, false, __ATOMIC_RELEASE);
+	__atomic_store_n(&log_state.stopping, true, __ATOMIC_RELEASE);
+	pthread_join(log_state.thread, NULL);
+
+	unsigned count = log_state.ring_count < ACCESS_LOG_MAX_THREADS ? log_state.ring_count : ACCESS_LOG_MAX_THREADS;
+	for(unsigned i=0; i<count; i++){
+		free(log_state.rings[i]);
+		log_state.rings[i] = NULL;
+	}
+	log_state.ring_count = 0;
+}
+
+
+bool access_log_enabled(enum access_log_level level){
+	if(!__atomic_load_n(&log_state.running, __ATOMIC_ACQUIRE)) return false;
+	return level <= log_state.config.level;
+}
+
+
+bool access_log_sample(enum access_log_level level){
+	if(!access_log_enabled(level)) return false;
+	if(level <= ACCESS_LOG_WARN || log_state.config.sample_every <= 1) return true;
+	return local_sample++ % log_state.config.sample_every == 0;
+}
+
+
+void access_log_submit(struct access_log_record *record){
+	if(!record || !__atomic_load_n(&log_state.running, __ATOMIC_ACQUIRE)) return;
+
+	struct access_log_ring *ring = thread_ring();
+	if(!ring) return;
+
+	uint32_t tail = ring->tail;
+	if(tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) >= ACCESS_LOG_RING_SIZE){
+		__atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	record->time_ms = realtime_ms();
+	ring->records[tail & (ACCESS_LOG_RING_SIZE - 1)] = *record;
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+
+void access_log_conn(enum access_log_event event, enum access_log_level level, const struct sockaddr_in *peer){
+	struct access_log_record rec = { .event = (uint8_t)event, .level = (uint8_t)level };
+	if(peer){
+		rec.addr = peer->sin_addr.s_addr;
+		rec.port = ntohs(peer->sin_port);
+	}
+	access_log_submit(&rec);
+}
+
+
+uint64_t access_log_clock_us(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
@@ -4,23 +4,25 @@
 #include "../../include/adapters/adapter_http_app.h"
 #include "../../include/http/http_request.h"
 #include "../../include/http/http_response.h"
+#include "../../include/filesystem/filesystem.h"
 
 /**
- * @brief Map a method string to @ref app_method.
+ * @brief Map a parsed method to @ref app_method.
  *
- * Performs a case-sensitive match on common verbs ("GET", "POST", "PUT", "DELETE").
- * Unknown or NULL inputs map to @ref APP_OTHER.
+ * GET, POST, PUT and DELETE have an app-level equivalent; every other
+ * method maps to @ref APP_OTHER.
  *
- * @param method NUL-terminated method string (may be NULL).
+ * @param method Method classified by the parser.
  * @return Corresponding @ref app_method value, or @ref APP_OTHER for unknown.
  */
-static enum app_method map_method(const char *method){
-    if (!method) return APP_OTHER;
-    if (!strcmp(method, "GET"))    return APP_GET;
-    if (!strcmp(method, "POST"))   return APP_POST;
-    if (!strcmp(method, "PUT"))    return APP_PUT;
-    if (!strcmp(method, "DELETE")) return APP_DELETE;
-    return APP_OTHER;
+static enum app_method map_method(enum http_method method){
+    switch (method) {
+        case HTTP_METHOD_GET:    return APP_GET;
+        case HTTP_METHOD_POST:   return APP_POST;
+        case HTTP_METHOD_PUT:    return APP_PUT;
+        case HTTP_METHOD_DELETE: return APP_DELETE;
+        default:                 return APP_OTHER;
+    }
 }
 
 
@@ -165,32 +167,165 @@ static int http_response_make_redirect(struct http_response *res, enum app_redir
 }
 
 
+/**
+ * @brief Release hook of a file body: close the app's file once it is sent.
+ *
+ * @param ctx The @ref fs_file from @ref app_response::file.
+ */
+static void release_app_file(void *ctx){
+    fs_close((struct fs_file*)ctx);
+}
+
+
+static int app_to_http_response(struct app_response *app_res, int app_ret, struct http_response *http_res_out);
+
+
+/**
+ * @brief Sink callback: pass the next request body piece to the app's consumer.
+ *
+ * @param ctx The @ref app_body_consumer copied from @ref app_response::consumer.
+ */
+static int consume_app_body(void *ctx, const void *data, size_t len){
+    struct app_body_consumer *consumer = (struct app_body_consumer*)ctx;
+    return consumer->consume(consumer->ctx, data, len) < 0 ? -1 : 0;
+}
+
+
+/**
+ * @brief Sink callback: let the app's consumer fill its response at the end of the body.
+ *
+ * @param ctx The @ref app_body_consumer copied from @ref app_response::consumer.
+ */
+static int finish_app_body(void *ctx, struct http_response *res){
+    struct app_body_consumer *consumer = (struct app_body_consumer*)ctx;
+    struct app_response app_res = {0};
+    int app_ret = consumer->finish ? consumer->finish(consumer->ctx, &app_res) : -1;
+    return app_to_http_response(&app_res, app_ret, res);
+}
+
+
+/**
+ * @brief Sink callback: release the app's consumer and its copy.
+ *
+ * @param ctx The @ref app_body_consumer copied from @ref app_response::consumer.
+ */
+static void release_app_consumer(void *ctx){
+    struct app_body_consumer *consumer = (struct app_body_consumer*)ctx;
+    if (consumer->release) consumer->release(consumer->ctx);
+    free(consumer);
+}
+
+
+/**
+ * @brief Convert a filled @ref app_response into @p http_res_out.
+ *
+ * Takes over the response's resources: a file or producer is handed on (or
+ * released if a redirect or error wins over it), a payload consumer becomes
+ * a @ref http_body_sink of the core.
+ *
+ * @param app_res       Response filled by the app (or by a consumer's finish).
+ * @param app_ret       Return value of the app call that filled it.
+ * @param http_res_out  Response to be sent by the core.
+ *
+ * @return @p app_ret, or -1 if the conversion failed.
+ */
+static int app_to_http_response(struct app_response *app_res, int app_ret, struct http_response *http_res_out){
+
+    if (app_res->consumer.consume){
+        if (app_res->redirect.enabled || app_ret < 0) {
+            if (app_res->consumer.release) app_res->consumer.release(app_res->consumer.ctx);
+            app_res->consumer = (struct app_body_consumer){0};
+        } else {
+            struct app_body_consumer *consumer = malloc(sizeof(*consumer));
+            if (!consumer) {
+                if (app_res->consumer.release) app_res->consumer.release(app_res->consumer.ctx);
+                return -1;
+            }
+            *consumer = app_res->consumer;
+            http_res_out->sink = (struct http_body_sink){
+                .enabled = true,
+                .consume = consume_app_body,
+                .finish  = finish_app_body,
+                .release = release_app_consumer,
+                .ctx     = consumer
+            };
+            return app_ret;
+        }
+    }
+
+	if (app_res->file && (app_res->redirect.enabled || app_ret < 0)){
+        fs_close(app_res->file);
+        app_res->file = NULL;
+    }
+    if (app_res->stream.produce && (app_res->redirect.enabled || app_ret < 0)){
+        if (app_res->stream.release) app_res->stream.release(app_res->stream.ctx);
+        app_res->stream = (struct app_body_producer){0};
+    }
+
+	if (app_res->redirect.enabled && app_res->redirect.location){
+
+        return http_response_make_redirect(http_res_out, app_res->redirect.type, app_res->redirect.location, 
+										  app_res->redirect.location_owned) < 0 ? -1 : app_ret;
+    }
+
+	http_res_out->status	   = app_status_to_http_status(app_res->status);
+    http_res_out->content_type = media_to_http_content_type(app_res->media_type);
+    http_res_out->body = app_res->payload;
+    http_res_out->content_length  = app_res->payload_len;
+	http_res_out->body_owned = app_res->payload_owned;
+
+    if (app_res->file){
+        int file_fd = fs_native_fd(app_res->file);
+        if (file_fd < 0){
+            fs_close(app_res->file);
+            return -1;
+        }
+        http_res_out->file = (struct http_file_body){
+            .enabled = true,
+            .fd      = file_fd,
+            .offset  = (off_t)app_res->file_offset,
+            .release = release_app_file,
+            .ctx     = app_res->file
+        };
+    }
+
+    if (app_res->stream.produce){
+        http_res_out->stream = (struct http_stream_body){
+            .enabled = true,
+            .produce = app_res->stream.produce,
+            .release = app_res->stream.release,
+            .ctx     = app_res->stream.ctx
+        };
+    }
+
+    return app_ret;
+}
+
+
 int adapter_http_app(const struct http_request *http_req, struct http_response *http_res_out, 
 					 void *adapter_context){
 
+    struct app_param params[HTTP_MAX_QUERY_PARAMS];
+    for (size_t i = 0; i < http_req->param_count; i++) {
+        params[i].name      = http_req->params[i].name;
+        params[i].value     = http_req->params[i].value;
+        params[i].value_len = http_req->params[i].value_len;
+    }
+
     const struct app_request app_req = {
-        .method		  = map_method(http_req->method),
+        .method		  = map_method(http_req->method_id),
         .path		  = http_req->path,
+        .path_len	  = http_req->path_len,
+        .params		  = params,
+        .param_count  = http_req->param_count,
         .payload	  = http_req->body,
         .payload_len  = http_req->content_length,
-        .media_type   = media_from_content_type(http_request_get_header_value(http_req, "Content-Type")),
-        .accept		  = http_request_get_header_value(http_req, "Accept")
+        .media_type   = media_from_content_type(http_request_header(http_req, HTTP_HEADER_CONTENT_TYPE)),
+        .accept		  = http_request_header(http_req, HTTP_HEADER_ACCEPT),
+        .body		  = { .read = http_req->body_reader.read, .ctx = http_req->body_reader.ctx }
     };
 
     struct app_response app_res = {0};
     int app_ret = ((struct app_adapter_ctx*)adapter_context)->app_handler(&app_req, &app_res);
-	
-	if (app_res.redirect.enabled && app_res.redirect.location){
-
-        return http_response_make_redirect(http_res_out, app_res.redirect.type, app_res.redirect.location, 
-										  app_res.redirect.location_owned) < 0 ? -1 : app_ret;
-    }
-
-	http_res_out->status	   = app_status_to_http_status(app_res.status);
-    http_res_out->content_type = media_to_http_content_type(app_res.media_type);
-    http_res_out->body = app_res.payload;
-    http_res_out->content_length  = app_res.payload_len;
-	http_res_out->body_owned = app_res.payload_owned;
-
-    return app_ret;
+    return app_to_http_response(&app_res, app_ret, http_res_out);
 }
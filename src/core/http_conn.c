@@ -0,0 +1,1315 @@
+#include <errno.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "../../include/access_log.h"
+#include "../../include/timer_wheel.h"
+#include "../../include/core/http_conn.h"
+#include "../../include/core/http_core.h"
+#include "../../include/http/http_parser.h"
+#include "../../include/http/http_request.h"
+#include "../../include/http/http_response.h"
+
+
+/**
+ * @def HTTP_CONN_PIPELINE_DEPTH
+ * @brief Maximum number of responses queued on one connection.
+ *
+ * While the queue is full no further requests are read, so a client that
+ * pipelines without reading its responses is throttled by TCP flow control.
+ */
+#define HTTP_CONN_PIPELINE_DEPTH 16
+
+/**
+ * @def HTTP_CONN_OUT_BUFFER
+ * @brief Size of the per-connection output buffer (allocated on first response).
+ *
+ * Holds the serialized heads and copied bodies of queued responses. It never
+ * moves while output is pending, so the transport may reference it directly.
+ */
+#define HTTP_CONN_OUT_BUFFER 8192
+
+/**
+ * @def HTTP_CONN_COALESCE_MAX
+ * @brief Bodies up to this size are copied right behind their head.
+ *
+ * Consecutive small responses then form one contiguous run in the output
+ * buffer and go out as a single segment.
+ */
+#define HTTP_CONN_COALESCE_MAX 1024
+
+/**
+ * @def HTTP_CONN_BACKLOG_MAX
+ * @brief Limit for buffered input while the output queue is full.
+ *
+ * Completion-based transports deliver data that is already off the socket,
+ * so pipelined requests beyond the queue depth must be held until responses
+ * drain. Readiness-based transports simply stop reading instead.
+ */
+#define HTTP_CONN_BACKLOG_MAX 65536
+
+/**
+ * @def HTTP_CONN_LINGER_MAX
+ * @brief Input discarded after a refusal before the connection is closed anyway.
+ */
+#define HTTP_CONN_LINGER_MAX 65536
+
+/**
+ * @def HTTP_CONN_IOV_MAX
+ * @brief Maximum segments passed to one writev(2).
+ */
+#define HTTP_CONN_IOV_MAX 32
+
+
+/**
+ * @enum http_conn_state
+ * @brief Input phase of a connection.
+ *
+ * Output is independent of the phase: responses queue up while the next
+ * request is already being read.
+ */
+enum http_conn_state {
+	HTTP_CONN_READ_HEAD,	/**< Waiting for "\r\n\r\n". */
+	HTTP_CONN_READ_BODY,	/**< Head parsed, waiting for the body (Content-Length or chunked). */
+	HTTP_CONN_SKIP_BODY,	/**< Request answered; discarding the part of its body the handler did not read. */
+	HTTP_CONN_FEED_BODY,	/**< Handler parked; passing the rest of the body to its sink as it arrives. */
+	HTTP_CONN_DRAIN,		/**< No further requests; flushing queued responses before closing. */
+	HTTP_CONN_LINGER,		/**< Refusal sent and sending side shut down; discarding input until EOF. */
+	HTTP_CONN_DONE			/**< Connection finished (or failed); close. */
+};
+
+
+/**
+ * @struct http_conn_pending
+ * @brief A dispatched response waiting in the output queue.
+ */
+struct http_conn_pending {
+	struct http_response res;	/**< Response (owns its body until sent). */
+	size_t out_end;				/**< End of this response's bytes in the output buffer. */
+	bool   body_copied;			/**< Body was copied into the output buffer behind the head. */
+};
+
+
+/**
+ * @struct http_conn
+ * @brief Everything needed to resume an exchange between readiness events.
+ *
+ * With keep-alive the same object (and read buffer) serves every request of
+ * the connection. Requests are dispatched as soon as they are complete, so a
+ * pipelining client gets its responses queued back to back in request order.
+ */
+struct http_conn {
+	int 				 fd;				/**< Client socket (not owned). */
+	enum http_conn_state state;				/**< Current input phase. */
+	const struct http_limits *limits;		/**< Size limits of the listener. */
+
+	char 				*buffer;			/**< Received, not yet dispatched bytes. */
+	size_t 				 buffer_cap;		/**< Allocated size of @ref buffer. */
+	size_t 				 buffer_len;		/**< Valid bytes in @ref buffer. */
+	struct http_parser 	 parser;			/**< Parse progress of the request at the front of @ref buffer. */
+	size_t 				 body_target;		/**< Body bytes to wait for (capped at the body limit). */
+	size_t 				 body_taken;		/**< Held body bytes the handler already pulled. */
+	struct http_request  req;				/**< Request being read. */
+	struct http_body_sink sink;				/**< Parked handler of the request (@ref HTTP_CONN_FEED_BODY). */
+	uint64_t 			 sink_started_us;	/**< @ref access_log_clock_us when the parked request was dispatched (0 → not logged). */
+
+	struct http_conn_pending pending[HTTP_CONN_PIPELINE_DEPTH]; /**< Ring of queued responses. */
+	unsigned 			 pending_first;		/**< Index of the oldest queued response. */
+	unsigned 			 pending_count;		/**< Number of queued responses. */
+	char 				*out;				/**< Output buffer (@ref HTTP_CONN_OUT_BUFFER bytes, or NULL). */
+	size_t 				 out_len;			/**< Valid bytes in @ref out. */
+	size_t 				 out_sent;			/**< Bytes of @ref out already written. */
+	size_t 				 body_sent;			/**< Written bytes of the oldest response's separate body. */
+
+	int64_t 			 phase_start;		/**< Start of the current head read, keep-alive wait or linger (ms). */
+	int64_t 			 read_progress;		/**< Last time request bytes arrived (ms). */
+	int64_t 			 write_progress;	/**< Last time response bytes left, or the queue filled (ms). */
+
+	uint32_t 			 peer_addr;			/**< Client IPv4 address for the access log (network order, 0 → unknown). */
+	uint16_t 			 peer_port;			/**< Client port for the access log. */
+
+	unsigned 			 requests;			/**< Requests dispatched on this connection. */
+	size_t 				 lingered;			/**< Input discarded in @ref HTTP_CONN_LINGER. */
+	bool 				 linger;			/**< A request was refused: linger once the queued responses are sent. */
+	bool 				 peer_closed;		/**< EOF seen; no further request can arrive. */
+	bool 				 pushed_input;		/**< The transport reads the socket (@ref http_conn_on_data). */
+	bool 				 body_failed;		/**< The body of the current request broke off (client gone, malformed). */
+	bool 				 draining;			/**< Server shuts down: no keep-alive, close once idle. */
+	bool 				 corked;			/**< TCP_CORK is set for the running flush. */
+	enum http_output_policy output_policy;	/**< Segment coalescing of the listener. */
+};
+
+
+/**
+ * @brief Make sure at least @p needed bytes fit into the read buffer.
+ *
+ * Grows geometrically but never beyond @p max.
+ *
+ * @return 0 on success, -1 if @p needed exceeds @p max or on allocation failure.
+ */
+static int ensure_capacity(struct http_conn *conn, size_t needed, size_t max){
+	if(needed <= conn->buffer_cap) return 0;
+	if(needed > max) return -1;
+
+	size_t new_cap = conn->buffer_cap ? conn->buffer_cap : conn->limits->initial_buffer;
+	while(new_cap < needed) new_cap *= 2;
+	if(new_cap > max) new_cap = max;
+
+	uintptr_t old_base = (uintptr_t)conn->buffer;
+	char *tmp = realloc(conn->buffer, new_cap);
+	if(!tmp) return -1;
+	/* The parsed request points into the buffer. */
+	if(old_base && (uintptr_t)tmp != old_base) http_request_rebase(&conn->req, old_base, tmp);
+	conn->buffer = tmp;
+	conn->buffer_cap = new_cap;
+	return 0;
+}
+
+
+/**
+ * @brief Stamp the arrival of @p n request bytes for the read deadlines.
+ *
+ * Call before the bytes are appended: the first byte into an empty buffer
+ * starts the header deadline of the next request.
+ */
+static void conn_mark_input(struct http_conn *conn, size_t n){
+	if(n == 0) return;
+	int64_t now = timer_now_ms();
+	if(conn->state == HTTP_CONN_READ_HEAD && conn->buffer_len == 0) conn->phase_start = now;
+	conn->read_progress = now;
+}
+
+
+/**
+ * @brief Read once from the socket into the free part of the buffer.
+ *
+ * @return Bytes read (> 0), 0 on EOF, -1 on error,
+ *         -2 if the socket has no data right now (EAGAIN).
+ */
+static ssize_t conn_read(struct http_conn *conn){
+	while(1){
+		ssize_t n = read(conn->fd, conn->buffer + conn->buffer_len, conn->buffer_cap - conn->buffer_len);
+		if(n < 0){
+			if(errno == EINTR) continue;
+			if(errno == EAGAIN || errno == EWOULDBLOCK) return -2;
+			return -1;
+		}
+		conn_mark_input(conn, (size_t)n);
+		conn->buffer_len += (size_t)n;
+		return n;
+	}
+}
+
+
+/**
+ * @brief Whether the connection is in one of its input phases.
+ */
+static bool conn_reading(const struct http_conn *conn){
+	return conn->state == HTTP_CONN_READ_HEAD
+		|| conn->state == HTTP_CONN_READ_BODY
+		|| conn->state == HTTP_CONN_SKIP_BODY
+		|| conn->state == HTTP_CONN_FEED_BODY;
+}
+
+
+/**
+ * @brief Length of a response's in-memory body (0 if it has none).
+ */
+static size_t response_body_len(const struct http_response *res){
+	return (res->body && res->content_length > 0) ? res->content_length : 0;
+}
+
+
+/**
+ * @brief Body bytes sent behind the head, from memory, from a file or (for
+ * a generated body) of its current piece.
+ */
+static size_t response_payload_len(const struct http_response *res){
+	if(res->stream.enabled) return res->stream.piece_len;
+	return res->file.enabled ? res->content_length : response_body_len(res);
+}
+
+
+/**
+ * @brief Whether output is waiting to be written.
+ *
+ * Besides the queued responses that is an interim response written behind
+ * all of them (see @ref conn_queue_continue).
+ */
+static bool conn_output_pending(const struct http_conn *conn){
+	return conn->pending_count > 0 || conn->out_sent < conn->out_len;
+}
+
+
+/**
+ * @brief Whether another response can be queued.
+ *
+ * Requires a free slot and room for a full head in the output buffer (an
+ * empty buffer always has room).
+ */
+static bool conn_has_room(const struct http_conn *conn){
+	if(conn->pending_count >= HTTP_CONN_PIPELINE_DEPTH) return false;
+	return conn->pending_count == 0 || HTTP_CONN_OUT_BUFFER - conn->out_len >= HTTP_RESPONSE_HEAD_MAX;
+}
+
+
+/**
+ * @brief Append a response to the output queue, taking over its resources.
+ *
+ * The head is serialized straight into the output buffer; a small body is
+ * copied behind it and released right away. A file body stays in its file
+ * and goes out with sendfile(2), unless the transport does the sending
+ * (@ref http_conn_pending_output describes memory only): then it is read
+ * into memory piece by piece, the first one right away if the response is
+ * the oldest in the queue (see @ref conn_file_refill). A generated body has its
+ * first piece produced right away, so it leaves together with the head;
+ * the next ones follow as each is sent.
+ *
+ * @return 0 on success, -1 on error (@p res is left to the caller).
+ */
+static int conn_queue_response(struct http_conn *conn, struct http_response *res){
+	if(!conn_has_room(conn)) return -1;
+	/* Only the oldest response holds a piece; later ones are read when their turn comes. */
+	if(res->file.enabled && conn->pushed_input && conn->pending_count == 0 && res->content_length > 0
+	   && http_response_file_next(res, 0) < 0) return -1;
+	if(res->stream.enabled && http_response_stream_next(res) < 0) return -1;
+	if(!conn->out){
+		conn->out = malloc(HTTP_CONN_OUT_BUFFER);
+		if(!conn->out) return -1;
+	}
+
+	ssize_t head_len = http_response_serialize_head(res, conn->out + conn->out_len, HTTP_RESPONSE_HEAD_MAX);
+	if(head_len < 0) return -1;
+	conn->out_len += (size_t)head_len;
+
+	if(conn->pending_count == 0) conn->write_progress = timer_now_ms();
+
+	struct http_conn_pending *slot = &conn->pending[(conn->pending_first + conn->pending_count) % HTTP_CONN_PIPELINE_DEPTH];
+	size_t body_len = response_body_len(res);
+	slot->body_copied = false;
+	if(body_len > 0 && body_len <= HTTP_CONN_COALESCE_MAX && body_len <= HTTP_CONN_OUT_BUFFER - conn->out_len){
+		memcpy(conn->out + conn->out_len, res->body, body_len);
+		conn->out_len += body_len;
+		if(res->body_owned) free((void*)res->body);
+		res->body = NULL;
+		res->body_owned = false;
+		slot->body_copied = true;
+	}
+	slot->out_end = conn->out_len;
+	slot->res = *res;
+	conn->pending_count++;
+	return 0;
+}
+
+
+/**
+ * @brief Queue "100 Continue" if the client waits for it before sending the body.
+ *
+ * Only for an HTTP/1.1 request announcing "Expect: 100-continue" whose body
+ * has not started to arrive. The interim response is appended to the output
+ * buffer without a queue slot: it goes out behind earlier responses and
+ * becomes part of the run in front of the final response once that is
+ * queued, so it neither limits pipelining nor counts as a request in flight
+ * (@ref http_conn_in_flight). It is skipped if the buffer would then lack
+ * room for the final head (the client sends the body after its own timeout).
+ */
+static void conn_queue_continue(struct http_conn *conn){
+	static const char interim[] = HTTP_CONTINUE_RESPONSE;
+	const size_t len = sizeof(interim) - 1;
+
+	if(conn->req.version_id != HTTP_VERSION_1_1 || conn->buffer_len > conn->parser.consumed) return;
+	const char *expect = http_request_header(&conn->req, HTTP_HEADER_EXPECT);
+	if(!expect || strcasecmp(expect, "100-continue") != 0) return;
+
+	if(HTTP_CONN_OUT_BUFFER - conn->out_len < len + HTTP_RESPONSE_HEAD_MAX) return;
+	if(!conn->out){
+		conn->out = malloc(HTTP_CONN_OUT_BUFFER);
+		if(!conn->out) return;
+	}
+
+	if(!conn_output_pending(conn)) conn->write_progress = timer_now_ms();
+	memcpy(conn->out + conn->out_len, interim, len);
+	conn->out_len += len;
+}
+
+
+/**
+ * @brief Drop the dispatched request from the read buffer and reset the parse state.
+ *
+ * Bytes the client already sent beyond it (pipelined requests) are moved to
+ * the front of the buffer.
+ */
+static void conn_consume_request(struct http_conn *conn){
+	size_t request_end = conn->parser.consumed;
+	if(request_end > conn->buffer_len) request_end = conn->buffer_len;
+	size_t leftover = conn->buffer_len - request_end;
+	if(leftover > 0) memmove(conn->buffer, conn->buffer + request_end, leftover);
+	conn->buffer_len = leftover;
+	http_parser_init(&conn->parser, conn->limits);
+	conn->body_target = 0;
+	conn->body_taken = 0;
+	conn->body_failed = false;
+	conn->phase_start = timer_now_ms();
+	http_request_clear(&conn->req);
+}
+
+
+/**
+ * @brief Record an answered request in the access log (if sampled).
+ *
+ * The record is written at dispatch, before a generated body exists, so its
+ * length is logged as unknown.
+ *
+ * @param started_us  @ref access_log_clock_us before the adapter ran.
+ * @param level 	  Level of the record.
+ */
+static void conn_log_request(const struct http_conn *conn, const struct http_response *res, uint64_t started_us,
+							 enum access_log_level level){
+	if(!access_log_sample(level)) return;
+
+	struct access_log_record rec = {
+		.event 		 = ACCESS_LOG_REQUEST,
+		.level 		 = (uint8_t)level,
+		.addr 		 = conn->peer_addr,
+		.port 		 = conn->peer_port,
+		.status 	 = (uint16_t)res->status,
+		.bytes 		 = res->stream.enabled ? ACCESS_LOG_BYTES_UNKNOWN : res->content_length,
+		.duration_us = (uint32_t)(access_log_clock_us() - started_us)
+	};
+	if(conn->req.method) strncpy(rec.method, conn->req.method, sizeof(rec.method) - 1);
+	if(conn->req.path) strncpy(rec.path, conn->req.path, sizeof(rec.path) - 1);
+	access_log_submit(&rec);
+}
+
+
+/**
+ * @brief Body reader handed to the adapter (see @ref http_body_reader).
+ *
+ * Serves the body bytes held behind the head first. After that each piece
+ * that already arrived is decoded in place behind the head, copied out and
+ * dropped again, so the buffer never grows however long the body is. The
+ * socket is never touched: once the received bytes are used up the reader
+ * returns @ref HTTP_BODY_PENDING, and the handler parks with a sink
+ * (@ref HTTP_CONN_FEED_BODY) if it needs the rest.
+ */
+static ssize_t conn_body_read(void *ctx, void *buf, size_t len){
+	struct http_conn *conn = (struct http_conn*)ctx;
+	if(!conn || (!buf && len > 0) || conn->body_failed) return -1;
+	if(len == 0) return 0;
+
+	while(1){
+		if(conn->body_taken < conn->parser.body_held){
+			size_t n = conn->parser.body_held - conn->body_taken;
+			if(n > len) n = len;
+			memcpy(buf, conn->buffer + conn->parser.head_len + conn->body_taken, n);
+			conn->body_taken += n;
+			return (ssize_t)n;
+		}
+		if(conn->parser.phase == HTTP_PARSER_COMPLETE) return 0;
+
+		http_parser_discard_body(&conn->parser, conn->buffer, &conn->buffer_len);
+		conn->body_taken = 0;
+
+		enum http_parse_status status = http_parser_feed(&conn->parser, conn->buffer, conn->buffer_len, &conn->req);
+		if(status == HTTP_PARSE_BODY_CHUNK || status == HTTP_PARSE_DONE) continue;
+		if(status == HTTP_PARSE_NEED_MORE){
+			http_parser_compact(&conn->parser, conn->buffer, &conn->buffer_len);
+			if(!conn->peer_closed) return HTTP_BODY_PENDING;
+		}
+		conn->body_failed = true;
+		return -1;
+	}
+}
+
+
+/**
+ * @brief Release the sink of a parked handler, if any.
+ */
+static void conn_release_sink(struct http_conn *conn){
+	if(conn->sink.enabled && conn->sink.release) conn->sink.release(conn->sink.ctx);
+	conn->sink = (struct http_body_sink){0};
+}
+
+
+/**
+ * @brief Log and queue the response to the current request, then move on to the next one.
+ *
+ * A response that is only a sink parks the request instead (see
+ * @ref HTTP_CONN_FEED_BODY); it is answered once the body is complete.
+ *
+ * @param started_us  @ref access_log_clock_us before the adapter ran (0 → not logged).
+ *
+ * @return 0 if the response was queued (or the request parked), -1 otherwise.
+ */
+static int conn_answer(struct http_conn *conn, struct http_response *res, uint64_t started_us){
+	if(res->sink.enabled){
+		conn->sink = res->sink;
+		conn->sink_started_us = started_us;
+		res->sink = (struct http_body_sink){0};
+		http_response_clear(res);
+		conn->req.body_reader = (struct http_body_reader){0};
+		conn->state = HTTP_CONN_FEED_BODY;
+		return 0;
+	}
+	if(started_us > 0) conn_log_request(conn, res, started_us, res->status >= 500 ? ACCESS_LOG_WARN : ACCESS_LOG_INFO);
+
+	/* A body that broke off would leave unread bytes in front of the next request. */
+	conn->requests++;
+	res->keep_alive = !conn->peer_closed
+				   && !conn->draining
+				   && !conn->body_failed
+				   && conn->requests < HTTP_KEEPALIVE_MAX_REQUESTS
+				   && http_request_keep_alive(&conn->req);
+
+	/* HTTP/1.0 has no chunked coding: a generated body then ends with the connection. */
+	if(res->stream.enabled){
+		res->stream.chunked = conn->req.version_id == HTTP_VERSION_1_1;
+		if(!res->stream.chunked) res->keep_alive = false;
+	}
+
+	if(conn_queue_response(conn, res) < 0) return -1;
+
+	if(res->keep_alive && conn->parser.phase != HTTP_PARSER_COMPLETE){
+		/* The handler left (part of) the body unread; it is dropped on arrival. */
+		http_parser_discard_body(&conn->parser, conn->buffer, &conn->buffer_len);
+		conn->req.body_reader = (struct http_body_reader){0};
+		conn->state = HTTP_CONN_SKIP_BODY;
+		return 0;
+	}
+
+	conn_consume_request(conn);
+	conn->state = res->keep_alive ? HTTP_CONN_READ_HEAD : HTTP_CONN_DRAIN;
+	return 0;
+}
+
+
+/**
+ * @brief Run the adapter on the request and queue its response.
+ *
+ * The request is dispatched once its body is complete or the body limit is
+ * buffered. A complete body is passed as a view into the read buffer; the
+ * rest of a longer one is pulled by the handler through
+ * @ref http_request::body_reader as far as it has arrived, or fed to the
+ * sink the handler returns.
+ *
+ * @return 0 if the response was queued (or the request parked), -1 if no response could be produced.
+ */
+static int conn_dispatch(struct http_conn *conn, struct http_core_ctx *core){
+	if(conn->parser.content_len > 0 || conn->parser.chunked){
+		/* The body pieces lie back to back behind the head. */
+		if(conn->parser.phase == HTTP_PARSER_COMPLETE){
+			conn->req.body = conn->buffer + conn->parser.head_len;
+			conn->req.content_length = conn->parser.body_held;
+		}
+		conn->req.body_reader = (struct http_body_reader){ .read = conn_body_read, .ctx = conn };
+		conn->body_taken = 0;
+	}
+
+	if(conn->limits->adaptive_buffer){
+		/* Moving average with weight 1/8; racing updates from other workers only blur it. */
+		size_t hint = __atomic_load_n(&core->head_hint, __ATOMIC_RELAXED);
+		hint = hint ? hint - hint / 8 + conn->parser.head_len / 8 : conn->parser.head_len;
+		__atomic_store_n(&core->head_hint, hint, __ATOMIC_RELAXED);
+	}
+
+	uint64_t started_us = access_log_enabled(ACCESS_LOG_WARN) ? access_log_clock_us() : 0;
+
+	struct http_response res = {0};
+	int ret = core->adapter_handler(&conn->req, &res, core->adapter_context);
+	if(ret < 0 || conn_answer(conn, &res, started_us) < 0){
+		http_response_clear(&res);
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Answer a request that is refused before it reaches the handler.
+ *
+ * Used for a malformed head (400), a declared body beyond
+ * @ref http_limits::max_body (413) and a head beyond
+ * @ref http_limits::max_head (431). The rest of the request is not read.
+ * Once the response is sent the connection lingers (see @ref conn_linger)
+ * before it closes. Refusals are logged at WARN, like refused connections.
+ *
+ * @return 0 if the response was queued, -1 otherwise.
+ */
+static int conn_reject(struct http_conn *conn, enum http_status status){
+	static const char too_large[] = "Content Too Large\n";
+	static const char head_too_large[] = "Request Header Fields Too Large\n";
+	static const char bad_request[] = "Bad Request\n";
+
+	struct http_response res = {
+		.status 		= status,
+		.content_type 	= "text/plain; charset=UTF-8"
+	};
+	switch(status){
+		case HTTP_PAYLOAD_TOO_LARGE:
+			res.body = too_large;
+			res.content_length = sizeof(too_large) - 1;
+			break;
+		case HTTP_HEADERS_TOO_LARGE:
+			res.body = head_too_large;
+			res.content_length = sizeof(head_too_large) - 1;
+			break;
+		default:
+			res.body = bad_request;
+			res.content_length = sizeof(bad_request) - 1;
+			break;
+	}
+
+	conn->requests++;
+	if(access_log_enabled(ACCESS_LOG_WARN)) conn_log_request(conn, &res, access_log_clock_us(), ACCESS_LOG_WARN);
+	if(conn_queue_response(conn, &res) < 0) return -1;
+
+	conn_consume_request(conn);
+	conn->state = HTTP_CONN_DRAIN;
+	conn->linger = true;
+	return 0;
+}
+
+
+/**
+ * @brief Feed buffered bytes to the parser until the request is complete or input runs out.
+ *
+ * Body pieces stay in the buffer, right behind the head, until the request
+ * is dispatched. A body longer than @ref http_limits::max_body_buffer is
+ * dispatched once the limit is buffered; the handler pulls the rest.
+ *
+ * @param eof  true if the peer closed its sending side.
+ *
+ * @return 1 if the request is complete, 0 if more bytes are needed, -1 on error,
+ *         2 if the declared body is too large to be accepted, 3 if the head is malformed.
+ */
+static int conn_advance(struct http_conn *conn, bool eof){
+	while(conn->state != HTTP_CONN_READ_BODY || conn->parser.body_held < conn->body_target){
+		switch(http_parser_feed(&conn->parser, conn->buffer, conn->buffer_len, &conn->req)){
+			case HTTP_PARSE_ERROR:
+				return conn->state == HTTP_CONN_READ_HEAD ? 3 : -1;
+			case HTTP_PARSE_HEADERS_DONE:
+				if(conn->limits->max_body > 0 && conn->parser.content_len > conn->limits->max_body) return 2;
+				if(conn->parser.content_len > 0 || conn->parser.chunked) conn_queue_continue(conn);
+				conn->body_target = conn->parser.chunked || conn->parser.content_len > conn->limits->max_body_buffer
+								  ? conn->limits->max_body_buffer
+								  : conn->parser.content_len;
+				conn->state = HTTP_CONN_READ_BODY;
+				break;
+			case HTTP_PARSE_BODY_CHUNK:
+				break;
+			case HTTP_PARSE_DONE:
+				return 1;
+			case HTTP_PARSE_NEED_MORE:
+				if(eof) return conn->state == HTTP_CONN_READ_BODY ? 1 : -1;
+				http_parser_compact(&conn->parser, conn->buffer, &conn->buffer_len);
+				return 0;
+		}
+	}
+	return 1;
+}
+
+
+/**
+ * @brief Drop the rest of an answered request's body as it arrives.
+ *
+ * @param eof  true if the peer closed its sending side.
+ *
+ * @return 1 once the request is consumed, 0 if more bytes are needed, -1 on error.
+ */
+static int conn_skip_body(struct http_conn *conn, bool eof){
+	while(1){
+		switch(http_parser_feed(&conn->parser, conn->buffer, conn->buffer_len, &conn->req)){
+			case HTTP_PARSE_BODY_CHUNK:
+				http_parser_discard_body(&conn->parser, conn->buffer, &conn->buffer_len);
+				break;
+			case HTTP_PARSE_DONE:
+				conn_consume_request(conn);
+				conn->state = HTTP_CONN_READ_HEAD;
+				return 1;
+			case HTTP_PARSE_NEED_MORE:
+				if(eof) return -1;
+				http_parser_compact(&conn->parser, conn->buffer, &conn->buffer_len);
+				return 0;
+			default:
+				return -1;
+		}
+	}
+}
+
+
+/**
+ * @brief Pass the rest of a parked request's body to its sink as it arrives.
+ *
+ * Each decoded piece is handed over and dropped right away, so the body
+ * takes no more memory than in @ref HTTP_CONN_READ_BODY.
+ *
+ * @param eof  true if the peer closed its sending side.
+ *
+ * @return 1 once the body is complete, 0 if more bytes are needed, -1 on error.
+ */
+static int conn_feed_body(struct http_conn *conn, bool eof){
+	while(1){
+		if(conn->body_taken < conn->parser.body_held
+		   && conn->sink.consume(conn->sink.ctx, conn->buffer + conn->parser.head_len + conn->body_taken,
+								 conn->parser.body_held - conn->body_taken) < 0) return -1;
+		http_parser_discard_body(&conn->parser, conn->buffer, &conn->buffer_len);
+		conn->body_taken = 0;
+		if(conn->parser.phase == HTTP_PARSER_COMPLETE) return 1;
+
+		switch(http_parser_feed(&conn->parser, conn->buffer, conn->buffer_len, &conn->req)){
+			case HTTP_PARSE_BODY_CHUNK:
+			case HTTP_PARSE_DONE:
+				break;
+			case HTTP_PARSE_NEED_MORE:
+				if(eof) return -1;
+				http_parser_compact(&conn->parser, conn->buffer, &conn->buffer_len);
+				return 0;
+			default:
+				return -1;
+		}
+	}
+}
+
+
+/**
+ * @brief Let the parked handler fill its response now that the body is complete, and queue it.
+ *
+ * @return 0 if the response was queued, -1 otherwise.
+ */
+static int conn_finish_body(struct http_conn *conn){
+	struct http_response res = {0};
+	int ret = conn->sink.finish(conn->sink.ctx, &res);
+	conn_release_sink(conn);
+	/* The sink is done with; a second one is not supported. */
+	if(ret < 0 || res.sink.enabled || conn_answer(conn, &res, conn->sink_started_us) < 0){
+		http_response_clear(&res);
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Dispatch every complete request in the buffer while the queue has room.
+ *
+ * On a parse or adapter error the responses already queued are still sent,
+ * then the connection closes.
+ *
+ * @param eof  true if the peer closed its sending side.
+ */
+static void conn_process(struct http_conn *conn, struct http_core_ctx *core, bool eof){
+	while(conn_reading(conn) && conn_has_room(conn)){
+		if(conn->state == HTTP_CONN_SKIP_BODY){
+			int skipped = conn_skip_body(conn, eof);
+			if(skipped == 0) return;
+			if(skipped < 0){
+				conn->state = conn_output_pending(conn) ? HTTP_CONN_DRAIN : HTTP_CONN_DONE;
+				return;
+			}
+			continue;
+		}
+		if(conn->state == HTTP_CONN_FEED_BODY){
+			int fed = conn_feed_body(conn, eof);
+			if(fed == 0) return;
+			if(fed < 0 || conn_finish_body(conn) < 0){
+				conn_release_sink(conn);
+				conn->state = conn_output_pending(conn) ? HTTP_CONN_DRAIN : HTTP_CONN_DONE;
+				return;
+			}
+			continue;
+		}
+
+		int advanced = conn_advance(conn, eof);
+		if(advanced == 0) return;
+		int answered;
+		switch(advanced){
+			case 1:
+				answered = conn_dispatch(conn, core);
+				break;
+			case 2:
+				answered = conn_reject(conn, HTTP_PAYLOAD_TOO_LARGE);
+				break;
+			case 3:
+				answered = conn_reject(conn, HTTP_BAD_REQUEST);
+				break;
+			default:
+				answered = -1;
+				break;
+		}
+		if(answered < 0){
+			conn->state = conn_output_pending(conn) ? HTTP_CONN_DRAIN : HTTP_CONN_DONE;
+			return;
+		}
+	}
+}
+
+
+/**
+ * @brief Whether the connection wants more request bytes right now.
+ */
+static bool conn_can_read(const struct http_conn *conn){
+	return conn_reading(conn)
+		&& !conn->peer_closed
+		&& conn_has_room(conn);
+}
+
+
+/**
+ * @brief Shut down the sending side after a refusal and start discarding input.
+ *
+ * The client may still be sending the request that was refused. Closing
+ * with that input unread would reset the connection, possibly before the
+ * client has read the refusal; so the input is read and dropped until the
+ * client closes, up to @ref HTTP_CONN_LINGER_MAX bytes or
+ * @ref HTTP_LINGER_TIMEOUT_MS.
+ */
+static void conn_linger(struct http_conn *conn){
+	if(conn->peer_closed || shutdown(conn->fd, SHUT_WR) < 0){
+		conn->state = HTTP_CONN_DONE;
+		return;
+	}
+	conn->state = HTTP_CONN_LINGER;
+	conn->phase_start = timer_now_ms();
+}
+
+
+/**
+ * @brief Account for @p n bytes discarded while lingering (0 → EOF).
+ */
+static void conn_lingered(struct http_conn *conn, size_t n){
+	conn->lingered += n;
+	if(n == 0 || conn->lingered >= HTTP_CONN_LINGER_MAX) conn->state = HTTP_CONN_DONE;
+}
+
+
+/**
+ * @brief Read and drop whatever the socket holds while lingering.
+ */
+static void conn_linger_read(struct http_conn *conn){
+	while(conn->state == HTTP_CONN_LINGER){
+		ssize_t n = read(conn->fd, conn->buffer, conn->buffer_cap);
+		if(n < 0){
+			if(errno == EINTR) continue;
+			if(errno != EAGAIN && errno != EWOULDBLOCK) conn->state = HTTP_CONN_DONE;
+			return;
+		}
+		conn_lingered(conn, (size_t)n);
+	}
+}
+
+
+/**
+ * @brief Events the connection waits for next; marks it done when it needs neither.
+ *
+ * @return POLLIN and/or POLLOUT, or 0 to close.
+ */
+static int conn_interest(struct http_conn *conn){
+	if(conn->state == HTTP_CONN_DRAIN && conn->linger && !conn_output_pending(conn)) conn_linger(conn);
+	if(conn->state == HTTP_CONN_LINGER) return POLLIN;
+	if(conn->state == HTTP_CONN_DONE) return 0;
+
+	/* Between requests of a kept-alive connection nothing is lost by closing. */
+	if(conn->draining && conn->state == HTTP_CONN_READ_HEAD && conn->requests > 0
+	   && conn->buffer_len == 0 && !conn_output_pending(conn)){
+		conn->state = HTTP_CONN_DONE;
+		return 0;
+	}
+
+	int interest = 0;
+	if(conn_output_pending(conn)) interest |= POLLOUT;
+	if(conn_can_read(conn)) interest |= POLLIN;
+	if(interest == 0) conn->state = HTTP_CONN_DONE;
+	return interest;
+}
+
+
+/**
+ * @brief Describe the unsent queued output as segments, in response order.
+ *
+ * Adjacent runs of the output buffer (heads and copied bodies) are merged, so
+ * a burst of small pipelined responses is a single segment. The list ends
+ * at the first file body that is not completely sent (see @ref conn_flush),
+ * or behind its current piece if the transport sends memory, and behind the
+ * current piece of a generated body that has more to come.
+ *
+ * @param more 	Set to whether output remains beyond the filled segments (may be NULL).
+ *
+ * @return Number of segments filled (0 if nothing is pending).
+ */
+static int conn_output(struct http_conn *conn, struct iovec *iov, int iov_max, bool *more){
+	int count = 0;
+	bool last_is_out = false;
+	bool rest = false;
+	size_t pos = conn->out_sent;
+	unsigned i;
+
+	for(i=0; i<conn->pending_count && count < iov_max; i++){
+		const struct http_conn_pending *slot = &conn->pending[(conn->pending_first + i) % HTTP_CONN_PIPELINE_DEPTH];
+
+		if(pos < slot->out_end){
+			if(last_is_out){
+				iov[count-1].iov_len += slot->out_end - pos;
+			}else{
+				iov[count].iov_base = conn->out + pos;
+				iov[count].iov_len = slot->out_end - pos;
+				count++;
+				last_is_out = true;
+			}
+			pos = slot->out_end;
+		}
+
+		size_t body_sent = i == 0 ? conn->body_sent : 0;
+		if(slot->res.stream.enabled){
+			/* Later pieces do not exist yet, so nothing is held back for them. */
+			const struct http_stream_body *stream = &slot->res.stream;
+			if(body_sent < stream->piece_len){
+				if(count == iov_max){
+					rest = true;
+					break;
+				}
+				iov[count].iov_base = stream->piece + body_sent;
+				iov[count].iov_len = stream->piece_len - body_sent;
+				count++;
+				last_is_out = false;
+			}
+			if(!stream->finished) break;
+			continue;
+		}
+		if(slot->res.file.enabled){
+			if(conn->pushed_input){
+				/* Only the current piece is in memory; the list ends behind it. */
+				const struct http_file_body *file = &slot->res.file;
+				size_t piece_end = file->piece_start + file->piece_len;
+				if(body_sent < piece_end){
+					if(count == iov_max){
+						rest = true;
+						break;
+					}
+					iov[count].iov_base = file->buffer + (body_sent - file->piece_start);
+					iov[count].iov_len = piece_end - body_sent;
+					count++;
+					last_is_out = false;
+				}
+				if(piece_end < slot->res.content_length){
+					rest = true;
+					break;
+				}
+				continue;
+			}
+			if(body_sent < slot->res.content_length){
+				rest = true;
+				break;
+			}
+			continue;
+		}
+
+		size_t body_len = slot->body_copied ? 0 : response_body_len(&slot->res);
+		if(body_sent < body_len){
+			if(count == iov_max){
+				rest = true;
+				break;
+			}
+			iov[count].iov_base = (char*)slot->res.body + body_sent;
+			iov[count].iov_len = body_len - body_sent;
+			count++;
+			last_is_out = false;
+		}
+	}
+	if(i == conn->pending_count && !rest && pos < conn->out_len){
+		/* An interim response behind all queued ones. */
+		if(last_is_out){
+			iov[count-1].iov_len += conn->out_len - pos;
+		}else if(count < iov_max){
+			iov[count].iov_base = conn->out + pos;
+			iov[count].iov_len = conn->out_len - pos;
+			count++;
+		}else{
+			rest = true;
+		}
+	}
+	if(more) *more = rest || i < conn->pending_count;
+	return count;
+}
+
+
+/**
+ * @brief Read the next piece of the oldest response's file body once the previous one is sent.
+ *
+ * Only for transports that send memory; the piece reuses the response's
+ * buffer, so a file of any size takes @ref HTTP_FILE_PIECE bytes.
+ *
+ * @return 0 on success or if no piece is due, -1 if the file could not be read.
+ */
+static int conn_file_refill(struct http_conn *conn){
+	if(!conn->pushed_input || conn->pending_count == 0) return 0;
+
+	struct http_conn_pending *slot = &conn->pending[conn->pending_first];
+	const struct http_file_body *file = &slot->res.file;
+	if(!file->enabled || conn->body_sent < file->piece_start + file->piece_len
+	   || conn->body_sent >= slot->res.content_length) return 0;
+	return http_response_file_next(&slot->res, conn->body_sent) < 0 ? -1 : 0;
+}
+
+
+/**
+ * @brief Account for @p n written bytes and retire completed responses.
+ *
+ * Once the current piece of a generated body is out, the next one is
+ * produced; likewise for a file body read into memory. Freeing queue slots may unblock pipelined requests that are
+ * already buffered, so those are dispatched here too.
+ *
+ * @return Events to wait for next, 0 to close (also if a producer failed:
+ *         the body cannot be finished, so the client must see it break off).
+ */
+static int conn_sent(struct http_conn *conn, struct http_core_ctx *core, size_t n){
+	if(n > 0) conn->write_progress = timer_now_ms();
+
+	while(conn->pending_count > 0){
+		struct http_conn_pending *slot = &conn->pending[conn->pending_first];
+
+		size_t out_left = slot->out_end - conn->out_sent;
+		size_t take = n < out_left ? n : out_left;
+		conn->out_sent += take;
+		n -= take;
+
+		size_t body_left = (slot->body_copied ? 0 : response_payload_len(&slot->res)) - conn->body_sent;
+		take = n < body_left ? n : body_left;
+		conn->body_sent += take;
+		n -= take;
+
+		if(conn->out_sent < slot->out_end || take < body_left) break;
+
+		if(slot->res.stream.enabled && !slot->res.stream.finished){
+			if(http_response_stream_next(&slot->res) < 0){
+				conn->state = HTTP_CONN_DONE;
+				return 0;
+			}
+			conn->body_sent = 0;
+			if(slot->res.stream.piece_len > 0) break;
+		}
+
+		http_response_clear(&slot->res);
+		conn->body_sent = 0;
+		conn->pending_first = (conn->pending_first + 1) % HTTP_CONN_PIPELINE_DEPTH;
+		conn->pending_count--;
+	}
+
+	if(conn->pending_count == 0){
+		size_t take = n < conn->out_len - conn->out_sent ? n : conn->out_len - conn->out_sent;
+		conn->out_sent += take;
+		if(conn->out_sent >= conn->out_len){
+			conn->out_len = 0;
+			conn->out_sent = 0;
+		}
+	}
+	if(conn_file_refill(conn) < 0){
+		conn->state = HTTP_CONN_DONE;
+		return 0;
+	}
+
+	conn_process(conn, core, conn->peer_closed);
+	return conn_interest(conn);
+}
+
+
+/**
+ * @brief Whether the oldest queued response is down to its file body.
+ */
+static bool conn_file_pending(const struct http_conn *conn){
+	if(conn->pending_count == 0) return false;
+	const struct http_conn_pending *slot = &conn->pending[conn->pending_first];
+	return slot->res.file.enabled
+		&& conn->out_sent >= slot->out_end
+		&& conn->body_sent < slot->res.content_length;
+}
+
+
+/**
+ * @brief Set or clear TCP_CORK on the connection (see @ref HTTP_OUTPUT_CORK).
+ */
+static void conn_set_cork(struct http_conn *conn, bool on){
+	int value = on ? 1 : 0;
+	if(setsockopt(conn->fd, IPPROTO_TCP, TCP_CORK, &value, sizeof(value)) == 0) conn->corked = on;
+}
+
+
+/**
+ * @brief Write the segments of @p iov, held back per the output policy if @p more follows.
+ */
+static ssize_t conn_write(struct http_conn *conn, struct iovec *iov, int count, bool more){
+	if(more && conn->output_policy == HTTP_OUTPUT_CORK && !conn->corked) conn_set_cork(conn, true);
+	if(!more || conn->output_policy != HTTP_OUTPUT_MORE) return writev(conn->fd, iov, count);
+
+	struct msghdr msg = { .msg_iov = iov, .msg_iovlen = (size_t)count };
+	return sendmsg(conn->fd, &msg, MSG_MORE);
+}
+
+
+/**
+ * @brief Write as much of the queued output as the socket accepts.
+ *
+ * All queued responses go out with one writev(2) unless the socket is full;
+ * a file body is sent with sendfile(2) once everything in front of it is out.
+ * When that takes several calls, the output policy keeps a head from leaving
+ * in a packet of its own; whatever is held back is pushed when the flush ends.
+ *
+ * @return Events to wait for next, 0 to close.
+ */
+static int conn_flush(struct http_conn *conn, struct http_core_ctx *core){
+	struct iovec iov[HTTP_CONN_IOV_MAX];
+	int interest = -1;
+
+	while(conn_output_pending(conn)){
+		bool more;
+		int count = conn_output(conn, iov, HTTP_CONN_IOV_MAX, &more);
+		ssize_t n;
+		if(count > 0){
+			n = conn_write(conn, iov, count, more);
+		}else if(conn_file_pending(conn)){
+			n = http_response_send_file(conn->fd, &conn->pending[conn->pending_first].res, conn->body_sent);
+		}else{
+			break;
+		}
+		if(n < 0){
+			if(errno == EINTR) continue;
+			if(errno != EAGAIN && errno != EWOULDBLOCK) interest = 0;
+			break;
+		}
+		if(n == 0){
+			interest = 0;
+			break;
+		}
+		if(conn_sent(conn, core, (size_t)n) == 0 && conn->state == HTTP_CONN_DONE){
+			interest = 0;
+			break;
+		}
+	}
+
+	if(conn->corked) conn_set_cork(conn, false);
+	if(interest == 0){
+		conn->state = HTTP_CONN_DONE;
+		return 0;
+	}
+	return conn_interest(conn);
+}
+
+
+/**
+ * @brief Stop reading when the read buffer cannot take more input.
+ *
+ * A head that outgrew @ref http_limits::max_head is answered with 431; in
+ * other phases (or if the buffer could not be allocated) the queued
+ * responses are sent and the connection closes.
+ */
+static void conn_input_overflow(struct http_conn *conn){
+	if(conn->state == HTTP_CONN_READ_HEAD && conn->buffer_len >= conn->limits->max_head
+	   && conn_reject(conn, HTTP_HEADERS_TOO_LARGE) == 0) return;
+	conn->state = conn_output_pending(conn) ? HTTP_CONN_DRAIN : HTTP_CONN_DONE;
+}
+
+
+/**
+ * @brief Upper bound for the read buffer in the current phase.
+ */
+static size_t conn_buffer_max(const struct http_conn *conn){
+	if(!conn_has_room(conn)) return HTTP_CONN_BACKLOG_MAX;
+	if(conn->state == HTTP_CONN_READ_BODY){
+		/* Room for the framing around the last chunk of a chunked body. */
+		size_t framing = conn->parser.chunked ? HTTP_MAX_CHUNK_LINE : 0;
+		return conn->parser.head_len + conn->body_target + framing;
+	}
+	if(conn->state == HTTP_CONN_SKIP_BODY || conn->state == HTTP_CONN_FEED_BODY){
+		return conn->parser.head_len + conn->limits->max_body_buffer + HTTP_MAX_CHUNK_LINE;
+	}
+	return conn->limits->max_head;
+}
+
+
+void *http_conn_open(int client_fd, void *context){
+	const struct http_core_ctx *core = (const struct http_core_ctx*)context;
+	struct http_conn *conn = calloc(1, sizeof(struct http_conn));
+	if(!conn) return NULL;
+
+	conn->limits = core && core->limits ? core->limits : http_limits_profile_get(HTTP_LIMITS_DEFAULT);
+	conn->output_policy = core ? core->output_policy : HTTP_OUTPUT_MORE;
+	size_t head_hint = core ? __atomic_load_n(&core->head_hint, __ATOMIC_RELAXED) : 0;
+	size_t initial = http_limits_initial_buffer(conn->limits, head_hint);
+
+	conn->buffer = calloc(1, initial);
+	if(!conn->buffer){
+		free(conn);
+		return NULL;
+	}
+	conn->buffer_cap = initial;
+	conn->fd = client_fd;
+	conn->state = HTTP_CONN_READ_HEAD;
+	conn->phase_start = timer_now_ms();
+	http_parser_init(&conn->parser, conn->limits);
+	http_request_init(&conn->req);
+
+	/* Once per connection, and only if requests are logged at all. */
+	if(access_log_enabled(ACCESS_LOG_WARN)){
+		struct sockaddr_in peer;
+		socklen_t peer_len = sizeof(peer);
+		if(getpeername(client_fd, (struct sockaddr*)&peer, &peer_len) == 0 && peer.sin_family == AF_INET){
+			conn->peer_addr = peer.sin_addr.s_addr;
+			conn->peer_port = ntohs(peer.sin_port);
+		}
+	}
+	return conn;
+}
+
+
+int http_conn_on_ready(void *handle, int revents, void *context){
+	struct http_conn *conn = (struct http_conn*)handle;
+	struct http_core_ctx *core = (struct http_core_ctx*)context;
+	if(!conn || !core) return 0;
+
+	if(conn->state == HTTP_CONN_LINGER){
+		if(revents & (POLLIN | POLLHUP | POLLERR)) conn_linger_read(conn);
+		return conn_interest(conn);
+	}
+
+	if((revents & (POLLIN | POLLHUP | POLLERR)) && conn_can_read(conn)){
+		size_t max = conn_buffer_max(conn);
+		size_t needed = conn->state == HTTP_CONN_READ_HEAD ? conn->buffer_len + 1 : max;
+		if(ensure_capacity(conn, needed, max) < 0){
+			conn_input_overflow(conn);
+		}else{
+			ssize_t n = conn_read(conn);
+			if(n == -1){
+				conn->state = HTTP_CONN_DONE;
+				return 0;
+			}
+			if(n == 0) conn->peer_closed = true;
+			if(n != -2) conn_process(conn, core, conn->peer_closed);
+		}
+	}
+
+	if(conn_output_pending(conn)) return conn_flush(conn, core);
+	return conn_interest(conn);
+}
+
+
+int http_conn_on_data(void *handle, const void *data, size_t len, void *context){
+	struct http_conn *conn = (struct http_conn*)handle;
+	struct http_core_ctx *core = (struct http_core_ctx*)context;
+	if(!conn || !core) return 0;
+	conn->pushed_input = true;
+
+	if(conn->state == HTTP_CONN_LINGER){
+		conn_lingered(conn, len);
+		return conn_interest(conn);
+	}
+
+	if(len == 0){
+		conn->peer_closed = true;
+		conn_process(conn, core, true);
+		return conn_interest(conn);
+	}
+
+	const char *src = (const char*)data;
+	while(len > 0 && conn_reading(conn)){
+		size_t max = conn_buffer_max(conn);
+		size_t needed = conn->buffer_len + len;
+		if(needed > max) needed = max;
+		if(needed <= conn->buffer_len || ensure_capacity(conn, needed, max) < 0){
+			conn_input_overflow(conn);
+			break;
+		}
+
+		size_t chunk = needed - conn->buffer_len;
+		conn_mark_input(conn, chunk);
+		memcpy(conn->buffer + conn->buffer_len, src, chunk);
+		conn->buffer_len += chunk;
+		src += chunk;
+		len -= chunk;
+
+		conn_process(conn, core, false);
+	}
+
+	return conn_interest(conn);
+}
+
+
+int http_conn_pending_output(void *handle, struct iovec *iov, int iov_max, void *context){
+	(void)context;
+	struct http_conn *conn = (struct http_conn*)handle;
+	if(!conn || !iov || iov_max < 1) return 0;
+	return conn_output(conn, iov, iov_max, NULL);
+}
+
+
+int http_conn_output_sent(void *handle, size_t n, void *context){
+	struct http_conn *conn = (struct http_conn*)handle;
+	struct http_core_ctx *core = (struct http_core_ctx*)context;
+	if(!conn || !core) return 0;
+	return conn_sent(conn, core, n);
+}
+
+
+int64_t http_conn_deadline(void *handle, void *context){
+	(void)context;
+	const struct http_conn *conn = (const struct http_conn*)handle;
+	if(!conn) return -1;
+
+	if(conn_output_pending(conn)) return conn->write_progress + HTTP_WRITE_TIMEOUT_MS;
+	switch(conn->state){
+		case HTTP_CONN_READ_BODY:
+		case HTTP_CONN_SKIP_BODY:
+		case HTTP_CONN_FEED_BODY:
+			return conn->read_progress + HTTP_BODY_TIMEOUT_MS;
+		case HTTP_CONN_READ_HEAD:
+			if(conn->buffer_len == 0 && conn->requests > 0) return conn->phase_start + HTTP_KEEPALIVE_IDLE_TIMEOUT_MS;
+			return conn->phase_start + HTTP_HEADER_TIMEOUT_MS;
+		case HTTP_CONN_LINGER:
+			return conn->phase_start + HTTP_LINGER_TIMEOUT_MS;
+		default:
+			return -1;
+	}
+}
+
+
+unsigned http_conn_in_flight(void *handle, void *context){
+	(void)context;
+	const struct http_conn *conn = (const struct http_conn*)handle;
+	if(!conn) return 0;
+
+	bool receiving = conn->state == HTTP_CONN_READ_BODY || conn->state == HTTP_CONN_SKIP_BODY
+				  || conn->state == HTTP_CONN_FEED_BODY
+				  || (conn->state == HTTP_CONN_READ_HEAD && conn->buffer_len > 0);
+	return conn->pending_count + (receiving ? 1 : 0);
+}
+
+
+int http_conn_drain(void *handle, void *context){
+	(void)context;
+	struct http_conn *conn = (struct http_conn*)handle;
+	if(!conn) return 0;
+	conn->draining = true;
+	return conn_interest(conn);
+}
+
+
+void http_conn_close(void *handle, void *context){
+	(void)context;
+	struct http_conn *conn = (struct http_conn*)handle;
+	if(!conn) return;
+	conn_release_sink(conn);
+	http_request_clear(&conn->req);
+	while(conn->pending_count > 0){
+		http_response_clear(&conn->pending[conn->pending_first].res);
+		conn->pending_first = (conn->pending_first + 1) % HTTP_CONN_PIPELINE_DEPTH;
+		conn->pending_count--;
+	}
+	free(conn->out);
+	free(conn->buffer);
+	free(conn);
+}
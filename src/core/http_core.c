@@ -1,35 +1,35 @@
 #include "../../include/core/http_core.h"
-#include "../../include/http/http_parser.h"
-#include "../../include/http/http_request.h"
-#include <stdlib.h>
+#include "../../include/core/http_conn.h"
+#include "../../include/timer_wheel.h"
+#include <errno.h>
+#include <poll.h>
 
 
 int http_handle_connection(int client_fd, void *context){
-	void * buff = calloc(1,250);
-	if(!buff){
-		return -1;
-	}
-	struct http_request *req = calloc(1,sizeof(struct http_request));
-	int ret = -1;
-	if(!req) goto cleanup_buff;
-	http_request_init(req);
+	void *conn = http_conn_open(client_fd, context);
+	if(!conn) return -1;
 
-	if(http_parse_request(client_fd, &buff, 250, req)<0) goto cleanup_req;
+	int interest = POLLIN;
+	while(interest > 0){
+		int timeout_ms = -1;
+		int64_t deadline = http_conn_deadline(conn, context);
+		if(deadline >= 0){
+			int64_t left = deadline - timer_now_ms();
+			if(left <= 0) break;
+			timeout_ms = left < 0x7fffffff ? (int)left : 0x7fffffff;
+		}
 
-	struct http_core_ctx *http_core_context = (struct http_core_ctx*)context;
-	struct http_response res = {0};
-    ret = http_core_context->adapter_handler(req, &res, http_core_context->adapter_context);
-	
-	if(ret >= 0){
-		http_send_response(client_fd, &res);
-	}
+		struct pollfd pfd = { .fd = client_fd, .events = (short)interest };
+		int ready = poll(&pfd, 1, timeout_ms);
+		if(ready < 0){
+			if(errno == EINTR) continue;
+			break;
+		}
+		if(ready == 0) break;
 
-	http_response_clear(&res);
+		interest = http_conn_on_ready(conn, pfd.revents, context);
+	}
 
-	cleanup_req:
-    	http_request_clear(req);
-    	free(req);
-	cleanup_buff:
-    	free(buff);
-    	return ret;
+	http_conn_close(conn, context);
+	return 0;
 }
@@ -87,6 +87,14 @@ int fs_seek(struct fs_file *file, uint64_t offset){
 }
 
 
+int fs_native_fd(struct fs_file *file){
+    if (!file || !file->ops)		return FS_INVALID;
+    if (!file->ops->native_fd)		return FS_NOT_SUPPORTED;
+
+    return file->ops->native_fd(file);
+}
+
+
 int fs_close(struct fs_file *file){
     if (!file || !file->ops)		return FS_INVALID;
     if (!file->ops->close)			return FS_NOT_SUPPORTED;
@@ -0,0 +1,106 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "../../include/http/http_date.h"
+
+/**
+ * @struct date_slot
+ * @brief One formatted second.
+ *
+ * @ref second doubles as a sequence number: it is -1 while @ref text is
+ * rewritten, so a reader that saw the same second before and after its
+ * copy got a consistent value.
+ */
+struct date_slot {
+	int64_t second;					/**< Second @ref text shows (-1 while it is rewritten). */
+	char    text[HTTP_DATE_LEN];	/**< Formatted date. */
+};
+
+
+/** @brief Two slots: readers use the current one while the other is rewritten. */
+static struct date_slot date_slots[2] = { { .second = -1 }, { .second = -1 } };
+
+/** @brief Index of the current slot. */
+static unsigned date_current;
+
+/** @brief Set while a thread rewrites a slot. */
+static int date_updating;
+
+
+/**
+ * @brief Write two decimal digits.
+ */
+static inline void put_2digits(char *out, int value){
+	out[0] = (char)('0' + value / 10);
+	out[1] = (char)('0' + value % 10);
+}
+
+
+/**
+ * @brief Format @p second as IMF-fixdate (independent of the C locale).
+ */
+static void format_date(int64_t second, char *out){
+	static const char days[7][3] = { {'S','u','n'}, {'M','o','n'}, {'T','u','e'}, {'W','e','d'},
+									 {'T','h','u'}, {'F','r','i'}, {'S','a','t'} };
+	static const char months[12][3] = { {'J','a','n'}, {'F','e','b'}, {'M','a','r'}, {'A','p','r'},
+										{'M','a','y'}, {'J','u','n'}, {'J','u','l'}, {'A','u','g'},
+										{'S','e','p'}, {'O','c','t'}, {'N','o','v'}, {'D','e','c'} };
+	time_t t = (time_t)second;
+	struct tm tm;
+	gmtime_r(&t, &tm);
+
+	memcpy(out, days[tm.tm_wday], 3);
+	out[3] = ',';
+	out[4] = ' ';
+	put_2digits(out + 5, tm.tm_mday);
+	out[7] = ' ';
+	memcpy(out + 8, months[tm.tm_mon], 3);
+	out[11] = ' ';
+	int year = tm.tm_year + 1900;
+	put_2digits(out + 12, year / 100 % 100);
+	put_2digits(out + 14, year % 100);
+	out[16] = ' ';
+	put_2digits(out + 17, tm.tm_hour);
+	out[19] = ':';
+	put_2digits(out + 20, tm.tm_min);
+	out[22] = ':';
+	put_2digits(out + 23, tm.tm_sec);
+	memcpy(out + 25, " GMT", 4);
+}
+
+
+/**
+ * @brief Copy the current slot if it shows @p second.
+ *
+ * @return true on success, false if the slot is stale or was rewritten meanwhile.
+ */
+static bool date_read(int64_t second, char *out){
+	const struct date_slot *slot = &date_slots[__atomic_load_n(&date_current, __ATOMIC_ACQUIRE)];
+	if(__atomic_load_n(&slot->second, __ATOMIC_ACQUIRE) != second) return false;
+	memcpy(out, slot->text, HTTP_DATE_LEN);
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&slot->second, __ATOMIC_RELAXED) == second;
+}
+
+
+void http_date_now(char *out){
+	int64_t second = (int64_t)time(NULL);
+	if(date_read(second, out)) return;
+
+	/* A new second: one thread formats it into the spare slot and publishes it. */
+	if(!__atomic_exchange_n(&date_updating, 1, __ATOMIC_ACQUIRE)){
+		unsigned next = __atomic_load_n(&date_current, __ATOMIC_RELAXED) ^ 1u;
+		struct date_slot *slot = &date_slots[next];
+		__atomic_store_n(&slot->second, -1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		format_date(second, slot->text);
+		__atomic_store_n(&slot->second, second, __ATOMIC_RELEASE);
+		__atomic_store_n(&date_current, next, __ATOMIC_RELEASE);
+		__atomic_store_n(&date_updating, 0, __ATOMIC_RELEASE);
+		if(date_read(second, out)) return;
+	}
+
+	/* Another thread is publishing right now: format privately rather than wait. */
+	format_date(second, out);
+}
@@ -0,0 +1,124 @@
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include "../../include/http/http_fields.h"
+
+/**
+ * @def HEADER_HASH_SIZE
+ * @brief Slots of the header name hash table (a power of two).
+ */
+#define HEADER_HASH_SIZE 32
+
+
+/** @brief Canonical names, indexed by @ref http_header_id. */
+static const char *const header_names[HTTP_HEADER_COUNT] = {
+	[HTTP_HEADER_OTHER]				= NULL,
+	[HTTP_HEADER_HOST]				= "Host",
+	[HTTP_HEADER_CONTENT_LENGTH]	= "Content-Length",
+	[HTTP_HEADER_CONTENT_TYPE]		= "Content-Type",
+	[HTTP_HEADER_CONNECTION]		= "Connection",
+	[HTTP_HEADER_TRANSFER_ENCODING]	= "Transfer-Encoding",
+	[HTTP_HEADER_TE]				= "TE",
+	[HTTP_HEADER_EXPECT]			= "Expect",
+	[HTTP_HEADER_ACCEPT]			= "Accept",
+	[HTTP_HEADER_ACCEPT_ENCODING]	= "Accept-Encoding",
+	[HTTP_HEADER_USER_AGENT]		= "User-Agent",
+	[HTTP_HEADER_UPGRADE]			= "Upgrade",
+	[HTTP_HEADER_IF_NONE_MATCH]		= "If-None-Match",
+	[HTTP_HEADER_IF_MODIFIED_SINCE]	= "If-Modified-Since",
+	[HTTP_HEADER_RANGE]				= "Range",
+	[HTTP_HEADER_COOKIE]			= "Cookie",
+	[HTTP_HEADER_AUTHORIZATION]		= "Authorization"
+};
+
+
+/**
+ * @brief Perfect hash of the well-known names: length, first and last letter.
+ *
+ * Folding with 0x20 makes ASCII letters case-insensitive; other bytes only
+ * land in some slot and fail the comparison there.
+ */
+static inline unsigned header_hash(const char *name, size_t len){
+	unsigned first = (unsigned char)name[0] | 0x20u;
+	unsigned last = (unsigned char)name[len - 1] | 0x20u;
+	return ((unsigned)len + first + (last << 2)) & (HEADER_HASH_SIZE - 1);
+}
+
+
+/**
+ * @brief Identifier in each hash slot; every well-known name has a slot of its own.
+ *
+ * Must be kept in sync with @ref header_names and @ref header_hash.
+ */
+static const unsigned char header_slots[HEADER_HASH_SIZE] = {
+	[ 1] = HTTP_HEADER_TRANSFER_ENCODING,
+	[ 3] = HTTP_HEADER_CONTENT_TYPE,
+	[ 5] = HTTP_HEADER_CONNECTION,
+	[ 6] = HTTP_HEADER_AUTHORIZATION,
+	[10] = HTTP_HEADER_TE,
+	[11] = HTTP_HEADER_RANGE,
+	[12] = HTTP_HEADER_ACCEPT_ENCODING,
+	[14] = HTTP_HEADER_IF_MODIFIED_SINCE,
+	[15] = HTTP_HEADER_USER_AGENT,
+	[16] = HTTP_HEADER_UPGRADE,
+	[17] = HTTP_HEADER_CONTENT_LENGTH,
+	[22] = HTTP_HEADER_IF_NONE_MATCH,
+	[23] = HTTP_HEADER_ACCEPT,
+	[27] = HTTP_HEADER_EXPECT,
+	[28] = HTTP_HEADER_HOST,
+	[29] = HTTP_HEADER_COOKIE
+};
+
+
+enum http_header_id http_header_id_of(const char *name, size_t len){
+	if(!name || len == 0) return HTTP_HEADER_OTHER;
+
+	enum http_header_id id = (enum http_header_id)header_slots[header_hash(name, len)];
+	const char *candidate = header_names[id];
+	if(!candidate || strlen(candidate) != len || strncasecmp(candidate, name, len) != 0) return HTTP_HEADER_OTHER;
+	return id;
+}
+
+
+const char *http_header_name(enum http_header_id id){
+	if((unsigned)id >= HTTP_HEADER_COUNT) return NULL;
+	return header_names[id];
+}
+
+
+enum http_method http_method_of(const char *method, size_t len){
+	if(!method) return HTTP_METHOD_OTHER;
+
+	switch(len){
+		case 3:
+			if(memcmp(method, "GET", 3) == 0) return HTTP_METHOD_GET;
+			if(memcmp(method, "PUT", 3) == 0) return HTTP_METHOD_PUT;
+			break;
+		case 4:
+			if(memcmp(method, "POST", 4) == 0) return HTTP_METHOD_POST;
+			if(memcmp(method, "HEAD", 4) == 0) return HTTP_METHOD_HEAD;
+			break;
+		case 5:
+			if(memcmp(method, "PATCH", 5) == 0) return HTTP_METHOD_PATCH;
+			if(memcmp(method, "TRACE", 5) == 0) return HTTP_METHOD_TRACE;
+			break;
+		case 6:
+			if(memcmp(method, "DELETE", 6) == 0) return HTTP_METHOD_DELETE;
+			break;
+		case 7:
+			if(memcmp(method, "OPTIONS", 7) == 0) return HTTP_METHOD_OPTIONS;
+			if(memcmp(method, "CONNECT", 7) == 0) return HTTP_METHOD_CONNECT;
+			break;
+		default:
+			break;
+	}
+	return HTTP_METHOD_OTHER;
+}
+
+
+enum http_version http_version_of(const char *version, size_t len){
+	if(!version || len != 8 || memcmp(version, "HTTP/1.", 7) != 0) return HTTP_VERSION_OTHER;
+	if(version[7] == '1') return HTTP_VERSION_1_1;
+	if(version[7] == '0') return HTTP_VERSION_1_0;
+	return HTTP_VERSION_OTHER;
+}
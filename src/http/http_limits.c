@@ -0,0 +1,109 @@
+#include <stddef.h>
+#include <string.h>
+#include "../../include/http/http_limits.h"
+#include "../../include/http/http_request.h"
+
+/**
+ * @def HTTP_LIMITS_MIN_HEAD
+ * @brief Smallest head limit accepted by @ref http_limits_normalize.
+ */
+#define HTTP_LIMITS_MIN_HEAD 64
+
+/**
+ * @def HTTP_LIMITS_MIN_BODY_BUFFER
+ * @brief Smallest body buffer accepted by @ref http_limits_normalize.
+ */
+#define HTTP_LIMITS_MIN_BODY_BUFFER 64
+
+/**
+ * @def HTTP_LIMITS_MAX_BODY_BUFFER
+ * @brief Largest body buffer accepted by @ref http_limits_normalize.
+ *
+ * Every connection reading a body may hold this much, so it bounds the
+ * memory a listener commits per connection; larger bodies are pulled by
+ * the handler or fed to its sink piece by piece anyway.
+ */
+#define HTTP_LIMITS_MAX_BODY_BUFFER (1u << 20)
+
+
+/** @brief Profiles, indexed by @ref http_limits_profile. */
+static const struct http_limits profiles[] = {
+	[HTTP_LIMITS_DEFAULT] = {
+		.max_head 		 = HTTP_MAX_HEADERS_BUFFER,
+		.max_headers 	 = HTTP_MAX_HEADERS,
+		.max_path 		 = HTTP_MAX_PATH,
+		.max_body_buffer = HTTP_MAX_BODY_BUFFER,
+		.max_body 		 = 8u << 20,
+		.initial_buffer  = 256,
+		.adaptive_buffer = true
+	},
+	[HTTP_LIMITS_TINY] = {
+		.max_head 		 = 1024,
+		.max_headers 	 = 8,
+		.max_path 		 = 256,
+		.max_body_buffer = 512,
+		.max_body 		 = 16u << 10,
+		.initial_buffer  = 256,
+		.adaptive_buffer = false
+	},
+	[HTTP_LIMITS_LARGE_UPLOAD] = {
+		.max_head 		 = 8192,
+		.max_headers 	 = HTTP_MAX_HEADERS,
+		.max_path 		 = HTTP_MAX_PATH,
+		.max_body_buffer = 65536,
+		.max_body 		 = 0,
+		.initial_buffer  = 512,
+		.adaptive_buffer = true
+	}
+};
+
+
+/** @brief Names accepted by @ref http_limits_profile_from_name, indexed by @ref http_limits_profile. */
+static const char *const profile_names[] = {
+	[HTTP_LIMITS_DEFAULT] 		= "default",
+	[HTTP_LIMITS_TINY] 			= "tiny",
+	[HTTP_LIMITS_LARGE_UPLOAD] 	= "large-upload"
+};
+
+
+const struct http_limits *http_limits_profile_get(enum http_limits_profile profile){
+	if((unsigned)profile >= sizeof(profiles) / sizeof(profiles[0])) profile = HTTP_LIMITS_DEFAULT;
+	return &profiles[profile];
+}
+
+
+int http_limits_profile_from_name(const char *name, enum http_limits_profile *profile){
+	if(!name || !profile) return -1;
+	for(size_t i = 0; i < sizeof(profile_names) / sizeof(profile_names[0]); i++){
+		if(strcmp(name, profile_names[i]) == 0){
+			*profile = (enum http_limits_profile)i;
+			return 0;
+		}
+	}
+	return -1;
+}
+
+
+void http_limits_normalize(struct http_limits *limits){
+	if(!limits) return;
+	if(limits->max_head < HTTP_LIMITS_MIN_HEAD) limits->max_head = HTTP_LIMITS_MIN_HEAD;
+	if(limits->max_headers < 1) limits->max_headers = 1;
+	if(limits->max_headers > HTTP_MAX_HEADERS) limits->max_headers = HTTP_MAX_HEADERS;
+	if(limits->max_path < 1) limits->max_path = 1;
+	if(limits->initial_buffer < HTTP_LIMITS_MIN_HEAD) limits->initial_buffer = HTTP_LIMITS_MIN_HEAD;
+	if(limits->initial_buffer > limits->max_head) limits->initial_buffer = limits->max_head;
+	if(limits->max_body_buffer < HTTP_LIMITS_MIN_BODY_BUFFER) limits->max_body_buffer = HTTP_LIMITS_MIN_BODY_BUFFER;
+	if(limits->max_body_buffer > HTTP_LIMITS_MAX_BODY_BUFFER) limits->max_body_buffer = HTTP_LIMITS_MAX_BODY_BUFFER;
+	if(limits->max_body > 0 && limits->max_body_buffer > limits->max_body) limits->max_body_buffer = limits->max_body;
+}
+
+
+size_t http_limits_initial_buffer(const struct http_limits *limits, size_t head_hint){
+	if(!limits->adaptive_buffer || head_hint == 0) return limits->initial_buffer;
+
+	/* A quarter of headroom, so heads a little above the average still fit. */
+	size_t wanted = head_hint + head_hint / 4;
+	size_t size = limits->initial_buffer;
+	while(size < wanted && size < limits->max_head) size *= 2;
+	return size < limits->max_head ? size : limits->max_head;
+}
@@ -1,9 +1,13 @@
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include "../../include/http/http_parser.h"
 #include "../../include/http/http_common.h"
+#include "../../include/http/http_scan.h"
 #include "../../include/reader.h"
 
 static const short DEBUG_OUT = 0;
@@ -75,10 +79,14 @@ static int find_crlf(const char *string, size_t len){
     if (!string) {
 		return -1;
 	}
-	for (size_t i = 0; i + 1 < len; i++){
-        if (string[i]=='\r' && string[i+1]=='\n'){
+	size_t i = 0;
+	while(i + 1 < len){
+		i += http_scan_cr(string + i, len - i - 1);
+		if(i + 1 >= len) break;
+		if(string[i+1]=='\n'){
 			return i;
 		}
+		i++;
 	}
 	return -1;
 }
@@ -96,66 +104,9 @@ static int find_double_crlf(const char *string, size_t len){
     if (!string) {
 		return -1;
 	}
-	for (size_t i = 0; i + 3 < len; i++){
-        if (string[i]=='\r' && string[i+1]=='\n' && string[i+2]=='\r' && string[i+3]=='\n'){
-			return i;
-		}
-	}
-    return -1;
-}
-
-/**
- * @brief Read from a file descriptor until double CRLF ("\r\n\r\n") is encountered.
- *
- * @param fd File 				descriptor to read from.
- * @param buffer 				Pointer to buffer pointer (gets reallocated if needed).
- * @param buffer_len 			Initial buffer length.
- * @param new_buff_max 			Maximum allowed buffer size.
- * @param new_buff_len [out] 	Final allocated buffer size.
- * @param total_read [out] 		Number of bytes read.
- *
- * @return int 					Index of "\r\n\r\n" in buffer, or -1 on error.
- */
-static int read_until_double_crlf(
-    int fd,
-    void **buffer,
-	size_t buffer_len,
-    size_t new_buff_max,
-	size_t *new_buff_len,
-    size_t *total_read
-){
-	if(!buffer || !new_buff_len || !total_read || buffer_len<1 || new_buff_max <1) return -1;
-
-	ssize_t currently_read = 0;
-	size_t chunk_size = buffer_len;
-	int chunk_count = 1;
-
-	while(1){
-
-		currently_read = read_some(fd, (char*)(*buffer) + *total_read, chunk_size*chunk_count - *total_read);
-		if(currently_read<0){
-			return -1;
-		}
-		*total_read += currently_read;
-
-		int idx = find_double_crlf((const char*)*buffer, *total_read);
-		if(idx == -1){
-			chunk_count++;
-
-			if(chunk_size*chunk_count <= new_buff_max){
-				void *tmp = realloc(*buffer, chunk_size*chunk_count);
-				if(!tmp){
-					return -1;
-				}
-				*buffer = tmp;
-			}else{
-				return -1;
-			}
-			continue;
-		}
-		*new_buff_len = chunk_size * chunk_count;
-		return idx;
-	}
+	struct http_head_scan scan;
+	http_head_scan_reset(&scan);
+    return http_head_scan(&scan, string, len);
 }
 
 
@@ -206,20 +157,169 @@ int read_body(int fd, char **buffer, size_t buffer_len, size_t headers_end,
 
 	size_t actual_body_len = currently_read_body+already_read_body;
 
-	char *tmp = calloc(actual_body_len+1, sizeof(char));
-	if(!tmp) return -1;
+	if(http_parse_request_body(*buffer+headers_end+4, actual_body_len, content_len, req) < 0) return -1;
 	
-	memcpy(tmp,*buffer+headers_end+4,actual_body_len);
-	tmp[actual_body_len]='\0';
-	req->body=tmp;
-	req->content_length=actual_body_len;
+	return currently_read_body;
+}
+
 
-	if(actual_body_len < content_len){
-		fprintf(stderr,"read %zu characters into body, but content_length is %zu\n",
-		 actual_body_len,content_len);
+/**
+ * @brief Value of a hex digit, or -1.
+ */
+static inline int hex_value(char c){
+	if(c >= '0' && c <= '9') return c - '0';
+	if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+
+/**
+ * @brief Percent-decode @p len bytes of @p s in place.
+ *
+ * A '%' not followed by two hex digits is kept literally.
+ *
+ * @param plus_space 	Decode '+' as a blank (form encoding of the query).
+ *
+ * @return Decoded length (never larger than @p len); the result is not NUL-terminated.
+ */
+static size_t percent_decode(char *s, size_t len, bool plus_space){
+	size_t out = 0;
+	for(size_t i = 0; i < len; i++){
+		char c = s[i];
+		if(c == '%' && i + 2 < len){
+			int hi = hex_value(s[i + 1]);
+			int lo = hex_value(s[i + 2]);
+			if(hi >= 0 && lo >= 0){
+				c = (char)(hi << 4 | lo);
+				i += 2;
+			}
+		} else if(c == '+' && plus_space){
+			c = ' ';
+		}
+		s[out++] = c;
 	}
-	
-	return currently_read_body;
+	return out;
+}
+
+
+/**
+ * @brief Split a query string in place into @ref http_request::params.
+ *
+ * Pairs are separated by '&', names from values by the first '='; both are
+ * percent-decoded and NUL-terminated in place. Pairs with an empty name and
+ * pairs beyond @ref HTTP_MAX_QUERY_PARAMS are dropped.
+ *
+ * @param query 	Query string without the '?'; query[len] must be writable.
+ */
+static void parse_query(char *query, size_t len, struct http_request *req){
+	size_t pos = 0;
+	while(pos < len && req->param_count < HTTP_MAX_QUERY_PARAMS){
+		char *pair = query + pos;
+		char *amp = memchr(pair, '&', len - pos);
+		size_t pair_len = amp ? (size_t)(amp - pair) : len - pos;
+		pos += pair_len + 1;
+
+		char *eq = memchr(pair, '=', pair_len);
+		size_t name_len = eq ? (size_t)(eq - pair) : pair_len;
+		char *value = eq ? eq + 1 : pair + pair_len;
+		size_t value_len = eq ? pair_len - name_len - 1 : 0;
+
+		name_len = percent_decode(pair, name_len, true);
+		pair[name_len] = '\0';
+		value_len = percent_decode(value, value_len, true);
+		value[value_len] = '\0';
+		if(name_len == 0) continue;
+
+		struct http_query_param *param = &req->params[req->param_count++];
+		param->name = pair;
+		param->name_len = name_len;
+		param->value = value;
+		param->value_len = value_len;
+	}
+}
+
+
+/**
+ * @brief Canonicalize an absolute path in place.
+ *
+ * Collapses runs of '/', drops "." segments and resolves ".." against the
+ * segment before it (RFC 3986, section 5.2.4). A trailing slash, or a
+ * trailing "." or ".." segment, leaves the result ending in '/'.
+ *
+ * @param path 	Path starting with '/'; path[len] must be writable.
+ *
+ * @return Canonical length, or -1 if a ".." segment would climb above the root.
+ */
+static long canonicalize_path(char *path, size_t len){
+	/* path[0..out) always ends in '/' when the next segment is appended. */
+	size_t out = 1;
+	size_t i = 1;
+	while(i < len){
+		if(path[i] == '/'){
+			i++;
+			continue;
+		}
+		size_t seg = i;
+		while(i < len && path[i] != '/') i++;
+		size_t seg_len = i - seg;
+
+		if(seg_len == 1 && path[seg] == '.') continue;
+		if(seg_len == 2 && path[seg] == '.' && path[seg + 1] == '.'){
+			if(out == 1) return -1;
+			out--;
+			while(path[out - 1] != '/') out--;
+			continue;
+		}
+		memmove(path + out, path + seg, seg_len);
+		out += seg_len;
+		if(i < len) path[out++] = '/';
+	}
+	path[out] = '\0';
+	return (long)out;
+}
+
+
+/**
+ * @brief Split the request target in place into path, query and fragment.
+ *
+ * The fragment is dropped, the query goes to @ref http_request::params and
+ * the path is percent-decoded and canonicalized (@ref canonicalize_path)
+ * once, so nothing downstream rescans the raw target or checks for
+ * traversal again. Targets not starting with '/' (asterisk- and
+ * absolute-form) are only decoded. @ref http_request::path must be
+ * NUL-terminated and writable.
+ *
+ * @return 0 on success, -1 if the path decodes to a NUL byte or climbs above the root.
+ */
+static int split_target(struct http_request *req){
+	char *path = req->path;
+	size_t len = req->path_len;
+	req->param_count = 0;
+
+	char *hash = memchr(path, '#', len);
+	if(hash){
+		*hash = '\0';
+		len = (size_t)(hash - path);
+	}
+	char *query = memchr(path, '?', len);
+	if(query){
+		*query = '\0';
+		parse_query(query + 1, len - (size_t)(query - path) - 1, req);
+		len = (size_t)(query - path);
+	}
+	if(memchr(path, '%', len)){
+		len = percent_decode(path, len, false);
+		if(memchr(path, '\0', len)) return -1;
+		path[len] = '\0';
+	}
+	if(path[0] == '/'){
+		long canonical_len = canonicalize_path(path, len);
+		if(canonical_len < 0) return -1;
+		len = (size_t)canonical_len;
+	}
+	req->path_len = len;
+	return 0;
 }
 
 
@@ -231,8 +331,10 @@ int http_parse_request_line(const char *buffer, size_t buffer_len, struct http_r
 	}
 
 	char** req_struct_ptrs[] = {&req->method, &req->path, &req->version};
+	size_t *req_struct_lens[] = {&req->method_len, &req->path_len, &req->version_len};
 	int token_end = 0;
 	int idx = 0;
+	req->line_owned = true;
 	for(int i=0;i<3;i++){
 		token_end = find_token_end(req_line_ptr+idx, req_line_end-idx, ' ');
 		token_end++;
@@ -243,11 +345,15 @@ int http_parse_request_line(const char *buffer, size_t buffer_len, struct http_r
 		memcpy(tmp, req_line_ptr+idx, token_end);
 		tmp[token_end]='\0';
 		*req_struct_ptrs[i] = tmp;
+		*req_struct_lens[i] = (size_t)token_end;
 
 		idx += token_end+1;
 	}
+	req->method_id = http_method_of(req->method, req->method_len);
+	req->version_id = http_version_of(req->version, req->version_len);
+	if(split_target(req) < 0) return -1;
 
-	return req_line_end+1;
+	return req_line_end+2;
 }
 
 
@@ -292,9 +398,11 @@ int http_parse_request_headers(const char *buffer, size_t buffer_len, int *heade
 
 			if(i == 0){
 				header.name = tmp;
+				header.name_len = (size_t)token_len;
 				header.name_owned = true;
 			}else{
 				header.value = tmp;
+				header.value_len = (size_t)token_len;
 				header.value_owned = true;
 			}
 			idx+=token_end+2;
@@ -307,42 +415,67 @@ int http_parse_request_headers(const char *buffer, size_t buffer_len, int *heade
 	if(!headers) return -1;
 
 	for(int i=0;i<header_count;i++){
-		headers[i].name = headers_tmp[i].name;
-		headers[i].name_owned = headers_tmp[i].name_owned;
-		headers[i].value = headers_tmp[i].value;
-		headers[i].value_owned = headers_tmp[i].value_owned;
+		headers[i] = headers_tmp[i];
 	}
 	req->headers=headers;
 	req->num_headers = header_count;
+	http_request_index_headers(req);
 	return header_count;
 }
 
 
-int http_parse_request(int fd, void **buffer, size_t buffer_len, struct http_request *req){
+int http_find_headers_end(const char *buffer, size_t len){
+	return find_double_crlf(buffer, len);
+}
 
-	if(!req || !buffer || !(*buffer) || buffer_len <1){
-		fprintf(stderr, "error reading request, invalid args\n");
-		return -1;
-	};
 
-	size_t headers_max = HTTP_MAX_HEADERS_BUFFER;
-	size_t body_max = HTTP_MAX_BODY_BUFFER;
-	size_t total_read = 0;
-	size_t new_buff_len = 0;
-	int headers_dropped = 0;
-	
-	if(DEBUG_OUT)
-		printf("\n############ Parse request ############\n");
+/**
+ * @brief Read the declared body length from every Content-Length header.
+ *
+ * A value must be digits only (the parser already trimmed surrounding
+ * whitespace) and fit in a size_t. Repeated headers must all carry the same
+ * value; anything else could be read differently by an intermediary.
+ *
+ * @return 0 on success (@p content_len is 0 without the header), -1 if the length is invalid.
+ */
+static int parse_content_length(const struct http_request *req, size_t *content_len){
+	*content_len = 0;
+	uint8_t first = req->header_index[HTTP_HEADER_CONTENT_LENGTH];
+	if(first == 0) return 0;
+
+	bool seen = false;
+	for(size_t i = first - 1; i < req->num_headers; i++){
+		const struct http_header *header = &req->headers[i];
+		size_t name_len = header->name_len ? header->name_len : strlen(header->name);
+		if(http_header_id_of(header->name, name_len) != HTTP_HEADER_CONTENT_LENGTH) continue;
+
+		const char *value = header->value;
+		if(*value < '0' || *value > '9') return -1;
+		size_t parsed = 0;
+		for(; *value >= '0' && *value <= '9'; value++){
+			if(parsed > (SIZE_MAX - (size_t)(*value - '0')) / 10) return -1;
+			parsed = parsed * 10 + (size_t)(*value - '0');
+		}
+		if(*value != '\0') return -1;
 
-	int headers_end = read_until_double_crlf(fd, buffer, buffer_len, headers_max, &new_buff_len, &total_read);
-	if(headers_end == -1){
-		fprintf(stderr, "error reading request headers\n");
-		return -1;
+		if(seen && parsed != *content_len) return -1;
+		*content_len = parsed;
+		seen = true;
 	}
+	return 0;
+}
 
-	int req_line_end = http_parse_request_line(*buffer, total_read, req);
+
+int http_parse_request_head(const char *buffer, size_t headers_end, size_t *content_len_out, 
+							struct http_request *req){
+
+	if(!buffer || !content_len_out || !req) return -1;
+
+	size_t head_len = headers_end + 4;
+	int headers_dropped = 0;
+
+	int req_line_end = http_parse_request_line(buffer, head_len, req);
 	if(req_line_end < 0){	
-		fprintf(stderr, "error parsing request line\n");
 		return -1;
 	}
 
@@ -353,36 +486,474 @@ int http_parse_request(int fd, void **buffer, size_t buffer_len, struct http_req
 		printf("Version: %s\n", req->version);
 	}
 
-	int headers_parsed = http_parse_request_headers(*buffer+req_line_end, total_read-req_line_end, 
+	int headers_parsed = http_parse_request_headers(buffer+req_line_end, head_len-req_line_end, 
 												  &headers_dropped, req);
 	if(headers_parsed<0){
-		fprintf(stderr, "error parsing request headers\n");
 		return -1;
 	}
 
 	if(DEBUG_OUT)
 		printf("\nheaders parsed: %zu, headers dropped: %d\n\n",req->num_headers,headers_dropped);
 
-	size_t content_len = 0;
-	char content_len_header_name[] = "Content-Length";
-	for(int i=0;i<headers_parsed;i++){
-		printf("%s: \"%s\"\n",req->headers[i].name,req->headers[i].value);
-		if(strncmp(req->headers[i].name,content_len_header_name, strlen(content_len_header_name))==0){
-			content_len=atoll(req->headers[i].value);
+	if(DEBUG_OUT){
+		for(int i=0;i<headers_parsed;i++) printf("%s: \"%s\"\n",req->headers[i].name,req->headers[i].value);
+	}
+
+	return parse_content_length(req, content_len_out);
+}
+
+
+/**
+ * @brief Narrow [@p *start, @p *end) by leading and trailing spaces and tabs.
+ */
+static void trim_span(const char *buffer, size_t *start, size_t *end){
+	while(*start < *end && (buffer[*start] == ' ' || buffer[*start] == '\t')) (*start)++;
+	while(*end > *start && (buffer[*end - 1] == ' ' || buffer[*end - 1] == '\t')) (*end)--;
+}
+
+
+/**
+ * @brief Locate the CR ending line number @p line, which starts at @p pos.
+ *
+ * Uses the line ends recorded by @p scan where it has them and searches
+ * otherwise.
+ *
+ * @return Index of the CR, or -1 if the line is not terminated before @p head_len.
+ */
+static long line_end_at(const char *buffer, size_t pos, size_t head_len, const struct http_head_scan *scan, uint32_t line){
+	if(scan && line < scan->line_count && line < HTTP_SCAN_MAX_LINES) return (long)scan->line_ends[line];
+	int len = find_crlf(buffer + pos, head_len - pos);
+	return len < 0 ? -1 : (long)(pos + (size_t)len);
+}
+
+
+/**
+ * @brief Split the request line in place into method, path and version views.
+ *
+ * The separating spaces and the CR are overwritten with NUL; the target is
+ * then split further by @ref split_target.
+ *
+ * @param line_end 	Index of the CR ending the request line.
+ * @param max_path 	Longest accepted request target.
+ *
+ * @return Index of the first byte after the request line's CRLF, or -1 if malformed or too long.
+ */
+static long parse_request_line_inplace(char *buffer, long line_end, size_t max_path, struct http_request *req){
+	if(line_end <= 0) return -1;
+
+	char *line = buffer;
+	char *method_end = memchr(line, ' ', (size_t)line_end);
+	if(!method_end) return -1;
+	char *path = method_end + 1;
+	char *path_end = memchr(path, ' ', (size_t)(line + line_end - path));
+	if(!path_end) return -1;
+	char *version = path_end + 1;
+	if((size_t)(path_end - path) > max_path) return -1;
+
+	*method_end = '\0';
+	*path_end = '\0';
+	line[line_end] = '\0';
+
+	req->method = line;
+	req->method_len = (size_t)(method_end - line);
+	req->path = path;
+	req->path_len = (size_t)(path_end - path);
+	req->version = version;
+	req->version_len = (size_t)(line + line_end - version);
+	req->line_owned = false;
+	req->method_id = http_method_of(req->method, req->method_len);
+	req->version_id = http_version_of(req->version, req->version_len);
+	if(split_target(req) < 0) return -1;
+	return line_end + 2;
+}
+
+
+/**
+ * @brief Split header lines in place into name/value views stored in @ref http_request::header_slots.
+ *
+ * Names and values are trimmed; the byte after each of them (':', blank or
+ * CR) is overwritten with NUL. Lines without a colon and lines beyond
+ * @p max_headers are dropped.
+ *
+ * @param pos 		Index of the first header line.
+ * @param head_len 	Index just past the last header's CRLF.
+ * @param scan 		Line ends found while framing the head (may be NULL).
+ * @param max_headers 	Headers to keep (at most @ref HTTP_MAX_HEADERS).
+ *
+ * @return Number of headers stored.
+ */
+static int parse_headers_inplace(char *buffer, size_t pos, size_t head_len, const struct http_head_scan *scan,
+								 size_t max_headers, int *headers_dropped, struct http_request *req){
+	int count = 0;
+
+	/* Line 0 is the request line. */
+	for(uint32_t line = 1; pos < head_len; line++){
+		long cr = line_end_at(buffer, pos, head_len, scan, line);
+		if(cr <= (long)pos) break;
+		size_t line_end = (size_t)cr;
+
+		char *colon = memchr(buffer + pos, ':', line_end - pos);
+		if(!colon || (size_t)count >= max_headers){
+			(*headers_dropped)++;
+			pos = line_end + 2;
+			continue;
 		}
+
+		size_t name_start = pos, name_end = (size_t)(colon - buffer);
+		size_t value_start = name_end + 1, value_end = line_end;
+		trim_span(buffer, &name_start, &name_end);
+		trim_span(buffer, &value_start, &value_end);
+		buffer[name_end] = '\0';
+		buffer[value_end] = '\0';
+
+		req->header_slots[count] = (struct http_header){
+			.name 	   = buffer + name_start,
+			.name_len  = name_end - name_start,
+			.value 	   = buffer + value_start,
+			.value_len = value_end - value_start
+		};
+		count++;
+		pos = line_end + 2;
 	}
 
-	if(content_len == 0){
-		if(DEBUG_OUT)
-			printf("########## Parse request END ##########\n\n");
+	req->headers = req->header_slots;
+	req->num_headers = (size_t)count;
+	http_request_index_headers(req);
+	return count;
+}
+
+
+int http_parse_request_head_inplace(char *buffer, size_t headers_end, const struct http_head_scan *scan,
+									const struct http_limits *limits, size_t *content_len_out,
+									struct http_request *req){
+	if(!buffer || !content_len_out || !req) return -1;
+	if(!limits) limits = http_limits_profile_get(HTTP_LIMITS_DEFAULT);
+	size_t max_headers = limits->max_headers < HTTP_MAX_HEADERS ? limits->max_headers : HTTP_MAX_HEADERS;
+
+	/* Up to and including the last header's CRLF. */
+	size_t head_len = headers_end + 2;
+	int headers_dropped = 0;
+
+	long line_end = parse_request_line_inplace(buffer, line_end_at(buffer, 0, head_len, scan, 0), limits->max_path, req);
+	if(line_end < 0){
+		return -1;
+	}
+
+	int headers_parsed = parse_headers_inplace(buffer, (size_t)line_end, head_len, scan, max_headers,
+											   &headers_dropped, req);
+
+	if(DEBUG_OUT)
+		printf("\nheaders parsed: %d, headers dropped: %d\n\n", headers_parsed, headers_dropped);
+
+	return parse_content_length(req, content_len_out);
+}
+
+
+int http_parse_request_body(const char *body, size_t body_len, size_t content_len, struct http_request *req){
+	(void)content_len;
+	if(!req || (!body && body_len > 0)) return -1;
+
+	char *tmp = calloc(body_len+1, sizeof(char));
+	if(!tmp) return -1;
+	
+	if(body_len > 0) memcpy(tmp, body, body_len);
+	tmp[body_len]='\0';
+	req->body=tmp;
+	req->body_owned=true;
+	req->content_length=body_len;
+	return 0;
+}
+
+
+void http_parser_init(struct http_parser *parser, const struct http_limits *limits){
+	*parser = (struct http_parser){
+		.limits = limits ? limits : http_limits_profile_get(HTTP_LIMITS_DEFAULT),
+		.phase 	= HTTP_PARSER_HEAD
+	};
+	http_head_scan_reset(&parser->scan);
+}
+
+
+/**
+ * @brief Decide how the body of a parsed head is delimited.
+ *
+ * A request with both Transfer-Encoding and Content-Length is refused
+ * (RFC 9112 section 6.1): an intermediary that honours the other header
+ * would see a different request boundary. Transfer-Encoding is refused on
+ * HTTP/1.0 as well, and so is any final coding other than chunked, which
+ * leaves the body length unknown.
+ *
+ * @return 0 on success, -1 if the body cannot be delimited.
+ */
+static int parser_select_body(struct http_parser *parser, const struct http_request *req){
+	const char *coding = http_request_header(req, HTTP_HEADER_TRANSFER_ENCODING);
+	if(!coding){
+		parser->phase = parser->content_len > 0 ? HTTP_PARSER_BODY : HTTP_PARSER_COMPLETE;
 		return 0;
 	}
+	if(http_request_header(req, HTTP_HEADER_CONTENT_LENGTH)) return -1;
+	if(req->version_id != HTTP_VERSION_1_1) return -1;
+
+	/* chunked must be the final coding. */
+	const char *last = strrchr(coding, ',');
+	last = last ? last + 1 : coding;
+	while(*last == ' ' || *last == '\t') last++;
+	size_t last_len = strlen(last);
+	while(last_len > 0 && (last[last_len-1] == ' ' || last[last_len-1] == '\t')) last_len--;
+	if(last_len != 7 || strncasecmp(last, "chunked", 7) != 0) return -1;
+
+	parser->chunked = true;
+	parser->content_len = 0;
+	parser->phase = HTTP_PARSER_CHUNK_SIZE;
+	return 0;
+}
+
+
+/**
+ * @brief Parse a chunk-size line ("1a;ext=v") into @p size.
+ *
+ * @return 0 on success, -1 if it does not start with a hex number or the number overflows.
+ */
+static int parse_chunk_size(const char *line, size_t line_len, size_t *size){
+	size_t value = 0;
+	size_t i = 0;
+	for(; i < line_len; i++){
+		char c = line[i];
+		int digit;
+		if(c >= '0' && c <= '9') digit = c - '0';
+		else if(c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+		else if(c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+		else break;
+		if(value > (SIZE_MAX - (size_t)digit) / 16) return -1;
+		value = value * 16 + (size_t)digit;
+	}
+	if(i == 0) return -1;
 
+	/* Only whitespace or a chunk extension may follow. */
+	while(i < line_len && (line[i] == ' ' || line[i] == '\t')) i++;
+	if(i < line_len && line[i] != ';') return -1;
 
-	int read_from_body = read_body(fd,(char**)buffer, new_buff_len, headers_end, content_len, body_max, total_read, req);
-	if(read_from_body <0){
-		fprintf(stderr, "error reading request body\n");
+	*size = value;
+	return 0;
+}
+
+
+/**
+ * @brief Length of the line starting at @p parser->consumed, without its CRLF.
+ *
+ * @return Line length, -1 if the line is not complete yet, -2 if it exceeds
+ *         @ref HTTP_MAX_CHUNK_LINE.
+ */
+static long chunk_line(const struct http_parser *parser, const char *buffer, size_t len){
+	size_t available = len - parser->consumed;
+	if(available > HTTP_MAX_CHUNK_LINE) available = HTTP_MAX_CHUNK_LINE;
+	int line_len = find_crlf(buffer + parser->consumed, available);
+	if(line_len >= 0) return line_len;
+	return available == HTTP_MAX_CHUNK_LINE ? -2 : -1;
+}
+
+
+/**
+ * @brief Advance over chunk framing up to the next piece of data.
+ *
+ * Data is moved down to the end of the decoded body before it is handed out.
+ */
+static enum http_parse_status parser_feed_chunked(struct http_parser *parser, char *buffer, size_t len){
+	while(1){
+		if(parser->phase == HTTP_PARSER_COMPLETE) return HTTP_PARSE_DONE;
+		if(len <= parser->consumed) return HTTP_PARSE_NEED_MORE;
+
+		switch(parser->phase){
+			case HTTP_PARSER_CHUNK_SIZE: {
+				long line_len = chunk_line(parser, buffer, len);
+				if(line_len == -1) return HTTP_PARSE_NEED_MORE;
+				if(line_len < 0 || parse_chunk_size(buffer + parser->consumed, (size_t)line_len, &parser->chunk_left) < 0){
+					return HTTP_PARSE_ERROR;
+				}
+				size_t max_body = parser->limits->max_body;
+				if(max_body > 0 && parser->chunk_left > max_body - parser->body_read){
+					return HTTP_PARSE_ERROR;
+				}
+				parser->consumed += (size_t)line_len + 2;
+				parser->phase = parser->chunk_left > 0 ? HTTP_PARSER_CHUNK_DATA : HTTP_PARSER_TRAILER;
+				break;
+			}
+
+			case HTTP_PARSER_CHUNK_DATA: {
+				size_t available = len - parser->consumed;
+				size_t take = available < parser->chunk_left ? available : parser->chunk_left;
+				char *dst = buffer + parser->head_len + parser->body_held;
+				if(dst != buffer + parser->consumed) memmove(dst, buffer + parser->consumed, take);
+
+				parser->chunk = dst;
+				parser->chunk_len = take;
+				parser->consumed += take;
+				parser->body_read += take;
+				parser->body_held += take;
+				parser->chunk_left -= take;
+				if(parser->chunk_left == 0) parser->phase = HTTP_PARSER_CHUNK_END;
+				return HTTP_PARSE_BODY_CHUNK;
+			}
+
+			case HTTP_PARSER_CHUNK_END:
+				if(len - parser->consumed < 2) return HTTP_PARSE_NEED_MORE;
+				if(buffer[parser->consumed] != '\r' || buffer[parser->consumed + 1] != '\n') return HTTP_PARSE_ERROR;
+				parser->consumed += 2;
+				parser->phase = HTTP_PARSER_CHUNK_SIZE;
+				break;
+
+			case HTTP_PARSER_TRAILER: {
+				long line_len = chunk_line(parser, buffer, len);
+				if(line_len == -1) return HTTP_PARSE_NEED_MORE;
+				if(line_len < 0) return HTTP_PARSE_ERROR;
+				parser->consumed += (size_t)line_len + 2;
+				if(line_len == 0) parser->phase = HTTP_PARSER_COMPLETE;
+				break;
+			}
+
+			default:
+				return HTTP_PARSE_ERROR;
+		}
+	}
+}
+
+
+void http_parser_compact(struct http_parser *parser, char *buffer, size_t *len){
+	if(!parser || !buffer || !len || !parser->chunked) return;
+
+	size_t decoded_end = parser->head_len + parser->body_held;
+	if(parser->consumed <= decoded_end || parser->consumed > *len) return;
+
+	size_t unprocessed = *len - parser->consumed;
+	if(unprocessed > 0) memmove(buffer + decoded_end, buffer + parser->consumed, unprocessed);
+	*len = decoded_end + unprocessed;
+	parser->consumed = decoded_end;
+}
+
+
+void http_parser_discard_body(struct http_parser *parser, char *buffer, size_t *len){
+	if(!parser || !buffer || !len || parser->head_len == 0 || parser->consumed > *len) return;
+
+	size_t unprocessed = *len - parser->consumed;
+	if(unprocessed > 0 && parser->consumed > parser->head_len){
+		memmove(buffer + parser->head_len, buffer + parser->consumed, unprocessed);
+	}
+	*len = parser->head_len + unprocessed;
+	parser->consumed = parser->head_len;
+	parser->body_held = 0;
+	parser->chunk = NULL;
+	parser->chunk_len = 0;
+}
+
+
+enum http_parse_status http_parser_feed(struct http_parser *parser, char *buffer, size_t len, struct http_request *req){
+	if(!parser || !buffer || !req) return HTTP_PARSE_ERROR;
+
+	switch(parser->phase){
+		case HTTP_PARSER_HEAD: {
+			int headers_end = http_head_scan(&parser->scan, buffer, len);
+			if(headers_end < 0) return HTTP_PARSE_NEED_MORE;
+
+			if(http_parse_request_head_inplace(buffer, (size_t)headers_end, &parser->scan, parser->limits,
+											   &parser->content_len, req) < 0){
+				return HTTP_PARSE_ERROR;
+			}
+			parser->head_len = (size_t)headers_end + 4;
+			parser->consumed = parser->head_len;
+			if(parser_select_body(parser, req) < 0){
+				return HTTP_PARSE_ERROR;
+			}
+			return HTTP_PARSE_HEADERS_DONE;
+		}
+
+		case HTTP_PARSER_BODY: {
+			if(len <= parser->consumed) return HTTP_PARSE_NEED_MORE;
+			size_t available = len - parser->consumed;
+			size_t left = parser->content_len - parser->body_read;
+
+			parser->chunk = buffer + parser->consumed;
+			parser->chunk_len = available < left ? available : left;
+			parser->consumed += parser->chunk_len;
+			parser->body_read += parser->chunk_len;
+			parser->body_held += parser->chunk_len;
+			if(parser->body_read == parser->content_len) parser->phase = HTTP_PARSER_COMPLETE;
+			return HTTP_PARSE_BODY_CHUNK;
+		}
+
+		case HTTP_PARSER_COMPLETE:
+			return HTTP_PARSE_DONE;
+
+		default:
+			return parser_feed_chunked(parser, buffer, len);
+	}
+}
+
+
+int http_parse_request(int fd, void **buffer, size_t buffer_len, struct http_request *req){
+
+	if(!req || !buffer || !(*buffer) || buffer_len <1){
 		return -1;
+	};
+
+	const struct http_limits *limits = http_limits_profile_get(HTTP_LIMITS_DEFAULT);
+	size_t headers_max = limits->max_head;
+	size_t body_max = limits->max_body_buffer;
+	size_t buffer_cap = buffer_len;
+	size_t total_read = 0;
+	bool eof = false;
+
+	if(DEBUG_OUT)
+		printf("\n############ Parse request ############\n");
+
+	struct http_parser parser;
+	http_parser_init(&parser, limits);
+
+	while(1){
+		enum http_parse_status status = http_parser_feed(&parser, *buffer, total_read, req);
+		if(status == HTTP_PARSE_ERROR){
+			return -1;
+		}
+		if(status == HTTP_PARSE_DONE) break;
+		if(status != HTTP_PARSE_NEED_MORE) continue;
+
+		/* A body beyond the limit is truncated, like one cut short by EOF. */
+		if(parser.phase != HTTP_PARSER_HEAD && (parser.body_read >= body_max || eof)) break;
+		if(eof){
+			return -1;
+		}
+
+		http_parser_compact(&parser, *buffer, &total_read);
+		size_t limit = headers_max;
+		if(parser.chunked) limit = parser.head_len + body_max + HTTP_MAX_CHUNK_LINE;
+		else if(parser.phase != HTTP_PARSER_HEAD) limit = parser.head_len + (parser.content_len < body_max ? parser.content_len : body_max);
+		if(total_read == buffer_cap){
+			if(buffer_cap >= limit){
+				return -1;
+			}
+			size_t new_cap = buffer_cap * 2 < limit ? buffer_cap * 2 : limit;
+			uintptr_t old_base = (uintptr_t)*buffer;
+			void *tmp = realloc(*buffer, new_cap);
+			if(!tmp) return -1;
+			http_request_rebase(req, old_base, tmp);
+			*buffer = tmp;
+			buffer_cap = new_cap;
+		}
+
+		size_t room = (limit < buffer_cap ? limit : buffer_cap) - total_read;
+		ssize_t currently_read = read_some(fd, (char*)*buffer + total_read, room);
+		if(currently_read < 0){
+			return -1;
+		}
+		if(currently_read == 0) eof = true;
+		total_read += (size_t)currently_read;
+	}
+
+	if(parser.content_len > 0 || parser.chunked){
+		size_t body_len = parser.body_read < body_max ? parser.body_read : body_max;
+		size_t declared = parser.chunked ? body_len : parser.content_len;
+		if(http_parse_request_body((const char*)*buffer + parser.head_len, body_len, declared, req) < 0){
+			return -1;
+		}
 	}
 
 	if(DEBUG_OUT){
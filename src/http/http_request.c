@@ -1,6 +1,7 @@
 #include "../../include/http/http_request.h"
 #include <stdio.h>
 #include <stdlib.h> 
+#include <string.h>
 #include <strings.h>
 
 void http_request_init(struct http_request *req) {
@@ -8,29 +9,91 @@ void http_request_init(struct http_request *req) {
 	req->method=NULL;
 	req->path=NULL;
 	req->version=NULL;
+	req->method_len = 0;
+	req->path_len = 0;
+	req->version_len = 0;
+	req->line_owned = false;
+	req->method_id = HTTP_METHOD_OTHER;
+	req->version_id = HTTP_VERSION_OTHER;
+	req->param_count = 0;
 	req->headers=NULL;
     req->num_headers = 0;
+    memset(req->header_index, 0, sizeof(req->header_index));
     req->content_length = 0;
     req->body = NULL;
+    req->body_owned = false;
+    req->body_reader = (struct http_body_reader){0};
 }
 
 void http_request_clear(struct http_request *req) {
     if (!req) return;
-	free(req->method);
-	free(req->path);
-	free(req->version);
+	if(req->line_owned){
+		free(req->method);
+		free(req->path);
+		free(req->version);
+	}
 	if(req->headers){
 		for(size_t i=0;i<req->num_headers;i++){
 			if (req->headers[i].name && req->headers[i].name_owned == true) free((void*)req->headers[i].name);
 			if (req->headers[i].value && req->headers[i].value_owned == true) free((void*)req->headers[i].value);
 		}
-		free(req->headers);
+		if(req->headers != req->header_slots) free(req->headers);
     }
-	if(req->body)free(req->body);
+	if(req->body && req->body_owned)free(req->body);
 	http_request_init(req);
 }
 
+/**
+ * @brief Address of the same offset as @p view in the moved buffer (NULL stays NULL).
+ */
+static char *rebased(const char *view, uintptr_t old_base, char *new_base){
+	return view ? new_base + ((uintptr_t)view - old_base) : NULL;
+}
+
+
+void http_request_rebase(struct http_request *req, uintptr_t old_base, char *new_base){
+	if(!req || !new_base || (uintptr_t)new_base == old_base) return;
+
+	if(!req->line_owned){
+		req->method = rebased(req->method, old_base, new_base);
+		req->path = rebased(req->path, old_base, new_base);
+		req->version = rebased(req->version, old_base, new_base);
+		for(size_t i=0; i<req->param_count; i++){
+			req->params[i].name = rebased(req->params[i].name, old_base, new_base);
+			req->params[i].value = rebased(req->params[i].value, old_base, new_base);
+		}
+	}
+	for(size_t i=0; req->headers && i<req->num_headers; i++){
+		if(!req->headers[i].name_owned) req->headers[i].name = rebased(req->headers[i].name, old_base, new_base);
+		if(!req->headers[i].value_owned) req->headers[i].value = rebased(req->headers[i].value, old_base, new_base);
+	}
+	if(!req->body_owned) req->body = rebased(req->body, old_base, new_base);
+}
+
+
+void http_request_index_headers(struct http_request *req){
+	if(!req) return;
+	memset(req->header_index, 0, sizeof(req->header_index));
+	for(size_t i=0; req->headers && i<req->num_headers && i<UINT8_MAX; i++){
+		const struct http_header *header = &req->headers[i];
+		size_t name_len = header->name_len ? header->name_len : strlen(header->name);
+		enum http_header_id id = http_header_id_of(header->name, name_len);
+		if(id != HTTP_HEADER_OTHER && req->header_index[id] == 0) req->header_index[id] = (uint8_t)(i + 1);
+	}
+}
+
+
+const char *http_request_header(const struct http_request *req, enum http_header_id id){
+	if(!req || id <= HTTP_HEADER_OTHER || id >= HTTP_HEADER_COUNT) return NULL;
+	uint8_t slot = req->header_index[id];
+	return slot ? req->headers[slot - 1].value : NULL;
+}
+
+
 const char* http_request_get_header_value(const struct http_request *req, const char *header_name){
+	enum http_header_id id = http_header_id_of(header_name, strlen(header_name));
+	if(id != HTTP_HEADER_OTHER) return http_request_header(req, id);
+
 	for(size_t i=0; i<req->num_headers; i++){
 		if(strcasecmp(req->headers[i].name, header_name) == 0){
 			return req->headers[i].value;
@@ -38,3 +101,36 @@ const char* http_request_get_header_value(const struct http_request *req, const
 	}
 	return NULL;
 }
+
+
+/**
+ * @brief Check whether a comma-separated header value contains @p token (case-insensitive).
+ */
+static bool header_has_token(const char *value, const char *token){
+	size_t token_len = strlen(token);
+	const char *p = value;
+	while(*p){
+		while(*p == ' ' || *p == '\t' || *p == ',') p++;
+		const char *start = p;
+		while(*p && *p != ',') p++;
+		const char *end = p;
+		while(end > start && (end[-1] == ' ' || end[-1] == '\t')) end--;
+		if((size_t)(end - start) == token_len && strncasecmp(start, token, token_len) == 0) return true;
+	}
+	return false;
+}
+
+
+bool http_request_keep_alive(const struct http_request *req){
+	if(!req) return false;
+
+	const char *connection = http_request_header(req, HTTP_HEADER_CONNECTION);
+	switch(req->version_id){
+		case HTTP_VERSION_1_1:
+			return !(connection && header_has_token(connection, "close"));
+		case HTTP_VERSION_1_0:
+			return connection && header_has_token(connection, "keep-alive");
+		default:
+			return false;
+	}
+}
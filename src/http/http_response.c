@@ -1,39 +1,44 @@
 #include <stddef.h>
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
 #include "../../include/http/http_response.h"
+#include "../../include/http/http_date.h"
 
 /**
- * @brief Write the entire buffer to a file descriptor, handling partial writes.
+ * @brief Write all segments of an iovec list to a file descriptor, handling partial writes.
  *
- * This function repeatedly calls @c write(2) until either all requested
- * bytes from @p buffer have been written to the file descriptor @p fd,
- * or an unrecoverable error occurs.
+ * Hands every remaining segment to one @c writev(2) per round. After a
+ * partial write the fully written segments are skipped and the first
+ * remaining one is advanced in place, so @p iov is modified.
  *
- * - If @c write is interrupted by a signal (@c EINTR), the call is retried.
+ * - If @c writev is interrupted by a signal (@c EINTR), the call is retried.
  * - On any other error, the function stops and returns -1.
  *
  * @param fd
  *        File descriptor to write to (e.g. a socket or pipe).
- * @param buffer
- *        Pointer to the data buffer to write.
- * @param buffer_len
- *        Number of bytes to write from @p buffer.
+ * @param iov
+ *        Segments to write, in order (entries may have length 0).
+ * @param iov_count
+ *        Number of entries in @p iov (at most IOV_MAX).
  *
  * @return
  *        Total number of bytes written on success,
  *        or -1 on error (errno is preserved).
  */
-static ssize_t write_all(int fd, const void *buffer, size_t buffer_len){
-    size_t total_written = 0;
-	ssize_t currently_written = 0;
-	while(total_written<buffer_len){
-		
-		currently_written = write(fd, (const char*)buffer + total_written, 
-							buffer_len - total_written);
+static ssize_t writev_all(int fd, struct iovec *iov, int iov_count){
+	size_t total_written = 0;
+	while(iov_count > 0){
+		if(iov->iov_len == 0){
+			iov++;
+			iov_count--;
+			continue;
+		}
+
+		ssize_t currently_written = writev(fd, iov, iov_count);
 		if(currently_written < 0){
 			if(errno == EINTR) continue;
 			return -1;
@@ -41,48 +46,138 @@ static ssize_t write_all(int fd, const void *buffer, size_t buffer_len){
 		if(currently_written == 0){
 			return -1;
 		}
-		total_written += currently_written;
+		total_written += (size_t)currently_written;
+
+		size_t left = (size_t)currently_written;
+		while(iov_count > 0 && left >= iov->iov_len){
+			left -= iov->iov_len;
+			iov++;
+			iov_count--;
+		}
+		if(left > 0){
+			iov->iov_base = (char*)iov->iov_base + left;
+			iov->iov_len -= left;
+		}
 	}
-	return total_written;
+	return (ssize_t)total_written;
 }
 
 
 /**
- * @brief Translate an HTTP status code to its reason phrase.
- *
- * Provides the textual reason phrase associated with an HTTP status code,
- * as used in the status line of an HTTP response.
- *
- * Currently only a small subset of common status codes are supported.
- * Unknown codes return the generic phrase @c "Not Implemented".
- *
- * @param status
- *        A status code represented by a value of the http_status enum 
- *        (e.g. HTTP_OK, HTTP_NOT_FOUND).
+ * @def HTTP_STATUS_TABLE_SIZE
+ * @brief Status codes covered by @ref status_lines (0 .. size-1).
+ */
+#define HTTP_STATUS_TABLE_SIZE 600
+
+/**
+ * @def HTTP_STREAM_SIZE_LINE
+ * @brief Room for a chunk size line (hex digits and CRLF) in front of each piece.
+ */
+#define HTTP_STREAM_SIZE_LINE 10
+
+/**
+ * @def STATUS_LINE
+ * @brief Table entry: complete status line of @p code with @p reason, and its length.
+ */
+#define STATUS_LINE(code, reason) \
+	[code] = { "HTTP/1.1 " #code " " reason "\r\n", sizeof("HTTP/1.1 " #code " " reason "\r\n") - 1 }
+
+
+/**
+ * @struct status_line
+ * @brief Preformatted status line.
+ */
+struct status_line {
+	const char *text;	/**< "HTTP/1.1 <code> <reason>\r\n" (NULL for codes without an entry). */
+	size_t      len;	/**< Length of @ref text. */
+};
+
+
+/**
+ * @brief Status lines, indexed by status code.
  *
- * @return
- *        A constant string with the reason phrase (e.g. "OK", "Not Found").
- *        The returned string is statically allocated and must not be freed.
+ * Codes without an entry are written with an empty reason phrase
+ * ("HTTP/1.1 <code> \r\n"), which RFC 9112 allows; a made-up phrase
+ * would misdescribe them.
  */
-static const char* get_reason_phrase(enum http_status status){
-	switch (status) {
-		case HTTP_OK: return "OK";
-		case HTTP_CREATED: return "Created";
-		case HTTP_NO_CONTENT: return "No Content";
-		case HTTP_REDIR_PERM: return "Moved Permanently";
-		case HTTP_REDIR_TEMP: return "Found";
-		case HTTP_REDIR_TEMP_PRE: return "Temporary Redirect";
-		case HTTP_REDIR_PERM_PRE: return "Permanent Redirect";
-		case HTTP_BAD_REQUEST: return "Bad Request";
-		case HTTP_FORBIDDEN: return "Forbidden";
-		case HTTP_NOT_FOUND: return "Not Found";
-		case HTTP_UNSUPPORTED: return "Unsupported Media Type";
-		case HTTP_SERVER_ERROR: return "Internal Server Error";
-		case HTTP_NOT_IMPLEMENTED: return "Not Implemented";
-		default: return "Not Implemented";
+static const struct status_line status_lines[HTTP_STATUS_TABLE_SIZE] = {
+	STATUS_LINE(200, "OK"),
+	STATUS_LINE(201, "Created"),
+	STATUS_LINE(204, "No Content"),
+	STATUS_LINE(301, "Moved Permanently"),
+	STATUS_LINE(302, "Found"),
+	STATUS_LINE(307, "Temporary Redirect"),
+	STATUS_LINE(308, "Permanent Redirect"),
+	STATUS_LINE(400, "Bad Request"),
+	STATUS_LINE(403, "Forbidden"),
+	STATUS_LINE(404, "Not Found"),
+	STATUS_LINE(405, "Method Not Allowed"),
+	STATUS_LINE(413, "Content Too Large"),
+	STATUS_LINE(415, "Unsupported Media Type"),
+	STATUS_LINE(431, "Request Header Fields Too Large"),
+	STATUS_LINE(500, "Internal Server Error"),
+	STATUS_LINE(501, "Not Implemented"),
+	STATUS_LINE(503, "Service Unavailable")
+};
+
+
+/**
+ * @struct head_writer
+ * @brief Bounded append cursor over the head buffer.
+ */
+struct head_writer {
+	char   *buffer;		/**< Destination. */
+	size_t  cap;		/**< Capacity of @ref buffer. */
+	size_t  len;		/**< Bytes written so far. */
+	bool    overflow;	/**< Set once an append did not fit (the head is then unusable). */
+};
+
+
+/**
+ * @brief Append @p len bytes (dropped, and @ref head_writer::overflow set, if they do not fit).
+ */
+static inline void head_put(struct head_writer *w, const char *data, size_t len){
+	if(len > w->cap - w->len){
+		w->overflow = true;
+		return;
 	}
+	memcpy(w->buffer + w->len, data, len);
+	w->len += len;
+}
+
+
+/**
+ * @brief Append a string literal.
+ */
+#define HEAD_PUT_LITERAL(w, literal) head_put((w), (literal), sizeof(literal) - 1)
+
+
+/**
+ * @brief Append @p value in decimal.
+ */
+static inline void head_put_size(struct head_writer *w, size_t value){
+	char digits[20];
+	size_t n = sizeof(digits);
+	do{
+		digits[--n] = (char)('0' + value % 10);
+		value /= 10;
+	}while(value > 0);
+	head_put(w, digits + n, sizeof(digits) - n);
+}
+
+
+/**
+ * @brief Append "<name>: <value>\r\n" (a length of 0 means "use strlen").
+ */
+static inline void head_put_field(struct head_writer *w, const char *name, size_t name_len,
+								  const char *value, size_t value_len){
+	head_put(w, name, name_len ? name_len : strlen(name));
+	HEAD_PUT_LITERAL(w, ": ");
+	head_put(w, value, value_len ? value_len : strlen(value));
+	HEAD_PUT_LITERAL(w, "\r\n");
 }
 
+
 void http_response_clear(struct http_response *res){
 	if (res->extra_headers) {
     	for (size_t i = 0; i < res->extra_headers_count; i++) {
@@ -100,6 +195,14 @@ void http_response_clear(struct http_response *res){
     	if(res->extra_headers_owned) free(res->extra_headers);
 	}
 	if(res->body && res->body_owned) free((void*)res->body);
+	if(res->file.enabled && res->file.release) res->file.release(res->file.ctx);
+	free(res->file.buffer);
+	res->file = (struct http_file_body){0};
+	if(res->stream.enabled && res->stream.release) res->stream.release(res->stream.ctx);
+	free(res->stream.buffer);
+	res->stream = (struct http_stream_body){0};
+	if(res->sink.enabled && res->sink.release) res->sink.release(res->sink.ctx);
+	res->sink = (struct http_body_sink){0};
 	res->status=HTTP_OK;
 	res->content_length=0;
 	res->content_type=NULL;
@@ -108,71 +211,186 @@ void http_response_clear(struct http_response *res){
 	res->extra_headers_owned = false;
 	res->body = NULL;
 	res->body_owned = false;
+	res->keep_alive = false;
 }
 
-int http_send_response(int fd, const struct http_response *res){  
+ssize_t http_response_serialize_head(const struct http_response *res, char *headers, size_t headers_cap){  
 
-	if (!res) { errno = EINVAL; return -1; }
-	
-	char headers[2048];
+	if (!res || !headers) { errno = EINVAL; return -1; }
 
-	char end_of_headers[] = "Connection: close\r\n\r\n"; 
+	struct head_writer w = { .buffer = headers, .cap = headers_cap };
 
-	size_t headers_limit = sizeof(headers)-(sizeof(end_of_headers) - 1);
-    
-	size_t h_written = 0;
-	
-	int currently_written = 0;
-	currently_written = snprintf(headers+h_written, headers_limit - h_written,
-        "HTTP/1.1 %d %s\r\n"
-        "Content-Length: %zu\r\n"
-		"X-Content-Type-Options: nosniff\r\n",
-        res->status, get_reason_phrase(res->status), res->content_length);
-
-	if (currently_written < 0 || (size_t)currently_written >= headers_limit - h_written) return -1;
-	h_written += (size_t)currently_written;
-	currently_written = 0;
-
-	if(res->content_type){
-	currently_written = snprintf(headers+h_written, headers_limit - h_written,
-        "Content-Type: %s\r\n", res->content_type);
+	unsigned code = (unsigned)res->status;
+	if(code < HTTP_STATUS_TABLE_SIZE && status_lines[code].text){
+		head_put(&w, status_lines[code].text, status_lines[code].len);
+	}else{
+		HEAD_PUT_LITERAL(&w, "HTTP/1.1 ");
+		head_put_size(&w, code);
+		HEAD_PUT_LITERAL(&w, " \r\n");
 	}
 
-	if (currently_written < 0 || (size_t)currently_written >= headers_limit - h_written) return -1;
-	h_written += (size_t)currently_written;
+	char date[HTTP_DATE_LEN];
+	http_date_now(date);
+	HEAD_PUT_LITERAL(&w, "Date: ");
+	head_put(&w, date, sizeof(date));
+
+	if(!res->stream.enabled){
+		HEAD_PUT_LITERAL(&w, "\r\nContent-Length: ");
+		head_put_size(&w, res->content_length);
+	}else if(res->stream.chunked){
+		HEAD_PUT_LITERAL(&w, "\r\nTransfer-Encoding: chunked");
+	}
+	HEAD_PUT_LITERAL(&w, "\r\nX-Content-Type-Options: nosniff\r\n");
+
+	if(res->content_type) head_put_field(&w, "Content-Type", sizeof("Content-Type") - 1, res->content_type, 0);
 
 	for(size_t i=0; i<res->extra_headers_count; i++){
-		int to_write = snprintf(NULL, 0, "%s: %s\r\n",
-			res->extra_headers[i].name, res->extra_headers[i].value);
-        if (to_write < 0) return -1;
-
-        if (h_written + (size_t)to_write + strlen(end_of_headers) > sizeof(headers)){
-            return -1;
-        }
-		int currently_written = snprintf(headers+h_written, headers_limit - h_written, "%s: %s\r\n",
-		res->extra_headers[i].name, res->extra_headers[i].value);
-
-		if(currently_written < 0 || (size_t)currently_written >= headers_limit - h_written) return -1;
-		h_written += (size_t)currently_written;
+		const struct http_header *header = &res->extra_headers[i];
+		head_put_field(&w, header->name, header->name_len, header->value, header->value_len);
 	}
 
-	currently_written = 0;
-	currently_written = snprintf(headers + h_written, sizeof(headers) - h_written, "%s", end_of_headers);
-    if (currently_written < 0) return -1;
-	h_written+=currently_written;
+	if(res->keep_alive) HEAD_PUT_LITERAL(&w, "Connection: keep-alive\r\n\r\n");
+	else HEAD_PUT_LITERAL(&w, "Connection: close\r\n\r\n");
+
+	if(w.overflow) return -1;
+	return (ssize_t)w.len;
+}
+
 
-	int headers_written_count = write_all(fd, headers, h_written);
-	if (headers_written_count < 0) return -1;
+int http_send_response(int fd, const struct http_response *res){  
+
+	if (!res || res->stream.enabled) { errno = EINVAL; return -1; }
+	
+	char headers[HTTP_RESPONSE_HEAD_MAX];
 
+	ssize_t h_written = http_response_serialize_head(res, headers, sizeof(headers));
+	if (h_written < 0) return -1;
+
+	/* Head and body leave with one writev(2): one syscall and, for small
+	 * responses, one segment on the wire. */
+	struct iovec iov[2] = {
+		{ .iov_base = headers, .iov_len = (size_t)h_written },
+		{ .iov_base = NULL,    .iov_len = 0 }
+	};
 	if(res->body && res->content_length > 0){
-		int body_written_count = write_all(fd, res->body, res->content_length);
-		if (body_written_count < 0) return -1;
+		iov[1].iov_base = (void*)res->body;
+		iov[1].iov_len = res->content_length;
 	}
 
+	if (writev_all(fd, iov, 2) < 0) return -1;
+
+	size_t sent = 0;
+	while(res->file.enabled && sent < res->content_length){
+		ssize_t n = http_response_send_file(fd, res, sent);
+		if(n < 0){
+			if(errno == EINTR) continue;
+			return -1;
+		}
+		sent += (size_t)n;
+	}
 	return 0;
 }
 
 
+ssize_t http_response_send_file(int fd, const struct http_response *res, size_t sent){
+
+	if (!res || !res->file.enabled || sent >= res->content_length) { errno = EINVAL; return -1; }
+
+	off_t offset = res->file.offset + (off_t)sent;
+	size_t len = res->content_length - sent;
+	if(len > HTTP_SENDFILE_MAX) len = HTTP_SENDFILE_MAX;
+
+	ssize_t n = sendfile(fd, res->file.fd, &offset, len);
+	if(n == 0){
+		/* The file shrank below the announced Content-Length. */
+		errno = EIO;
+		return -1;
+	}
+	return n;
+}
+
+
+ssize_t http_response_file_next(struct http_response *res, size_t sent){
+
+	if (!res || !res->file.enabled || sent >= res->content_length) { errno = EINVAL; return -1; }
+
+	struct http_file_body *file = &res->file;
+	if(!file->buffer){
+		file->buffer = malloc(HTTP_FILE_PIECE);
+		if(!file->buffer) return -1;
+	}
+
+	size_t len = res->content_length - sent;
+	if(len > HTTP_FILE_PIECE) len = HTTP_FILE_PIECE;
+
+	size_t loaded = 0;
+	while(loaded < len){
+		ssize_t n = pread(file->fd, file->buffer + loaded, len - loaded, file->offset + (off_t)(sent + loaded));
+		if(n < 0 && errno == EINTR) continue;
+		if(n < 0) return -1;
+		if(n == 0){
+			/* The file shrank below the announced Content-Length. */
+			errno = EIO;
+			return -1;
+		}
+		loaded += (size_t)n;
+	}
+
+	file->piece_start = sent;
+	file->piece_len = loaded;
+	return (ssize_t)loaded;
+}
+
+
+ssize_t http_response_stream_next(struct http_response *res){
+
+	if (!res || !res->stream.enabled || !res->stream.produce || res->stream.finished) { errno = EINVAL; return -1; }
+
+	struct http_stream_body *stream = &res->stream;
+	if(!stream->buffer){
+		stream->buffer = malloc(HTTP_STREAM_SIZE_LINE + HTTP_STREAM_CHUNK + 2);
+		if(!stream->buffer) return -1;
+	}
+
+	char *data = stream->buffer + HTTP_STREAM_SIZE_LINE;
+	ssize_t n = stream->produce(stream->ctx, data, HTTP_STREAM_CHUNK);
+	if(n < 0 || n > HTTP_STREAM_CHUNK) return -1;
+
+	if(n == 0){
+		stream->finished = true;
+		stream->piece = stream->buffer;
+		stream->piece_len = 0;
+		if(stream->chunked){
+			memcpy(stream->piece, "0\r\n\r\n", 5);
+			stream->piece_len = 5;
+		}
+		return (ssize_t)stream->piece_len;
+	}
+
+	if(!stream->chunked){
+		stream->piece = data;
+		stream->piece_len = (size_t)n;
+		return n;
+	}
+
+	/* The size line is written backwards so that it ends right where the data starts. */
+	static const char hex[] = "0123456789abcdef";
+	char *line = data;
+	*--line = '\n';
+	*--line = '\r';
+	size_t size = (size_t)n;
+	do{
+		*--line = hex[size & 0xf];
+		size >>= 4;
+	}while(size > 0);
+	memcpy(data + n, "\r\n", 2);
+
+	stream->piece = line;
+	stream->piece_len = (size_t)(data + n + 2 - line);
+	return (ssize_t)stream->piece_len;
+}
+
+
 int http_send_text(int fd, enum http_status status, const char *text){
     if (!text) { errno = EINVAL; return -1; }
 
@@ -0,0 +1,151 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "../../include/http/http_scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HTTP_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+
+/**
+ * @brief Portable implementation (libc's memchr is vectorized where the platform allows).
+ */
+static size_t scan_cr_scalar(const char *buffer, size_t len){
+	const char *cr = memchr(buffer, '\r', len);
+	return cr ? (size_t)(cr - buffer) : len;
+}
+
+
+#ifdef HTTP_SCAN_X86
+
+/**
+ * @brief Compare 16 bytes per step; the tail is left to the scalar loop.
+ */
+__attribute__((target("sse2")))
+static size_t scan_cr_sse2(const char *buffer, size_t len){
+	const __m128i cr = _mm_set1_epi8('\r');
+	size_t i = 0;
+	for(; i + 16 <= len; i += 16){
+		__m128i block = _mm_loadu_si128((const __m128i *)(buffer + i));
+		unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, cr));
+		if(mask) return i + (size_t)__builtin_ctz(mask);
+	}
+	for(; i < len; i++){
+		if(buffer[i] == '\r') return i;
+	}
+	return len;
+}
+
+
+/**
+ * @brief Compare 32 bytes per step; the tail is left to the SSE2 loop.
+ */
+__attribute__((target("avx2")))
+static size_t scan_cr_avx2(const char *buffer, size_t len){
+	const __m256i cr = _mm256_set1_epi8('\r');
+	size_t i = 0;
+	for(; i + 32 <= len; i += 32){
+		__m256i block = _mm256_loadu_si256((const __m256i *)(buffer + i));
+		unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, cr));
+		if(mask) return i + (size_t)__builtin_ctz(mask);
+	}
+	return i + scan_cr_sse2(buffer + i, len - i);
+}
+
+#endif /* HTTP_SCAN_X86 */
+
+
+/**
+ * @struct scan_impl
+ * @brief One implementation of @ref http_scan_cr.
+ */
+struct scan_impl {
+	size_t 	   (*scan_cr)(const char *buffer, size_t len); /**< Search function. */
+	const char  *name;										/**< Reported by @ref http_scan_impl. */
+};
+
+/** @brief Implementation in use; NULL until the first call picks one. */
+static const struct scan_impl *active_impl;
+
+
+/**
+ * @brief Pick the best implementation the CPU supports.
+ *
+ * Racing threads pick the same one, so publishing it needs no lock.
+ */
+static const struct scan_impl *resolve_impl(void){
+	static const struct scan_impl scalar = { scan_cr_scalar, "scalar" };
+	const struct scan_impl *impl = &scalar;
+
+#ifdef HTTP_SCAN_X86
+	static const struct scan_impl sse2 = { scan_cr_sse2, "sse2" };
+	static const struct scan_impl avx2 = { scan_cr_avx2, "avx2" };
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")) impl = &avx2;
+	else if(__builtin_cpu_supports("sse2")) impl = &sse2;
+#endif
+
+	__atomic_store_n(&active_impl, impl, __ATOMIC_RELEASE);
+	return impl;
+}
+
+
+/**
+ * @brief Implementation in use, resolved on first use.
+ */
+static inline const struct scan_impl *scan_impl(void){
+	const struct scan_impl *impl = __atomic_load_n(&active_impl, __ATOMIC_ACQUIRE);
+	return impl ? impl : resolve_impl();
+}
+
+
+size_t http_scan_cr(const char *buffer, size_t len){
+	if(!buffer || len == 0) return len;
+	return scan_impl()->scan_cr(buffer, len);
+}
+
+
+const char *http_scan_impl(void){
+	return scan_impl()->name;
+}
+
+
+void http_head_scan_reset(struct http_head_scan *scan){
+	scan->offset = 0;
+	scan->line_start = 0;
+	scan->line_count = 0;
+}
+
+
+int http_head_scan(struct http_head_scan *scan, const char *buffer, size_t len){
+	if(!scan || !buffer) return -1;
+
+	size_t (*scan_cr)(const char *, size_t) = scan_impl()->scan_cr;
+	size_t pos = scan->offset;
+
+	while(pos < len){
+		size_t cr = pos + scan_cr(buffer + pos, len - pos);
+		if(cr + 1 >= len){
+			/* A trailing CR is looked at again once its successor arrived. */
+			scan->offset = cr;
+			return -1;
+		}
+		pos = cr + 1;
+		if(buffer[pos] != '\n') continue;
+		pos++;
+
+		/* An empty line after at least one line ends the head. */
+		if(cr == scan->line_start && scan->line_count > 0){
+			scan->offset = pos;
+			return (int)cr - 2;
+		}
+		if(scan->line_count < HTTP_SCAN_MAX_LINES) scan->line_ends[scan->line_count] = (uint32_t)cr;
+		scan->line_count++;
+		scan->line_start = pos;
+	}
+
+	scan->offset = pos;
+	return -1;
+}
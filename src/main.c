@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -7,9 +8,12 @@
 #include <stdint.h>
 #include <errno.h>
 #include <libgen.h>
+#include <signal.h>
 #include "../include/server.h"
+#include "../include/access_log.h"
 #include "../include/app.h"
 #include "../include/core/http_core.h"
+#include "../include/core/http_conn.h"
 #include "../include/adapters/adapter_http_app.h"
 #include "../include/filesystem/filesystem.h"
 #include "../ports/posix/fs_posix.h"
@@ -34,28 +38,139 @@ static int parse_port(const char *input, uint16_t *output) {
 }
 
 
+static int parse_workers(const char *input, unsigned *output) {
+    if (!input) return -1;
+
+    errno = 0;
+    char *end;
+    unsigned long workers = strtoul(input, &end, 10);
+
+    if (end == input
+        || *end != '\0'
+        || errno == ERANGE
+        || workers == 0
+        || workers > 1024
+	) return -1;
+
+    *output = (unsigned)workers;
+
+    return 0;
+}
+
+
+static int parse_backend(const char *input, bool *use_uring) {
+    if (!input) return -1;
+
+    if (strcmp(input, "epoll") == 0) *use_uring = false;
+    else if (strcmp(input, "io_uring") == 0) *use_uring = true;
+    else return -1;
+
+    return 0;
+}
+
+
+static int parse_limits(const char *input, struct http_limits *output) {
+    if (!input) return -1;
+
+    enum http_limits_profile profile;
+    if (http_limits_profile_from_name(input, &profile) < 0) return -1;
+    *output = *http_limits_profile_get(profile);
+
+    return 0;
+}
+
+
+static int parse_output(const char *input, enum http_output_policy *output) {
+    if (!input) return -1;
+
+    if (strcmp(input, "more") == 0) *output = HTTP_OUTPUT_MORE;
+    else if (strcmp(input, "immediate") == 0) *output = HTTP_OUTPUT_IMMEDIATE;
+    else if (strcmp(input, "cork") == 0) *output = HTTP_OUTPUT_CORK;
+    else return -1;
+
+    return 0;
+}
+
+
+static void on_stop_signal(int sig) {
+    (void)sig;
+    server_stop();
+}
+
+
+static void on_upgrade_signal(int sig) {
+    (void)sig;
+    server_upgrade();
+}
+
+
 int main(int argc, char** argv){
 
 	uint16_t port = 3001;
 	char *prog = basename(argv[0]);
-    char usage_str[128];
-	snprintf(usage_str, sizeof usage_str, "Usage: %s <PORT>\n", prog);
+    char usage_str[160];
+	snprintf(usage_str, sizeof usage_str, "Usage: %s <PORT> [WORKERS] [epoll|io_uring] [default|tiny|large-upload] [more|immediate|cork]\n", prog);
+
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned workers = cpus > 0 ? (unsigned)cpus : 1;
+	bool use_uring = false;
+	struct http_limits http_limits = *http_limits_profile_get(HTTP_LIMITS_DEFAULT);
+	enum http_output_policy output_policy = HTTP_OUTPUT_MORE;
 
-	if(argc > 2){
+	if(argc > 6){
 		fputs(usage_str, stderr);
 		exit(-1);
 	}
-	else if(argc == 2){
+	if(argc >= 2){
 		if(parse_port(argv[1], &port)<0){
 			fputs(usage_str, stderr);
 	    	exit(1);
 		}
 	}
+	if(argc >= 3){
+		if(parse_workers(argv[2], &workers)<0){
+			fputs(usage_str, stderr);
+	    	exit(1);
+		}
+	}
+	if(argc >= 4){
+		if(parse_backend(argv[3], &use_uring)<0){
+			fputs(usage_str, stderr);
+	    	exit(1);
+		}
+	}
+	if(argc >= 5){
+		if(parse_limits(argv[4], &http_limits)<0){
+			fputs(usage_str, stderr);
+	    	exit(1);
+		}
+	}
+	if(argc == 6){
+		if(parse_output(argv[5], &output_policy)<0){
+			fputs(usage_str, stderr);
+	    	exit(1);
+		}
+	}
+	http_limits_normalize(&http_limits);
 
 	struct server_config server_cfg = {
         .host = "127.0.0.1",
         .port = port,
-        .backlog = 128
+        .backlog = SOMAXCONN,
+		.workers = workers,
+		.idle_timeout_ms = HTTP_KEEPALIVE_IDLE_TIMEOUT_MS,
+		.upgrade_argv = argv,
+		.listener = {
+			.defer_accept_s = 5,
+			.fastopen_qlen  = 256,
+			.nodelay        = true
+		},
+		.limits = {
+			.max_conns           = 10000,
+			.max_requests        = 4096,
+			.reject_response     = HTTP_OVERLOAD_RESPONSE,
+			.reject_response_len = sizeof(HTTP_OVERLOAD_RESPONSE) - 1
+		}
     };
 
 
@@ -65,7 +180,9 @@ int main(int argc, char** argv){
 
 	struct http_core_ctx http_core_context = {
 		.adapter_handler = adapter_http_app,
-		.adapter_context = &adapter_context
+		.adapter_context = &adapter_context,
+		.limits          = &http_limits,
+		.output_policy   = output_policy
 	};
 
 
@@ -96,5 +213,39 @@ int main(int argc, char** argv){
 	};
 	if(app_init(mounts, 2) <0) exit(-1);
 
-    return server_start(&server_cfg, http_handle_connection, &http_core_context);
+	const struct server_conn_handler conn_handler = {
+		.open     	    = http_conn_open,
+		.on_ready 	    = http_conn_on_ready,
+		.close    	    = http_conn_close,
+		.on_data  	    = http_conn_on_data,
+		.pending_output = http_conn_pending_output,
+		.output_sent    = http_conn_output_sent,
+		.drain          = http_conn_drain,
+		.deadline       = http_conn_deadline,
+		.in_flight      = http_conn_in_flight
+	};
+
+	/* SIGTERM/SIGINT: finish in-flight requests and exit. SIGUSR2: hand over to a new binary. */
+	signal(SIGTERM, on_stop_signal);
+	signal(SIGINT, on_stop_signal);
+	signal(SIGUSR2, on_upgrade_signal);
+
+	/* The access log writes to the same fd; keep status lines in order with it. */
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	/* Requests and refused connections; set DEBUG to see every accepted connection. */
+	const struct access_log_config log_cfg = {
+		.fd                = STDOUT_FILENO,
+		.level             = ACCESS_LOG_INFO,
+		.sample_every      = 1,
+		.flush_interval_ms = 100
+	};
+	if(access_log_start(&log_cfg) < 0) fprintf(stderr, "access log disabled\n");
+
+	int ret;
+	if(use_uring) ret = server_start_uring(&server_cfg, &conn_handler, &http_core_context);
+	else ret = server_start_event_loop(&server_cfg, &conn_handler, &http_core_context);
+
+	access_log_stop();
+	return ret;
 }
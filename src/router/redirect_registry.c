@@ -113,14 +113,13 @@ int redirect_add(struct redirect_registry *registry, const char *from_path, cons
 }
 
 
-int redirect_lookup(struct redirect_registry *registry, const char *path, struct redirect_result *result){
+int redirect_lookup(struct redirect_registry *registry, const char *path, size_t path_len,
+					struct redirect_result *result){
 	if(!registry || !path || !result) return -1;
-	
-	size_t path_len = strlen(path);
 
 	for(size_t i=0; i<registry->rule_count; i++){
 		const struct redirect_rule *rule = &registry->rules[i];
-		if(strcmp(path, rule->from)==0 && rule->match_type == EXACT){
+		if(rule->match_type == EXACT && rule->from_len == path_len && memcmp(path, rule->from, path_len)==0){
 			result->type = rule->redirect_type;
 			result->target = rule->to;
 			result->target_owned = false;
@@ -1,3 +1,4 @@
+#include <errno.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -5,13 +6,154 @@
 #include "../../include/router/route_handlers.h"
 #include "../../include/app.h"
 
-int handle_route_echo(const struct app_request *req, struct app_response *res){
+/**
+ * @struct echo_state
+ * @brief Payload collected by the echo route, possibly across several arrivals.
+ */
+struct echo_state {
+	char 		  *buffer;		/**< Collected bytes (heap, NULL until the first). */
+	size_t 		   len;			/**< Valid bytes in @ref buffer. */
+	size_t 		   cap;			/**< Allocated size of @ref buffer. */
+	enum app_media media_type;	/**< Media type of the request payload. */
+};
+
+
+/**
+ * @brief Make room for more payload in @p state, up to @ref ECHO_MAX_PAYLOAD.
+ *
+ * @return 0 on success (or if the limit is reached), -1 on allocation failure.
+ */
+static int echo_reserve(struct echo_state *state){
+	if(state->len < state->cap || state->cap >= ECHO_MAX_PAYLOAD) return 0;
+	size_t new_cap = state->cap ? state->cap * 2 : 4096;
+	if(new_cap > ECHO_MAX_PAYLOAD) new_cap = ECHO_MAX_PAYLOAD;
+	char *tmp = realloc(state->buffer, new_cap);
+	if(!tmp) return -1;
+	state->buffer = tmp;
+	state->cap = new_cap;
+	return 0;
+}
+
+
+/**
+ * @brief Collect up to @ref ECHO_MAX_PAYLOAD bytes of the request payload into @p state.
+ *
+ * Uses the complete payload if the adapter has it, otherwise pulls what has
+ * arrived from the body stream.
+ *
+ * @return 1 once the payload (or the limit) is collected, 0 if the rest has
+ *         not arrived yet, 2 if the payload could not be read, -1 on
+ *         allocation failure.
+ */
+static int echo_collect(const struct app_request *req, struct echo_state *state){
 	if(req->payload && req->payload_len > 0){
-		res->payload_len = req->payload_len;
-		res->payload 	 = req->payload;
-		res->media_type  = req->media_type;
+		size_t len = req->payload_len < ECHO_MAX_PAYLOAD ? req->payload_len : ECHO_MAX_PAYLOAD;
+		state->buffer = malloc(len);
+		if(!state->buffer) return -1;
+		memcpy(state->buffer, req->payload, len);
+		state->len = state->cap = len;
+		return 1;
+	}
+	if(!req->body.read) return 1;
+
+	while(state->len < ECHO_MAX_PAYLOAD){
+		if(echo_reserve(state) < 0) return -1;
+		ssize_t n = app_request_read_body(req, state->buffer + state->len, state->cap - state->len);
+		if(n == APP_BODY_PENDING) return 0;
+		if(n < 0) return 2;
+		if(n == 0) break;
+		state->len += (size_t)n;
+	}
+	return 1;
+}
+
+
+/**
+ * @brief Hand the collected payload over to @p res (ownership included).
+ */
+static void echo_respond(struct echo_state *state, struct app_response *res){
+	res->payload 	   = state->buffer;
+	res->payload_len   = state->len;
+	res->payload_owned = state->buffer != NULL;
+	res->media_type    = state->media_type;
+	res->status 	   = APP_OK;
+	state->buffer = NULL;
+	state->len = state->cap = 0;
+}
+
+
+/**
+ * @brief Payload consumer of the echo route: keep pieces up to the limit, drop the rest.
+ */
+static int echo_consume(void *ctx, const void *data, size_t len){
+	struct echo_state *state = (struct echo_state*)ctx;
+	while(len > 0 && state->len < ECHO_MAX_PAYLOAD){
+		if(echo_reserve(state) < 0) return -1;
+		size_t take = state->cap - state->len;
+		if(take > len) take = len;
+		memcpy(state->buffer + state->len, data, take);
+		state->len += take;
+		data = (const char*)data + take;
+		len -= take;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Finish callback of the echo route's consumer: echo what was collected.
+ */
+static int echo_finish(void *ctx, struct app_response *res){
+	echo_respond((struct echo_state*)ctx, res);
+	return 0;
+}
+
+
+/**
+ * @brief Release callback of the echo route's consumer.
+ */
+static void echo_release(void *ctx){
+	struct echo_state *state = (struct echo_state*)ctx;
+	free(state->buffer);
+	free(state);
+}
+
+
+int handle_route_echo(const struct app_request *req, struct app_response *res){
+	struct echo_state *state = calloc(1, sizeof(*state));
+	if(!state) return -1;
+	state->media_type = req->media_type;
+
+	int collected = echo_collect(req, state);
+	if(collected < 0){
+		echo_release(state);
+		return -1;
+	}
+	if(collected == 0){
+		/* The rest of the payload comes later; the request is parked until it is complete. */
+		res->consumer = (struct app_body_consumer){
+			.consume = echo_consume,
+			.finish  = echo_finish,
+			.release = echo_release,
+			.ctx 	 = state
+		};
+		return 0;
+	}
+	if(collected == 2){
+		echo_release(state);
+		res->media_type = APP_MEDIA_NONE;
+		res->payload = NULL;
+		res->payload_len = 0;
 		res->payload_owned = false;
+		res->status = APP_BAD_REQUEST;
+		return 0;
+	}
+
+	if(state->len > 0){
+		echo_respond(state, res);
+		echo_release(state);
 	}else{
+		echo_release(state);
 		const char *method_name = NULL;
 
 		switch(req->method){
@@ -46,3 +188,64 @@ int handle_route_echo(const struct app_request *req, struct app_response *res){
 		res->status = APP_OK;
 		return 0;
 }
+
+
+/**
+ * @struct count_state
+ * @brief Progress of one streamed count.
+ */
+struct count_state {
+	unsigned long next;		/**< Next number to write. */
+	unsigned long last;		/**< Last number to write. */
+};
+
+
+/**
+ * @brief Producer of the count route: as many whole lines as fit into @p buf.
+ */
+static ssize_t count_produce(void *ctx, void *buf, size_t len){
+	struct count_state *state = (struct count_state*)ctx;
+	char *out = (char*)buf;
+	size_t used = 0;
+
+	while(state->next <= state->last){
+		char line[24];
+		int n = snprintf(line, sizeof(line), "%lu\n", state->next);
+		if(n < 0) return -1;
+		if((size_t)n > len - used) break;
+		memcpy(out + used, line, (size_t)n);
+		used += (size_t)n;
+		state->next++;
+	}
+	return (ssize_t)used;
+}
+
+
+int handle_route_count(const struct app_request *req, struct app_response *res){
+	unsigned long last = 10;
+	const char *n = app_request_param(req, "n", NULL);
+	if(n){
+		char *end = NULL;
+		errno = 0;
+		last = strtoul(n, &end, 10);
+		if(*n < '0' || *n > '9' || *end != '\0' || errno != 0 || last > COUNT_MAX){
+			res->media_type = APP_MEDIA_NONE;
+			res->status = APP_BAD_REQUEST;
+			return 0;
+		}
+	}
+
+	struct count_state *state = malloc(sizeof(*state));
+	if(!state) return -1;
+	state->next = 1;
+	state->last = last;
+
+	res->media_type = APP_MEDIA_TEXT;
+	res->stream = (struct app_body_producer){
+		.produce = count_produce,
+		.release = free,
+		.ctx 	 = state
+	};
+	res->status = APP_OK;
+	return 0;
+}
@@ -6,6 +6,7 @@ void api_router_init(struct api_router *router, const char *prefix,
                      struct api_route *route_table, size_t routes_cap){
 
     router->prefix      = prefix ? prefix : "/api";
+    router->prefix_len  = strlen(router->prefix);
     router->routes      = route_table;
     router->route_count = 0;
     router->max_routes  = routes_cap;
@@ -20,6 +21,7 @@ int api_router_add(struct api_router *router, enum app_method method,
 	struct api_route route = {
         .method  = method,
         .path    = path,
+        .path_len = strlen(path),
         .handler = handler,
     };
 
@@ -30,9 +32,9 @@ int api_router_add(struct api_router *router, enum app_method method,
 
 int api_router_handle(struct api_router *router, const struct app_request *req, struct app_response *out){
 
-	size_t prefix_len = strlen(router->prefix);
+	size_t prefix_len = router->prefix_len;
 	 if (prefix_len > 0) {
-        if (strncmp(req->path, router->prefix, prefix_len) != 0) {
+        if (req->path_len < prefix_len || memcmp(req->path, router->prefix, prefix_len) != 0) {
             return 1;
         }
 
@@ -42,10 +44,14 @@ int api_router_handle(struct api_router *router, const struct app_request *req,
         }
     }
 
+	const char *sub_path = req->path + prefix_len;
+	size_t sub_path_len = req->path_len - prefix_len;
 	size_t i=0;
 	while(i < router->route_count){
-		if(router->routes[i].method == req->method && strcmp(router->routes[i].path, req->path + prefix_len)==0){
-			return router->routes[i].handler(req, out);
+		const struct api_route *route = &router->routes[i];
+		if(route->method == req->method && route->path_len == sub_path_len &&
+		   memcmp(route->path, sub_path, sub_path_len)==0){
+			return route->handler(req, out);
 		}
 		i++;
 	}
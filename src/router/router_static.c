@@ -57,67 +57,26 @@ static const char* find_ext(const char *path) {
 
 
 /**
- * @brief Build a docroot-relative path from a URL path and mount prefix.
+ * @brief Build the docroot-relative path of a directory's index file.
  *
- * Behavior:
- *  - Skips a single '/' immediately after the prefix (if present).
- *  - Truncates at the first '?' or '#' (query/fragment start).
- *  - If the remaining part is empty or ends with '/', appends @p index_name.
- *  - Two-phase API:
- *      * If @p out_cap == 0: return the required length (excluding the NUL)
- *        and do not write to @p rel_path_out.
- *      * Otherwise: write the path into @p rel_path_out, NUL-terminate it,
- *        and return the length written (excluding the NUL).
+ * Only needed for directory requests; any other request path is used in
+ * place (see @ref static_router_handle).
  *
- * Notes:
- *  - The caller is responsible for ensuring that @p path actually matches
- *    the prefix and for any security checks beyond query/fragment stripping.
- *
- * @param path          Full URL path (NUL-terminated, must not be NULL).
- * @param path_len      Length of @p path in bytes (excluding the NUL).
- * @param prefix_len    Length of the prefix within @p path.
+ * @param dir           Directory part (ends with '/' or is empty; need not be NUL-terminated).
+ * @param dir_len       Length of @p dir in bytes.
  * @param index_name    Default filename for directory requests (e.g., "index.html").
- * @param rel_path_out  Output buffer (may be NULL only when @p out_cap == 0).
- * @param out_cap       Capacity of @p rel_path_out in bytes, including space for the NUL.
  *
- * @return Required length (>= 0) on success; -1 on error
- *         (invalid args, insufficient capacity, or @p path_len <= @p prefix_len).
+ * @return Heap-allocated NUL-terminated path (caller frees), or NULL on allocation failure.
  */
-static ssize_t build_rel_path(const char *path, size_t path_len, size_t prefix_len, 
-						  const char *index_name, char *rel_path_out, size_t out_cap){
-
-	if(!path || !index_name) return -1;
-	if(path_len <= prefix_len) return -1;
-
-	const char *p =  path + prefix_len;
-	size_t remaining = path_len - prefix_len;
-
-    if (remaining && *p == '/') { p++; remaining--; }
-
-	size_t end = 0;
-
-	while(end<remaining && p[end] != '#' && p[end] != '?') end++;
+static char *build_index_path(const char *dir, size_t dir_len, const char *index_name){
 
     size_t index_name_len = strlen(index_name);
-	size_t rel_path_len = 0;
-
-	if(end == 0 || p[end-1] == '/'){
-		rel_path_len = end + index_name_len;
-	}else{
-		rel_path_len = end;
-	}
-
-	if(out_cap == 0) return rel_path_len;
-	if(!rel_path_out) return -1;
-
-	if(rel_path_len + 1 > out_cap) return -1;
+	char *rel_path = malloc(dir_len + index_name_len + 1);
+	if(!rel_path) return NULL;
 
-	memcpy(rel_path_out, p, end);
-	if (end == 0 || p[end - 1] == '/') {
-        memcpy(rel_path_out + end, index_name, index_name_len);
-    }
-	rel_path_out[rel_path_len] = '\0';
-	return rel_path_len;
+	memcpy(rel_path, dir, dir_len);
+	memcpy(rel_path + dir_len, index_name, index_name_len + 1);
+	return rel_path;
 }
 
 
@@ -125,6 +84,7 @@ void static_router_init(struct static_router *router, const char *prefix, struct
 						const char *index_name, size_t max_bytes){
 	if(!router || !vfs) return;
 	router->prefix = prefix ? prefix : "/public";
+	router->prefix_len = strlen(router->prefix);
 	router->vfs = vfs;
 	router->index_name = index_name ? index_name : "index.html";
 	router->max_bytes = max_bytes;
@@ -134,11 +94,13 @@ void static_router_init(struct static_router *router, const char *prefix, struct
 int static_router_handle(struct static_router *router, const struct app_request *req,
                          struct app_response *out){
 	
-	size_t path_len = strlen(req->path);
-	size_t prefix_len = strlen(router->prefix);
+	size_t path_len = req->path_len;
+	size_t prefix_len = router->prefix_len;
 	if(path_len <= prefix_len) return 1; //TODO: redirect wenn path = prefix without trailing /
+	/* Only canonical paths (see app_request) are safe to hand to the filesystem. */
+	if(req->path[0] != '/') return 1;
 	if(prefix_len > 0){
-        if (strncmp(req->path, router->prefix, prefix_len) != 0) {
+        if (memcmp(req->path, router->prefix, prefix_len) != 0) {
             return 1;
         }
 
@@ -158,21 +120,17 @@ int static_router_handle(struct static_router *router, const struct app_request
         return 0;
     }
 
-	ssize_t to_write = build_rel_path(req->path, path_len, prefix_len,
-                                  router->index_name, NULL, 0);
-    if(to_write < 0) return -1;
-
-
-    char *rel_path = calloc((size_t)to_write + 1, sizeof(char));
-    if(!rel_path) return -1;
+	/* The canonical path after the prefix is the docroot-relative path. */
+	const char *sub_path = req->path + prefix_len;
+	size_t sub_path_len = path_len - prefix_len;
+	if(*sub_path == '/'){ sub_path++; sub_path_len--; }
 
-    ssize_t wrote = build_rel_path(req->path, path_len, prefix_len,
-                                   router->index_name, rel_path, (size_t)to_write + 1);
-
-    if(wrote < 0 || wrote != to_write){ 
-		free(rel_path); 
-		return -1; 
+	char *index_path = NULL;
+	if(sub_path_len == 0 || sub_path[sub_path_len - 1] == '/'){
+		index_path = build_index_path(sub_path, sub_path_len, router->index_name);
+		if(!index_path) return -1;
 	}
+	const char *rel_path = index_path ? index_path : sub_path;
 
 	struct fs_stat stat = {0};
     int stat_ret = fs_stat(router->vfs, rel_path, &stat);
@@ -183,7 +141,7 @@ int static_router_handle(struct static_router *router, const struct app_request
         out->payload       = nf_message;
         out->payload_len   = sizeof(nf_message) - 1;
         out->payload_owned = false;
-        free(rel_path);
+        free(index_path);
         return 0;
     }
 
@@ -194,24 +152,40 @@ int static_router_handle(struct static_router *router, const struct app_request
         out->payload       = tl_message;
         out->payload_len   = sizeof(tl_message) - 1;
         out->payload_owned = false;
-        free(rel_path);
+        free(index_path);
         return 0;
     }
 
 	
+	enum app_media media_type = media_from_ext(find_ext(rel_path));
+
 	struct fs_file *file = NULL;
 	void *buffer = NULL;
 	ssize_t total_read = 0;
 	if(stat.size >0){
     	int open_ret = fs_open(router->vfs, rel_path, &file);
     	if(!file || open_ret != FS_OK){
-			free(rel_path);
+			free(index_path);
 			return -1;
 		}
 
+		/* Backends with a native descriptor: the framework sends the file
+		 * with sendfile(2), no buffer and no copy through user space. */
+		if(fs_native_fd(file) >= 0){
+			out->status        = APP_OK;
+			out->media_type    = media_type;
+			out->payload       = NULL;
+			out->payload_len   = (size_t)stat.size;
+			out->payload_owned = false;
+			out->file          = file;
+			out->file_offset   = 0;
+			free(index_path);
+			return 0;
+		}
+
 		buffer = calloc(stat.size, 1);
 		if(!buffer){
-        	free(rel_path);
+        	free(index_path);
 			fs_close(file);
         	return -1;
 		}
@@ -219,21 +193,19 @@ int static_router_handle(struct static_router *router, const struct app_request
 		total_read = fs_read_all(file, buffer, stat.size);
 		if(total_read < 0){
 			free(buffer);
-			free(rel_path);
+			free(index_path);
 			fs_close(file);
 			return -1;
 		}
 		fs_close(file);
 	}
 
-	enum app_media media_type = media_from_ext(find_ext(rel_path));
-
     out->status        = APP_OK;
     out->media_type    = media_type;
     out->payload       = buffer;
     out->payload_len   = (size_t)total_read;
     out->payload_owned = buffer ? true : false;
 
-	free(rel_path);
+	free(index_path);
 	return 0;
 }
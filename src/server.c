@@ -1,24 +1,293 @@
+#ifdef __linux__
+#define _GNU_SOURCE		/* accept4() */
+#endif
+
 #include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
 #include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <linux/io_uring.h>
+#endif
 
 #include "../include/server.h"
 #include "../include/error.h"
+#include "../include/uring.h"
+#include "../include/timer_wheel.h"
+#include "../include/access_log.h"
 
-int server_start(const struct server_config *config, int (*client_handler)(int fd, void* context), void *context){
-    if (!config || !client_handler){
-		fprintf(stderr, "server_start: bad arguments\n");
-		return -1; 
+/**
+ * @def SERVER_MAX_EVENTS
+ * @brief Number of readiness events fetched per epoll_wait() call.
+ */
+#define SERVER_MAX_EVENTS 64
+
+/**
+ * @def SERVER_URING_ENTRIES
+ * @brief Submission queue size of each worker's io_uring.
+ */
+#define SERVER_URING_ENTRIES 256
+
+/**
+ * @def SERVER_URING_BUFFERS
+ * @brief Number of provided receive buffers per worker (power of two).
+ */
+#define SERVER_URING_BUFFERS 64
+
+/**
+ * @def SERVER_URING_BUFFER_SIZE
+ * @brief Size of one provided receive buffer.
+ */
+#define SERVER_URING_BUFFER_SIZE 4096
+
+/**
+ * @def SERVER_URING_MAX_SEGMENTS
+ * @brief Maximum output segments sent as one chain of linked sends.
+ */
+#define SERVER_URING_MAX_SEGMENTS 8
+
+/**
+ * @def SERVER_UPGRADE_ENV
+ * @brief Environment variable naming the Unix socket an upgraded process gets its listeners from.
+ */
+#define SERVER_UPGRADE_ENV "NAPOLEON_UPGRADE_FD"
+
+/**
+ * @def SERVER_UPGRADE_MAX_LISTENERS
+ * @brief Maximum number of listeners a process adopts on upgrade.
+ */
+#define SERVER_UPGRADE_MAX_LISTENERS 1024
+
+/**
+ * @def SERVER_UPGRADE_BATCH
+ * @brief Listeners passed per SCM_RIGHTS message (the kernel caps one message at 253).
+ */
+#define SERVER_UPGRADE_BATCH 64
+
+/**
+ * @def SERVER_UPGRADE_ACK
+ * @brief Byte the new process sends once it has taken over the listeners.
+ */
+#define SERVER_UPGRADE_ACK 'R'
+
+/**
+ * @def SERVER_UPGRADE_TIMEOUT_MS
+ * @brief How long the old process waits for that confirmation.
+ */
+#define SERVER_UPGRADE_TIMEOUT_MS 10000
+
+/**
+ * @def SERVER_TIMER_TICK_MS
+ * @brief Resolution of the connection deadlines (one revolution of the wheel is ~16 s).
+ */
+#define SERVER_TIMER_TICK_MS 16
+
+/**
+ * @def SERVER_CONTAINER_OF
+ * @brief Map a pointer to @p member back to the enclosing @p type.
+ */
+#define SERVER_CONTAINER_OF(ptr, type, member) ((type*)(void*)((char*)(ptr) - offsetof(type, member)))
+
+extern char **environ;
+
+
+/**
+ * @brief Link of a connection in its loop's connection list.
+ */
+struct conn_link {
+	struct conn_link *prev;	/**< Previous connection. */
+	struct conn_link *next;	/**< Next connection. */
+};
+
+
+/**
+ * @brief All open connections of one loop, walked when the server drains.
+ */
+struct conn_list {
+	struct conn_link *head;	/**< First connection, NULL if none. */
+};
+
+
+/**
+ * @brief Per-connection bookkeeping of the event loop.
+ *
+ * Registered as the epoll user pointer so an event leads straight to the
+ * socket and the handler's state object.
+ */
+struct server_conn {
+	struct conn_link  link;		/**< Membership in the loop's connection list. */
+	struct timer_node timer;	/**< Deadline in the loop's timer wheel. */
+	int   fd;					/**< Client socket (owned by the loop). */
+	void *state;				/**< State returned by @ref server_conn_handler::open. */
+	unsigned requests;			/**< Requests in flight as last reported by the handler. */
+};
+
+
+/**
+ * @brief Per-thread state of a worker.
+ *
+ * Every worker owns its own listening socket and runs either the blocking
+ * accept loop (@ref client_handler set) or the event loop (@ref conn_handler set).
+ */
+struct server_worker {
+	pthread_t 						  thread;			/**< Worker thread (unused for worker 0). */
+	int 							  server_sock;		/**< Listening socket owned by this worker. */
+	int 							(*client_handler)(int fd, void *context); /**< Blocking-mode handler. */
+	const struct server_conn_handler *conn_handler;		/**< Event-loop-mode handler. */
+	bool 							  uring;			/**< Drive @ref conn_handler with io_uring instead of epoll. */
+	bool 							  nodelay;			/**< Set TCP_NODELAY on accepted connections. */
+	int 							  idle_timeout_ms;	/**< Idle limit for handlers without deadlines (0 → none). */
+	struct server_limits 			  limits;			/**< This worker's share of the admission limits. */
+	int 							  drain_fd;			/**< Becomes readable once the server drains. */
+	void 							 *context;			/**< Forwarded to the handler. */
+};
+
+
+/**
+ * @brief Commands understood by the control thread.
+ */
+enum server_cmd {
+	SERVER_CMD_STOP    = 's',	/**< Drain and return (@ref server_stop). */
+	SERVER_CMD_UPGRADE = 'u',	/**< Hand over the listeners, then drain (@ref server_upgrade). */
+	SERVER_CMD_QUIT    = 'q'	/**< Workers are done; end the control thread. */
+};
+
+
+/**
+ * @brief Control thread of a running server.
+ *
+ * @ref server_stop and @ref server_upgrade only write a command byte into
+ * @ref cmd, which is async-signal-safe; this thread does the actual work.
+ * The drain pipe is never read: once written it stays readable, so a single
+ * byte wakes every worker.
+ */
+struct server_control {
+	pthread_t 					thread;			/**< Control thread. */
+	const struct server_config *config;			/**< Configuration of the running server. */
+	const struct server_worker *workers;		/**< Workers whose listeners are handed over on upgrade. */
+	unsigned 					worker_count;	/**< Number of @ref workers. */
+	int 						cmd[2];			/**< Command pipe (read end, write end). */
+	int 						drain[2];		/**< Drain pipe (read end, write end). */
+	char 						upgrade_path[PATH_MAX]; /**< Executable of @ref server_config::upgrade_argv, resolved at startup ("" → no upgrades). */
+};
+
+
+/**
+ * @brief Write end of the running server's command pipe (-1 → no server).
+ */
+static volatile sig_atomic_t control_fd = -1;
+
+
+/**
+ * @brief Switch a file descriptor to non-blocking mode.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int set_nonblocking(int fd){
+	int flags = fcntl(fd, F_GETFL, 0);
+	if(flags < 0) return -1;
+	return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+
+#ifndef __linux__
+/**
+ * @brief Switch a file descriptor back to blocking mode.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int set_blocking(int fd){
+	int flags = fcntl(fd, F_GETFL, 0);
+	if(flags < 0) return -1;
+	return fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+}
+#endif
+
+
+/**
+ * @brief Keep @p fd out of processes exec'd by @ref server_upgrade.
+ *
+ * A client socket leaked into the new process would stay open after this
+ * process closes it.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int set_cloexec(int fd){
+	int flags = fcntl(fd, F_GETFD, 0);
+	if(flags < 0) return -1;
+	return fcntl(fd, F_SETFD, flags | FD_CLOEXEC);
+}
+
+
+/**
+ * @brief Disable Nagle's algorithm so short responses leave without delay.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int set_nodelay(int fd){
+	int one = 1;
+	return setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+
+/**
+ * @brief Apply the TCP options of @p opts to a listening socket.
+ *
+ * Failures are logged but not fatal: the listener works without them.
+ */
+static void set_listener_opts(int server_sock, const struct server_listener_opts *opts){
+#ifdef TCP_DEFER_ACCEPT
+	if(opts->defer_accept_s > 0){
+		LOG_ON_ERROR( setsockopt(server_sock, IPPROTO_TCP, TCP_DEFER_ACCEPT, &opts->defer_accept_s,
+								 sizeof(opts->defer_accept_s)), 0, "TCP_DEFER_ACCEPT" );
+	}
+#endif
+#ifdef TCP_FASTOPEN
+	if(opts->fastopen_qlen > 0){
+		LOG_ON_ERROR( setsockopt(server_sock, IPPROTO_TCP, TCP_FASTOPEN, &opts->fastopen_qlen,
+								 sizeof(opts->fastopen_qlen)), 0, "TCP_FASTOPEN" );
 	}
-	
+#endif
+	(void)server_sock;
+	(void)opts;
+}
+
+
+/**
+ * @brief Create, bind and listen on a TCP socket for @p config.
+ *
+ * With @p reuse_port set, SO_REUSEPORT is enabled before bind() so several
+ * workers can bind the same address and the kernel spreads incoming
+ * connections across their sockets. The backlog and the options of
+ * @ref server_config::listener are applied as configured.
+ *
+ * Exits the process on failure, like the original accept loop did.
+ *
+ * @return Listening socket file descriptor.
+ */
+static int open_listener(const struct server_config *config, bool reuse_port){
 	u_int16_t port = config->port;
 	const char* host = config->host;
-	const int backlog = SOMAXCONN;
-    
+	const int backlog = config->backlog > 0 ? config->backlog : SOMAXCONN;
+
 	struct sockaddr_in addr;
-    
+
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
     addr.sin_port = htons(port);
@@ -26,38 +295,1510 @@ int server_start(const struct server_config *config, int (*client_handler)(int f
 
     int server_sock = socket(AF_INET, SOCK_STREAM, 0);
     EXIT_ON_ERROR( server_sock, 0, "socket" );
+	EXIT_ON_ERROR( set_cloexec(server_sock), 0, "fcntl server_sock" );
+	if(reuse_port){
+		int one = 1;
+		EXIT_ON_ERROR( setsockopt(server_sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)), 0, "SO_REUSEPORT" );
+	}
     EXIT_ON_ERROR( inet_pton(AF_INET, host, &addr.sin_addr), 1,"pton" );
     EXIT_ON_ERROR( bind(server_sock, (struct sockaddr*)&addr, sizeof(addr)), 0 ,"bind" );
+	set_listener_opts(server_sock, &config->listener);
     EXIT_ON_ERROR( listen(server_sock, backlog), 0, "listen" );
 
-    printf("\nlistening on port %d\n\n", port);
+	return server_sock;
+}
+
 
+/**
+ * @brief Accept one connection and log the peer address.
+ *
+ * The socket is close-on-exec and, with @p nonblocking, non-blocking; on
+ * Linux accept4(2) sets both without extra fcntl() calls.
+ *
+ * @return Client socket, or -1 if nothing could be accepted (errno set).
+ */
+static int accept_client(int server_sock, bool nonblocking, bool nodelay){
     struct sockaddr_in client_addr;
     socklen_t client_len = sizeof(client_addr);
 
-    while(1){
-        
-        int client_sock = accept(server_sock, (struct sockaddr*)&client_addr, &client_len);
+#ifdef __linux__
+	int client_sock = accept4(server_sock, (struct sockaddr*)&client_addr, &client_len,
+							  SOCK_CLOEXEC | (nonblocking ? SOCK_NONBLOCK : 0));
+	if(client_sock < 0) return -1;
+#else
+	int client_sock = accept(server_sock, (struct sockaddr*)&client_addr, &client_len);
+	if(client_sock < 0) return -1;
+	/* BSD sockets inherit O_NONBLOCK from the listener. */
+	if(set_cloexec(client_sock) < 0 || (nonblocking ? set_nonblocking(client_sock) : set_blocking(client_sock)) < 0){
+		int saved = errno;
+		close(client_sock);
+		errno = saved;
+		return -1;
+	}
+#endif
+	if(nodelay) LOG_ON_ERROR( set_nodelay(client_sock), 0, "TCP_NODELAY" );
+
+	if(access_log_sample(ACCESS_LOG_DEBUG)) access_log_conn(ACCESS_LOG_ACCEPT, ACCESS_LOG_DEBUG, &client_addr);
+	return client_sock;
+}
+
+
+/**
+ * @brief Log a connection event, looking up the peer only if the record is kept.
+ */
+static void log_peer(int client_sock, enum access_log_event event, enum access_log_level level){
+	if(!access_log_sample(level)) return;
+
+	struct sockaddr_in client_addr;
+	socklen_t client_len = sizeof(client_addr);
+	if(getpeername(client_sock, (struct sockaddr*)&client_addr, &client_len) < 0) return;
+	access_log_conn(event, level, &client_addr);
+}
+
+
+/**
+ * @brief Add @p link at the head of @p list.
+ */
+static void conn_list_add(struct conn_list *list, struct conn_link *link){
+	link->prev = NULL;
+	link->next = list->head;
+	if(list->head) list->head->prev = link;
+	list->head = link;
+}
+
+
+/**
+ * @brief Unlink @p link from @p list (no-op if not linked).
+ */
+static void conn_list_remove(struct conn_list *list, struct conn_link *link){
+	if(link->prev) link->prev->next = link->next;
+	else if(list->head == link) list->head = link->next;
+	if(link->next) link->next->prev = link->prev;
+	link->prev = link->next = NULL;
+}
+
+
+/**
+ * @brief (Re)arm a connection's timer after a call into its handler.
+ *
+ * Handlers with a @ref server_conn_handler::deadline decide themselves (e.g.
+ * a header deadline that trickling bytes do not extend); otherwise the
+ * connection may stay silent for @p idle_timeout_ms from now.
+ */
+static void schedule_conn(struct timer_wheel *wheel, struct timer_node *timer, const struct server_conn_handler *handler,
+						  void *state, void *context, int idle_timeout_ms, int64_t now){
+	int64_t deadline = -1;
+	if(handler->deadline) deadline = handler->deadline(state, context);
+	else if(idle_timeout_ms > 0) deadline = now + idle_timeout_ms;
+
+	if(deadline < 0) timer_wheel_cancel(wheel, timer);
+	else timer_wheel_schedule(wheel, timer, deadline);
+}
+
+
+/**
+ * @brief Admission state of one event loop.
+ */
+struct admission {
+	struct server_limits limits;	/**< The worker's share of the limits. */
+	unsigned 			 conns;		/**< Connections not yet released. */
+	unsigned 			 requests;	/**< Requests in flight over all connections. */
+};
+
+
+/**
+ * @brief Share of a process-wide @p limit for one of @p workers (0 stays unlimited).
+ */
+static unsigned limit_share(unsigned limit, unsigned workers){
+	if(limit == 0) return 0;
+	return (limit + workers - 1) / workers;
+}
+
+
+/**
+ * @brief Whether the loop is at one of its limits and must not take new connections.
+ */
+static bool admission_full(const struct admission *adm){
+	if(adm->limits.max_conns > 0 && adm->conns >= adm->limits.max_conns) return true;
+	if(adm->limits.max_requests > 0 && adm->requests >= adm->limits.max_requests) return true;
+	return false;
+}
+
+
+/**
+ * @brief Refresh a connection's contribution to the loop's in-flight requests.
+ *
+ * @param tracked Count last reported for the connection, updated in place.
+ */
+static void admission_track(struct admission *adm, unsigned *tracked, const struct server_conn_handler *handler,
+							void *state, void *context){
+	if(!handler->in_flight) return;
+	unsigned now = handler->in_flight(state, context);
+	adm->requests = adm->requests - *tracked + now;
+	*tracked = now;
+}
+
+
+/**
+ * @brief Answer a refused connection with the canned response and close it.
+ *
+ * One non-blocking send: the response fits into any socket buffer. The unread
+ * request is discarded first, so closing does not turn into a reset that could
+ * destroy the response on its way to the client.
+ */
+static void reject_conn(int client_sock, const struct server_limits *limits){
+	log_peer(client_sock, ACCESS_LOG_REFUSE, ACCESS_LOG_WARN);
+	if(limits->reject_response_len > 0){
+		LOG_ON_ERROR( send(client_sock, limits->reject_response, limits->reject_response_len, MSG_DONTWAIT), 0, "send reject_response");
+	}
+	shutdown(client_sock, SHUT_WR);
+
+	char scratch[1024];
+	for(int i=0; i<4 && recv(client_sock, scratch, sizeof(scratch), MSG_DONTWAIT) > 0; i++);
+	LOG_ON_ERROR( close(client_sock), 0, "close client_sock");
+}
+
+
+/**
+ * @brief Block until @p worker's listener is readable or the server drains.
+ *
+ * @return true if a connection may be waiting, false once the worker should stop.
+ */
+static bool wait_for_client(const struct server_worker *worker){
+	struct pollfd pfds[2] = {
+		{ .fd = worker->server_sock, .events = POLLIN },
+		{ .fd = worker->drain_fd,    .events = POLLIN }
+	};
+	while(poll(pfds, 2, -1) < 0){
+		if(errno == EINTR) continue;
+		perror("poll server_sock");
+		return false;
+	}
+	return pfds[1].revents == 0;
+}
+
+
+/**
+ * @brief Blocking accept loop: serve one connection at a time on @p worker's socket.
+ */
+static void run_accept_loop(struct server_worker *worker){
+	/* After an upgrade another process accepts from the same socket, so a wake-up may find nothing. */
+	EXIT_ON_ERROR( set_nonblocking(worker->server_sock), 0, "fcntl server_sock" );
+
+    while(wait_for_client(worker)){
+
+        int client_sock = accept_client(worker->server_sock, false, worker->nodelay);
 
         if(client_sock >= 0){
-            client_len = sizeof(client_addr);
-            char client_ip_str[INET_ADDRSTRLEN];
-            int client_port = ntohs(client_addr.sin_port);
-            inet_ntop(AF_INET, &client_addr.sin_addr, client_ip_str, sizeof(client_ip_str));
-            printf("accepted connection from %s:%d \n",client_ip_str, client_port);
-			
-			client_handler(client_sock, context);
-            
+			worker->client_handler(client_sock, worker->context);
+
 			LOG_ON_ERROR( close(client_sock), 0, "close client_sock");
         }
 
     }
-    
-    LOG_ON_ERROR( close(server_sock), 0, "close server_sock");
-    
 }
 
 
+static void run_event_loop(struct server_worker *worker);
+static int run_uring_loop(struct server_worker *worker);
+
+
+/**
+ * @brief Thread entry point of a worker.
+ */
+static void *worker_main(void *arg){
+	struct server_worker *worker = (struct server_worker*)arg;
+	if(worker->client_handler){
+		run_accept_loop(worker);
+	}else if(worker->uring && run_uring_loop(worker) == 0){
+		return NULL;
+	}else{
+		run_event_loop(worker);
+	}
+	return NULL;
+}
+
+
+/**
+ * @brief Create a close-on-exec pipe whose write end never blocks.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int open_pipe(int fds[2]){
+	if(pipe(fds) < 0) return -1;
+	if(set_cloexec(fds[0]) < 0 || set_cloexec(fds[1]) < 0 || set_nonblocking(fds[1]) < 0){
+		close(fds[0]);
+		close(fds[1]);
+		return -1;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Send the listeners of @p workers over the Unix socket @p sock.
+ *
+ * Descriptors go in batches of @ref SERVER_UPGRADE_BATCH; every message
+ * carries the total count so the receiver knows when it has all of them.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int send_listeners(int sock, const struct server_worker *workers, unsigned worker_count){
+	int fds[SERVER_UPGRADE_MAX_LISTENERS];
+	uint32_t total = 0;
+	for(unsigned i=0; i<worker_count && total < SERVER_UPGRADE_MAX_LISTENERS; i++){
+		if(workers[i].server_sock >= 0) fds[total++] = workers[i].server_sock;
+	}
+
+	for(uint32_t sent=0; sent<total; ){
+		uint32_t batch = total - sent < SERVER_UPGRADE_BATCH ? total - sent : SERVER_UPGRADE_BATCH;
+
+		union {
+			struct cmsghdr hdr;
+			char 		   buf[CMSG_SPACE(sizeof(int) * SERVER_UPGRADE_BATCH)];
+		} cbuf;
+		memset(&cbuf, 0, sizeof(cbuf));
+
+		struct iovec iov = { .iov_base = &total, .iov_len = sizeof(total) };
+		struct msghdr msg = {
+			.msg_iov 		= &iov,
+			.msg_iovlen 	= 1,
+			.msg_control 	= cbuf.buf,
+			.msg_controllen = CMSG_SPACE(sizeof(int) * batch)
+		};
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int) * batch);
+		memcpy(CMSG_DATA(cmsg), fds + sent, sizeof(int) * batch);
+
+		if(sendmsg(sock, &msg, 0) < 0){
+			if(errno == EINTR) continue;
+			return -1;
+		}
+		sent += batch;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Receive the listeners sent by @ref send_listeners.
+ *
+ * @return Number of descriptors stored in @p fds, or -1 on error (none kept open).
+ */
+static int receive_listeners(int sock, int *fds, unsigned max){
+	uint32_t total = 0;
+	unsigned received = 0;
+
+	do{
+		union {
+			struct cmsghdr hdr;
+			char 		   buf[CMSG_SPACE(sizeof(int) * SERVER_UPGRADE_BATCH)];
+		} cbuf;
+		uint32_t msg_total = 0;
+		struct iovec iov = { .iov_base = &msg_total, .iov_len = sizeof(msg_total) };
+		struct msghdr msg = {
+			.msg_iov 		= &iov,
+			.msg_iovlen 	= 1,
+			.msg_control 	= cbuf.buf,
+			.msg_controllen = sizeof(cbuf.buf)
+		};
+
+		ssize_t n = recvmsg(sock, &msg, 0);
+		if(n < 0 && errno == EINTR) continue;
+		if(n != (ssize_t)sizeof(msg_total) || msg_total == 0 || msg_total > max
+		   || (total && msg_total != total)) goto fail;
+		total = msg_total;
+
+		for(struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)){
+			if(cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+			size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			for(size_t i=0; i<count; i++){
+				int fd;
+				memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+				if(received < total) fds[received++] = fd;
+				else close(fd);
+			}
+		}
+		if(msg.msg_flags & MSG_CTRUNC) goto fail;
+	}while(received < total);
+
+	for(unsigned i=0; i<received; i++) set_cloexec(fds[i]);
+	return (int)received;
+
+fail:
+	for(unsigned i=0; i<received; i++) close(fds[i]);
+	return -1;
+}
+
+
+/**
+ * @brief Take the upgrade socket left by the previous server process, if any.
+ *
+ * The variable is removed so it does not leak into later upgrades.
+ *
+ * @return Socket descriptor, or -1 if this process was not started by @ref server_upgrade.
+ */
+static int take_upgrade_fd(void){
+	const char *value = getenv(SERVER_UPGRADE_ENV);
+	if(!value) return -1;
+
+	errno = 0;
+	char *end;
+	long fd = strtol(value, &end, 10);
+	bool valid = end != value && *end == '\0' && errno == 0 && fd >= 0 && fd <= INT_MAX;
+	unsetenv(SERVER_UPGRADE_ENV);
+
+	if(!valid || set_cloexec((int)fd) < 0){
+		fprintf(stderr, "upgrade: ignoring invalid %s\n", SERVER_UPGRADE_ENV);
+		return -1;
+	}
+	return (int)fd;
+}
+
+
+/**
+ * @brief Build the environment of the new process: ours plus @p entry.
+ *
+ * @return NULL-terminated array (free with free()), or NULL on allocation failure.
+ */
+static char **upgrade_environ(char *entry){
+	size_t count = 0;
+	while(environ[count]) count++;
+
+	char **envp = calloc(count + 2, sizeof(char*));
+	if(!envp) return NULL;
+
+	size_t n = 0;
+	for(size_t i=0; i<count; i++){
+		if(strncmp(environ[i], SERVER_UPGRADE_ENV "=", sizeof(SERVER_UPGRADE_ENV)) == 0) continue;
+		envp[n++] = environ[i];
+	}
+	envp[n++] = entry;
+	envp[n] = NULL;
+	return envp;
+}
+
+
+/**
+ * @brief Wait until the new process confirms that it serves the listeners.
+ *
+ * @return 0 once confirmed, -1 on timeout, EOF or error.
+ */
+static int wait_for_takeover(int sock){
+	struct pollfd pfd = { .fd = sock, .events = POLLIN };
+	int ready;
+	do{
+		ready = poll(&pfd, 1, SERVER_UPGRADE_TIMEOUT_MS);
+	}while(ready < 0 && errno == EINTR);
+	if(ready <= 0) return -1;
+
+	char ack = 0;
+	if(read(sock, &ack, 1) != 1 || ack != SERVER_UPGRADE_ACK) return -1;
+	return 0;
+}
+
+
+/**
+ * @brief Resolve the executable named by @p name into an absolute path.
+ *
+ * execve(2) does not search PATH and a relative path depends on the working
+ * directory, so this runs once at startup. A path is made absolute against
+ * the current directory; symlinks are kept, so a deploy that repoints them
+ * is picked up by the upgrade. A bare name was found through PATH by
+ * whoever started the server, so it stands for the running executable
+ * (/proc/self/exe).
+ *
+ * @return 0 on success, -1 if the path cannot be determined or does not fit @p cap.
+ */
+static int resolve_upgrade_path(const char *name, char *out, size_t cap){
+	if(!strchr(name, '/')){
+		ssize_t n = readlink("/proc/self/exe", out, cap);
+		if(n <= 0 || (size_t)n >= cap) return -1;
+		out[n] = '\0';
+		return 0;
+	}
+	if(name[0] == '/'){
+		int n = snprintf(out, cap, "%s", name);
+		return n < 0 || (size_t)n >= cap ? -1 : 0;
+	}
+	char cwd[PATH_MAX];
+	if(!getcwd(cwd, sizeof(cwd))) return -1;
+	int n = snprintf(out, cap, "%s/%s", cwd, name);
+	return n < 0 || (size_t)n >= cap ? -1 : 0;
+}
+
+
+/**
+ * @brief Start the configured binary and pass it the listeners.
+ *
+ * @return 0 once the new process has taken over, -1 if this one must keep serving.
+ */
+static int upgrade_process(const struct server_control *ctl){
+	char *const *argv = ctl->config->upgrade_argv;
+	if(!argv || !argv[0] || ctl->upgrade_path[0] == '\0'){
+		fprintf(stderr, "upgrade: no command configured\n");
+		return -1;
+	}
+
+	int sv[2];
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0){
+		perror("upgrade: socketpair");
+		return -1;
+	}
+	set_cloexec(sv[0]);
+
+	char entry[sizeof(SERVER_UPGRADE_ENV) + 16];
+	snprintf(entry, sizeof(entry), SERVER_UPGRADE_ENV "=%d", sv[1]);
+	char **envp = upgrade_environ(entry);
+	if(!envp){
+		close(sv[0]);
+		close(sv[1]);
+		return -1;
+	}
+
+	pid_t pid = fork();
+	if(pid == 0){
+		/* Other threads' locks are lost in the child: only async-signal-safe calls until exec. */
+		execve(ctl->upgrade_path, argv, envp);
+		_exit(127);
+	}
+	free(envp);
+	close(sv[1]);
+	if(pid < 0){
+		perror("upgrade: fork");
+		close(sv[0]);
+		return -1;
+	}
+
+	int ret = send_listeners(sv[0], ctl->workers, ctl->worker_count);
+	if(ret == 0) ret = wait_for_takeover(sv[0]);
+	close(sv[0]);
+
+	if(ret < 0){
+		fprintf(stderr, "upgrade: %s (pid %d) did not take over, still serving\n", ctl->upgrade_path, (int)pid);
+		kill(pid, SIGTERM);
+		waitpid(pid, NULL, 0);
+		return -1;
+	}
+	printf("upgrade: pid %d took over the listeners\n", (int)pid);
+	return 0;
+}
+
+
+/**
+ * @brief Control thread entry point: act on commands until told to quit.
+ */
+static void *control_main(void *arg){
+	struct server_control *ctl = (struct server_control*)arg;
+
+	while(1){
+		char cmd;
+		ssize_t n = read(ctl->cmd[0], &cmd, 1);
+		if(n < 0 && errno == EINTR) continue;
+		if(n <= 0 || cmd == SERVER_CMD_QUIT) break;
+
+		if(cmd == SERVER_CMD_UPGRADE && upgrade_process(ctl) < 0) continue;
+		if(cmd == SERVER_CMD_UPGRADE || cmd == SERVER_CMD_STOP){
+			printf("draining connections\n");
+			LOG_ON_ERROR( write(ctl->drain[1], "d", 1), 0, "write drain pipe");
+		}
+	}
+	return NULL;
+}
+
+
+/**
+ * @brief Write @p cmd to the running server's control thread, if there is one.
+ *
+ * Async-signal-safe.
+ */
+static void send_command(char cmd){
+	int fd = control_fd;
+	if(fd < 0) return;
+
+	int saved = errno;
+	ssize_t ret = write(fd, &cmd, 1);
+	(void)ret;
+	errno = saved;
+}
+
+
+/**
+ * @brief Open one listener per worker and run the workers until they return.
+ *
+ * Worker 0 runs on the calling thread, the others on their own threads; a
+ * control thread handles @ref server_stop and @ref server_upgrade. With a
+ * single worker no SO_REUSEPORT socket option is used. A process started by
+ * @ref server_upgrade adopts the listeners of its predecessor instead and runs
+ * one worker per listener.
+ *
+ * @return 0 when all workers returned, -1 on setup failure.
+ */
+static int run_workers(const struct server_config *config, struct server_worker *prototype){
+	unsigned worker_count = config->workers > 0 ? config->workers : 1;
+	bool reuse_port = worker_count > 1;
+
+	int inherited[SERVER_UPGRADE_MAX_LISTENERS];
+	int upgrade_fd = take_upgrade_fd();
+	if(upgrade_fd >= 0){
+		int count = receive_listeners(upgrade_fd, inherited, SERVER_UPGRADE_MAX_LISTENERS);
+		if(count < 0){
+			fprintf(stderr, "upgrade: could not receive the listening sockets\n");
+			close(upgrade_fd);
+			return -1;
+		}
+		if((unsigned)count != worker_count){
+			printf("upgrade: inherited %d listener%s, running as many workers\n", count, count == 1 ? "" : "s");
+		}
+		worker_count = (unsigned)count;
+	}
+
+	struct server_worker *workers = calloc(worker_count, sizeof(struct server_worker));
+	if(!workers){
+		fprintf(stderr, "server: could not allocate %u workers\n", worker_count);
+		if(upgrade_fd >= 0){
+			for(unsigned i=0; i<worker_count; i++) close(inherited[i]);
+			close(upgrade_fd);
+		}
+		return -1;
+	}
+
+	/* A peer that resets its connection must fail the write, not kill the process. */
+	signal(SIGPIPE, SIG_IGN);
+
+	struct server_control control = { .config = config, .workers = workers, .worker_count = worker_count };
+	EXIT_ON_ERROR( open_pipe(control.cmd), 0, "pipe" );
+	EXIT_ON_ERROR( open_pipe(control.drain), 0, "pipe" );
+	const char *upgrade_name = config->upgrade_argv ? config->upgrade_argv[0] : NULL;
+	if(upgrade_name && resolve_upgrade_path(upgrade_name, control.upgrade_path, sizeof(control.upgrade_path)) < 0){
+		fprintf(stderr, "upgrade: cannot resolve %s, upgrades disabled\n", upgrade_name);
+		control.upgrade_path[0] = '\0';
+	}
+
+	for(unsigned i=0; i<worker_count; i++){
+		workers[i] = *prototype;
+		workers[i].idle_timeout_ms = config->idle_timeout_ms;
+		workers[i].limits = config->limits;
+		workers[i].limits.max_conns = limit_share(config->limits.max_conns, worker_count);
+		workers[i].limits.max_requests = limit_share(config->limits.max_requests, worker_count);
+		workers[i].nodelay = config->listener.nodelay;
+		workers[i].drain_fd = control.drain[0];
+		workers[i].server_sock = upgrade_fd >= 0 ? inherited[i] : open_listener(config, reuse_port);
+	}
+
+	if(upgrade_fd >= 0){
+		char ack = SERVER_UPGRADE_ACK;
+		LOG_ON_ERROR( write(upgrade_fd, &ack, 1), 0, "upgrade: confirm takeover");
+		LOG_ON_ERROR( close(upgrade_fd), 0, "close upgrade socket");
+	}
+
+    printf("\nlistening on port %d (%u worker%s)\n\n", config->port, worker_count, worker_count == 1 ? "" : "s");
+
+	int ret = pthread_create(&control.thread, NULL, control_main, &control);
+	bool controlled = ret == 0;
+	if(controlled) control_fd = control.cmd[1];
+	else fprintf(stderr, "server: could not start control thread: %s\n", strerror(ret));
+
+	unsigned started = 1;
+	for(unsigned i=1; i<worker_count; i++){
+		ret = pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+		if(ret != 0){
+			fprintf(stderr, "server: could not start worker %u: %s\n", i, strerror(ret));
+			LOG_ON_ERROR( close(workers[i].server_sock), 0, "close server_sock");
+			workers[i].server_sock = -1;
+			continue;
+		}
+		started++;
+	}
+
+	worker_main(&workers[0]);
+
+	for(unsigned i=1; i<worker_count; i++){
+		if(workers[i].server_sock < 0) continue;
+		pthread_join(workers[i].thread, NULL);
+	}
+
+	if(controlled){
+		control_fd = -1;
+		char quit = SERVER_CMD_QUIT;
+		LOG_ON_ERROR( write(control.cmd[1], &quit, 1), 0, "write control pipe");
+		pthread_join(control.thread, NULL);
+	}
+	for(int i=0; i<2; i++){
+		close(control.cmd[i]);
+		close(control.drain[i]);
+	}
+
+	for(unsigned i=0; i<worker_count; i++){
+		if(workers[i].server_sock < 0) continue;
+		LOG_ON_ERROR( close(workers[i].server_sock), 0, "close server_sock");
+	}
+	free(workers);
+	return started == worker_count ? 0 : -1;
+}
+
+
+int server_start(const struct server_config *config, int (*client_handler)(int fd, void* context), void *context){
+    if (!config || !client_handler){
+		fprintf(stderr, "server_start: bad arguments\n");
+		return -1;
+	}
+
+	struct server_worker prototype = {
+		.client_handler = client_handler,
+		.context 		= context
+	};
+	return run_workers(config, &prototype);
+}
+
+
+int server_start_event_loop(const struct server_config *config, const struct server_conn_handler *handler,
+                            void *context){
+    if (!config || !handler || !handler->open || !handler->on_ready || !handler->close){
+		fprintf(stderr, "server_start_event_loop: bad arguments\n");
+		return -1;
+	}
+
+	struct server_worker prototype = {
+		.conn_handler = handler,
+		.context 	  = context
+	};
+	return run_workers(config, &prototype);
+}
+
+
+int server_start_uring(const struct server_config *config, const struct server_conn_handler *handler,
+                       void *context){
+    if (!config || !handler || !handler->open || !handler->on_ready || !handler->close
+		|| !handler->on_data || !handler->pending_output || !handler->output_sent){
+		fprintf(stderr, "server_start_uring: bad arguments\n");
+		return -1;
+	}
+
+	struct server_worker prototype = {
+		.conn_handler = handler,
+		.uring 		  = true,
+		.context 	  = context
+	};
+	return run_workers(config, &prototype);
+}
+
+
+#ifdef __linux__
+
+/**
+ * @brief Translate poll(2) interest flags into epoll flags.
+ */
+static uint32_t poll_to_epoll(int events){
+	uint32_t epoll_events = 0;
+	if(events & POLLIN)  epoll_events |= EPOLLIN;
+	if(events & POLLOUT) epoll_events |= EPOLLOUT;
+	return epoll_events;
+}
+
+
+/**
+ * @brief Translate epoll readiness flags into poll(2) flags.
+ */
+static int epoll_to_poll(uint32_t epoll_events){
+	int events = 0;
+	if(epoll_events & EPOLLIN)  events |= POLLIN;
+	if(epoll_events & EPOLLOUT) events |= POLLOUT;
+	if(epoll_events & EPOLLHUP) events |= POLLHUP;
+	if(epoll_events & EPOLLERR) events |= POLLERR;
+	return events;
+}
+
+
+/**
+ * @brief State of one worker's epoll loop.
+ */
+struct event_loop {
+	int 							  epoll_fd;	/**< Readiness queue. */
+	struct admission 				  admission; /**< Limits and current load. */
+	bool 							  accepting; /**< The listener is registered. */
+	struct conn_list 				  conns;	/**< Open connections. */
+	struct timer_wheel 				  timers;	/**< Connection deadlines. */
+	const struct server_conn_handler *handler;	/**< Connection callbacks. */
+	void 							 *context;	/**< Forwarded to the callbacks. */
+	int 							  idle_timeout_ms; /**< Idle limit for handlers without deadlines. */
+};
+
+
+/**
+ * @brief Unregister, release and close one connection of the event loop.
+ */
+static void drop_conn(struct event_loop *loop, struct server_conn *conn){
+	loop->admission.conns--;
+	loop->admission.requests -= conn->requests;
+	conn_list_remove(&loop->conns, &conn->link);
+	timer_wheel_cancel(&loop->timers, &conn->timer);
+	epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+	loop->handler->close(conn->state, loop->context);
+	LOG_ON_ERROR( close(conn->fd), 0, "close client_sock");
+	free(conn);
+}
+
+
+/**
+ * @brief Apply the interest a handler callback returned and re-arm the deadline.
+ *
+ * Drops the connection if the handler is done with it.
+ */
+static void update_conn(struct event_loop *loop, struct server_conn *conn, int interest, int64_t now){
+	if(interest <= 0){
+		drop_conn(loop, conn);
+		return;
+	}
+
+	struct epoll_event ev = { .events = poll_to_epoll(interest), .data.ptr = conn };
+	if(epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev) < 0){
+		perror("epoll_ctl mod client_sock");
+		drop_conn(loop, conn);
+		return;
+	}
+	admission_track(&loop->admission, &conn->requests, loop->handler, conn->state, loop->context);
+	schedule_conn(&loop->timers, &conn->timer, loop->handler, conn->state, loop->context, loop->idle_timeout_ms, now);
+}
+
+
+/**
+ * @brief Register an accepted, non-blocking connection with the event loop.
+ */
+static void add_conn(struct event_loop *loop, int client_sock, int64_t now){
+	const struct server_conn_handler *handler = loop->handler;
+
+	struct server_conn *conn = calloc(1, sizeof(struct server_conn));
+	if(!conn){
+		close(client_sock);
+		return;
+	}
+	conn->fd = client_sock;
+	conn->state = handler->open(client_sock, loop->context);
+	if(!conn->state){
+		close(client_sock);
+		free(conn);
+		return;
+	}
+
+	struct epoll_event ev = { .events = EPOLLIN, .data.ptr = conn };
+	if(epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, client_sock, &ev) < 0){
+		perror("epoll_ctl add client_sock");
+		handler->close(conn->state, loop->context);
+		close(client_sock);
+		free(conn);
+		return;
+	}
+	loop->admission.conns++;
+	conn_list_add(&loop->conns, &conn->link);
+	admission_track(&loop->admission, &conn->requests, handler, conn->state, loop->context);
+	schedule_conn(&loop->timers, &conn->timer, handler, conn->state, loop->context, loop->idle_timeout_ms, now);
+}
+
+
+/**
+ * @brief Register or unregister the listener with the event loop.
+ */
+static void set_accepting(struct event_loop *loop, int server_sock, bool accepting){
+	if(loop->accepting == accepting) return;
+
+	struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+	int ret = epoll_ctl(loop->epoll_fd, accepting ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, server_sock, &ev);
+	LOG_ON_ERROR( ret, 0, "epoll_ctl server_sock");
+	if(ret == 0) loop->accepting = accepting;
+}
+
+
+/**
+ * @brief Accept every queued connection and register it with the event loop.
+ *
+ * Emptying the accept queue on each wake-up saves an epoll_wait() round trip
+ * per connection when clients arrive in bursts. At a limit, connections are
+ * refused with the canned response, or the listener is taken out of the loop
+ * so they stay queued in the kernel until load goes down.
+ */
+static void add_conns(struct event_loop *loop, const struct server_worker *worker, int64_t now){
+	while(1){
+		bool full = admission_full(&loop->admission);
+		if(full && !worker->limits.reject_response){
+			set_accepting(loop, worker->server_sock, false);
+			return;
+		}
+
+		int client_sock = accept_client(worker->server_sock, true, worker->nodelay);
+		if(client_sock < 0){
+			if(errno == EINTR || errno == ECONNABORTED) continue;
+			if(errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+			return;
+		}
+		if(full) reject_conn(client_sock, &worker->limits);
+		else add_conn(loop, client_sock, now);
+	}
+}
+
+
+/**
+ * @brief Stop accepting and ask every connection of the event loop to finish.
+ */
+static void drain_event_loop(struct event_loop *loop, const struct server_worker *worker, int64_t now){
+	set_accepting(loop, worker->server_sock, false);
+	epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, worker->drain_fd, NULL);
+	if(!loop->handler->drain) return;
+
+	struct conn_link *link = loop->conns.head;
+	while(link){
+		struct server_conn *conn = SERVER_CONTAINER_OF(link, struct server_conn, link);
+		link = link->next;
+		update_conn(loop, conn, loop->handler->drain(conn->state, loop->context), now);
+	}
+}
+
+
+/**
+ * @brief Event loop: multiplex all connections of @p worker with epoll.
+ *
+ * Every connection carries one timer in the loop's wheel; epoll_wait() sleeps
+ * until the nearest deadline and connections past theirs are closed.
+ *
+ * Returns once the server drains and the last connection is closed.
+ */
+static void run_event_loop(struct server_worker *worker){
+	int server_sock = worker->server_sock;
+
+	EXIT_ON_ERROR( set_nonblocking(server_sock), 0, "fcntl server_sock" );
+
+	struct event_loop state = {
+		.admission 		 = { .limits = worker->limits },
+		.handler 		 = worker->conn_handler,
+		.context 		 = worker->context,
+		.idle_timeout_ms = worker->idle_timeout_ms
+	};
+	struct event_loop *loop = &state;
+	timer_wheel_init(&loop->timers, SERVER_TIMER_TICK_MS, timer_now_ms());
+
+	loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	EXIT_ON_ERROR( loop->epoll_fd, 0, "epoll_create1" );
+
+	struct epoll_event listen_ev = { .events = EPOLLIN, .data.ptr = NULL };
+	EXIT_ON_ERROR( epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, server_sock, &listen_ev), 0, "epoll_ctl add server_sock" );
+	loop->accepting = true;
+
+	/* The worker itself marks the drain pipe; it can never be a connection. */
+	struct epoll_event drain_ev = { .events = EPOLLIN, .data.ptr = worker };
+	EXIT_ON_ERROR( epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, worker->drain_fd, &drain_ev), 0, "epoll_ctl add drain_fd" );
+
+	struct epoll_event events[SERVER_MAX_EVENTS];
+	bool draining = false;
+
+	while(!draining || loop->conns.head){
+		int ready = epoll_wait(loop->epoll_fd, events, SERVER_MAX_EVENTS, timer_wheel_wait_ms(&loop->timers, timer_now_ms()));
+		if(ready < 0){
+			if(errno == EINTR) continue;
+			perror("epoll_wait");
+			break;
+		}
+
+		int64_t now = timer_now_ms();
+		bool drain_requested = false;
+		for(int i=0; i<ready; i++){
+			struct server_conn *conn = events[i].data.ptr;
+			if(!conn){
+				add_conns(loop, worker, now);
+				continue;
+			}
+			if(events[i].data.ptr == worker){
+				drain_requested = true;
+				continue;
+			}
+
+			int interest = loop->handler->on_ready(conn->state, epoll_to_poll(events[i].events), loop->context);
+			update_conn(loop, conn, interest, now);
+		}
+
+		/* After the batch: draining may free connections that still had events in it. */
+		if(drain_requested && !draining){
+			draining = true;
+			drain_event_loop(loop, worker, now);
+		}
+
+		struct timer_node *expired;
+		while((expired = timer_wheel_expired(&loop->timers, now))){
+			drop_conn(loop, SERVER_CONTAINER_OF(expired, struct server_conn, timer));
+		}
+
+		/* Resume a paused listener once load went down. */
+		if(!draining && !loop->accepting && !admission_full(&loop->admission)){
+			set_accepting(loop, server_sock, true);
+		}
+	}
+
+	LOG_ON_ERROR( close(loop->epoll_fd), 0, "close epoll_fd");
+}
+
+
+/**
+ * @brief Kind of operation encoded in the low bits of an SQE's user_data.
+ *
+ * Connection objects are at least 8-byte aligned, so the pointer and the tag
+ * share one 64-bit value.
+ */
+enum uring_op {
+	URING_OP_ACCEPT = 0,	/**< Multishot accept on the listener (no connection). */
+	URING_OP_RECV   = 1,	/**< Multishot recv of a connection. */
+	URING_OP_SEND   = 2,	/**< One send of a linked chain. */
+	URING_OP_CANCEL = 3,	/**< Cancellation request (completion ignored). */
+	URING_OP_TIMEOUT = 4,	/**< Wake-up for the next connection deadline (no connection). */
+	URING_OP_DRAIN  = 5		/**< Poll on the drain pipe (no connection). */
+};
+
+#define URING_OP_MASK 7ULL
+
+
+/**
+ * @brief Per-connection bookkeeping of the io_uring loop.
+ *
+ * The object must outlive every operation that references it, so it is only
+ * freed once the recv is disarmed and no send is in flight.
+ */
+struct uring_conn {
+	struct conn_link  link;	/**< Membership in the loop's connection list. */
+	struct timer_node timer; /**< Deadline in the loop's timer wheel. */
+	int 	  fd;			/**< Client socket (owned by the loop). */
+	void 	 *state;		/**< State returned by @ref server_conn_handler::open. */
+	int 	  interest;		/**< Last interest reported by the handler. */
+	unsigned  requests;		/**< Requests in flight as last reported by the handler. */
+	unsigned  sends;		/**< Sends still in flight. */
+	bool 	  recv_armed;	/**< A multishot recv is pending. */
+	bool 	  recv_cancelling; /**< Cancellation of the recv was requested. */
+	bool 	  closing;		/**< Handler is done; waiting for operations to drain. */
+};
+
+
+/**
+ * @brief State of one worker's io_uring loop.
+ */
+struct uring_loop {
+	struct uring 					  ring;		/**< Submission/completion queues. */
+	struct uring_buf_ring 			  bufs;		/**< Provided receive buffers. */
+	int 							  server_sock; /**< Listening socket. */
+	int 							  drain_fd;	/**< Becomes readable once the server drains. */
+	bool 							  nodelay;	/**< Set TCP_NODELAY on accepted connections. */
+	const struct server_conn_handler *handler;	/**< Connection callbacks. */
+	void 							 *context;	/**< Forwarded to the callbacks. */
+	int 							  idle_timeout_ms; /**< Idle limit for handlers without deadlines. */
+	struct conn_list 				  list;		/**< Connections still being served. */
+	struct timer_wheel 				  timers;	/**< Deadlines of the served connections. */
+	int64_t 						  now;		/**< Time of the current completion batch. */
+	struct __kernel_timespec 		  timeout;	/**< Relative expiry of the timeout being queued. */
+	int64_t 						  timeout_at; /**< Earliest pending timeout, -1 if none is known. */
+	struct admission 				  admission; /**< Limits and current load. */
+	bool 							  accept_armed; /**< The multishot accept is pending. */
+	bool 							  accept_cancelling; /**< Cancellation of the accept was requested. */
+	bool 							  draining;	/**< Accepting stopped; ends once no connection is left. */
+};
+
+
+static uint64_t uring_tag(struct uring_conn *conn, enum uring_op op){
+	return (uint64_t)(uintptr_t)conn | (uint64_t)op;
+}
+
+
+/**
+ * @brief Queue the multishot accept on the listener.
+ *
+ * @return 0 on success, -1 if no SQE was available.
+ */
+static int uring_arm_accept(struct uring_loop *loop){
+	struct io_uring_sqe *sqe = uring_get_sqe(&loop->ring);
+	if(!sqe) return -1;
+	sqe->opcode = IORING_OP_ACCEPT;
+	sqe->fd = loop->server_sock;
+	sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+	sqe->accept_flags = SOCK_CLOEXEC;
+	sqe->user_data = uring_tag(NULL, URING_OP_ACCEPT);
+	loop->accept_armed = true;
+	loop->accept_cancelling = false;
+	return 0;
+}
+
+
+/**
+ * @brief Ask the kernel to stop the multishot accept.
+ *
+ * The accept stays armed until its final completion arrives.
+ *
+ * @return 0 on success (or nothing to cancel), -1 if no SQE was available.
+ */
+static int uring_cancel_accept(struct uring_loop *loop){
+	if(!loop->accept_armed || loop->accept_cancelling) return 0;
+
+	struct io_uring_sqe *sqe = uring_get_sqe(&loop->ring);
+	if(!sqe) return -1;
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = uring_tag(NULL, URING_OP_ACCEPT);
+	sqe->user_data = uring_tag(NULL, URING_OP_CANCEL);
+	loop->accept_cancelling = true;
+	return 0;
+}
+
+
+/**
+ * @brief Queue a poll that completes once the server drains.
+ *
+ * @return 0 on success, -1 if no SQE was available.
+ */
+static int uring_arm_drain(struct uring_loop *loop){
+	struct io_uring_sqe *sqe = uring_get_sqe(&loop->ring);
+	if(!sqe) return -1;
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = loop->drain_fd;
+	sqe->poll32_events = POLLIN;
+	sqe->user_data = uring_tag(NULL, URING_OP_DRAIN);
+	return 0;
+}
+
+
+/**
+ * @brief Queue a multishot recv that picks buffers from the provided-buffer ring.
+ *
+ * @return 0 on success, -1 if no SQE was available.
+ */
+static int uring_arm_recv(struct uring_loop *loop, struct uring_conn *conn){
+	struct io_uring_sqe *sqe = uring_get_sqe(&loop->ring);
+	if(!sqe) return -1;
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = conn->fd;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = loop->bufs.bgid;
+	sqe->user_data = uring_tag(conn, URING_OP_RECV);
+	conn->recv_armed = true;
+	conn->recv_cancelling = false;
+	return 0;
+}
+
+
+/**
+ * @brief Ask the kernel to stop the connection's multishot recv.
+ *
+ * The recv stays armed until its final completion arrives.
+ *
+ * @return 0 on success (or nothing to cancel), -1 if no SQE was available.
+ */
+static int uring_cancel_recv(struct uring_loop *loop, struct uring_conn *conn){
+	if(!conn->recv_armed || conn->recv_cancelling) return 0;
+
+	struct io_uring_sqe *sqe = uring_get_sqe(&loop->ring);
+	if(!sqe) return -1;
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = uring_tag(conn, URING_OP_RECV);
+	sqe->user_data = uring_tag(NULL, URING_OP_CANCEL);
+	conn->recv_cancelling = true;
+	return 0;
+}
+
+
+/**
+ * @brief Queue the connection's pending output as a chain of linked sends.
+ *
+ * MSG_WAITALL makes the kernel finish each segment before the next one in
+ * the chain starts; if a segment still comes up short, the rest of the chain
+ * is cancelled and resubmitted from the handler's updated output.
+ *
+ * @return 0 on success (also if nothing is pending), -1 if no SQE was available.
+ */
+static int uring_submit_sends(struct uring_loop *loop, struct uring_conn *conn){
+	struct iovec iov[SERVER_URING_MAX_SEGMENTS];
+	int count = loop->handler->pending_output(conn->state, iov, SERVER_URING_MAX_SEGMENTS, loop->context);
+
+	for(int i=0; i<count; i++){
+		struct io_uring_sqe *sqe = uring_get_sqe(&loop->ring);
+		if(!sqe){
+			if(i > 0) break;
+			return -1;
+		}
+		sqe->opcode = IORING_OP_SEND;
+		sqe->fd = conn->fd;
+		sqe->addr = (uint64_t)(uintptr_t)iov[i].iov_base;
+		sqe->len = (uint32_t)iov[i].iov_len;
+		sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+		if(i + 1 < count) sqe->flags = IOSQE_IO_LINK;
+		sqe->user_data = uring_tag(conn, URING_OP_SEND);
+		conn->sends++;
+	}
+	return 0;
+}
+
+
+/**
+ * @brief Arm a timeout that wakes the loop when the nearest connection deadline comes up.
+ *
+ * Deadlines can move closer (a kept-alive connection's limit is shorter than
+ * a head's), so another timeout is queued whenever the pending one would be late.
+ */
+static void uring_arm_timeout(struct uring_loop *loop){
+	int wait_ms = timer_wheel_wait_ms(&loop->timers, loop->now);
+	if(wait_ms < 0) return;
+	if(loop->timeout_at >= 0 && loop->timeout_at <= loop->now + wait_ms) return;
+
+	struct io_uring_sqe *sqe = uring_get_sqe(&loop->ring);
+	if(!sqe) return;
+	loop->timeout.tv_sec = wait_ms / 1000;
+	loop->timeout.tv_nsec = (long long)(wait_ms % 1000) * 1000000;
+	sqe->opcode = IORING_OP_TIMEOUT;
+	sqe->fd = -1;
+	sqe->addr = (uint64_t)(uintptr_t)&loop->timeout;
+	sqe->len = 1;
+	sqe->user_data = uring_tag(NULL, URING_OP_TIMEOUT);
+	loop->timeout_at = loop->now + wait_ms;
+}
+
+
+/**
+ * @brief Free a closing connection once no operation references it anymore.
+ */
+static void uring_release(struct uring_loop *loop, struct uring_conn *conn){
+	if(!conn->closing || conn->recv_armed || conn->sends > 0) return;
+	loop->handler->close(conn->state, loop->context);
+	LOG_ON_ERROR( close(conn->fd), 0, "close client_sock");
+	free(conn);
+	loop->admission.conns--;
+}
+
+
+/**
+ * @brief Stop serving a connection: cancel its recv so it can be released once drained.
+ *
+ * Does not free the connection; callers finish with @ref uring_release.
+ */
+static void uring_close_conn(struct uring_loop *loop, struct uring_conn *conn){
+	if(conn->closing) return;
+	conn->closing = true;
+	loop->admission.requests -= conn->requests;
+	conn->requests = 0;
+	conn_list_remove(&loop->list, &conn->link);
+	timer_wheel_cancel(&loop->timers, &conn->timer);
+
+	/* Aborts sends to a peer that stopped reading (expired deadline). */
+	if(conn->sends > 0) shutdown(conn->fd, SHUT_RDWR);
+
+	if(uring_cancel_recv(loop, conn) < 0) shutdown(conn->fd, SHUT_RDWR);
+}
+
+
+/**
+ * @brief Refresh the in-flight count and deadline of a connection after a call into its handler.
+ */
+static void uring_schedule(struct uring_loop *loop, struct uring_conn *conn){
+	if(conn->closing) return;
+	admission_track(&loop->admission, &conn->requests, loop->handler, conn->state, loop->context);
+	schedule_conn(&loop->timers, &conn->timer, loop->handler, conn->state, loop->context, loop->idle_timeout_ms, loop->now);
+}
+
+
+/**
+ * @brief Act on the interest returned by a handler callback.
+ *
+ * Without POLLIN the recv is cancelled, so a connection whose output queue is
+ * full stops consuming buffers and TCP flow control throttles the client;
+ * it is re-armed once the handler asks for input again.
+ */
+static void uring_apply_interest(struct uring_loop *loop, struct uring_conn *conn, int interest){
+	conn->interest = interest;
+	if(interest <= 0){
+		uring_close_conn(loop, conn);
+		return;
+	}
+	if((interest & POLLOUT) && conn->sends == 0){
+		if(uring_submit_sends(loop, conn) < 0){
+			uring_close_conn(loop, conn);
+			return;
+		}
+	}
+
+	int ret = 0;
+	if(!(interest & POLLIN)) ret = uring_cancel_recv(loop, conn);
+	else if(!conn->recv_armed) ret = uring_arm_recv(loop, conn);
+	if(ret < 0) uring_close_conn(loop, conn);
+	uring_schedule(loop, conn);
+}
+
+
+/**
+ * @brief Handle a completion of the multishot accept.
+ *
+ * The accept is re-armed after the batch by @ref uring_update_accept.
+ */
+static void uring_on_accept(struct uring_loop *loop, int res, unsigned flags){
+	if(!(flags & IORING_CQE_F_MORE)){
+		loop->accept_armed = false;
+		loop->accept_cancelling = false;
+	}
+	if(res < 0) return;
+
+	int client_sock = res;
+	if(admission_full(&loop->admission) && loop->admission.limits.reject_response){
+		reject_conn(client_sock, &loop->admission.limits);
+		return;
+	}
+	if(loop->nodelay) LOG_ON_ERROR( set_nodelay(client_sock), 0, "TCP_NODELAY" );
+	log_peer(client_sock, ACCESS_LOG_ACCEPT, ACCESS_LOG_DEBUG);
+
+	struct uring_conn *conn = calloc(1, sizeof(struct uring_conn));
+	if(!conn){
+		close(client_sock);
+		return;
+	}
+	conn->fd = client_sock;
+	conn->state = loop->handler->open(client_sock, loop->context);
+	if(!conn->state){
+		close(client_sock);
+		free(conn);
+		return;
+	}
+	conn->interest = POLLIN;
+	loop->admission.conns++;
+
+	if(uring_arm_recv(loop, conn) < 0){
+		conn->closing = true;
+		uring_release(loop, conn);
+		return;
+	}
+	conn_list_add(&loop->list, &conn->link);
+	uring_schedule(loop, conn);
+
+	/* Accepted just before the accept was cancelled. */
+	if(loop->draining && loop->handler->drain){
+		uring_apply_interest(loop, conn, loop->handler->drain(conn->state, loop->context));
+		uring_release(loop, conn);
+	}
+}
+
+
+/**
+ * @brief Handle a completion of a connection's multishot recv.
+ */
+static void uring_on_recv(struct uring_loop *loop, struct uring_conn *conn, int res, unsigned flags){
+	bool more = flags & IORING_CQE_F_MORE;
+	if(!more){
+		conn->recv_armed = false;
+		conn->recv_cancelling = false;
+	}
+	if(flags & IORING_CQE_F_BUFFER){
+		uint16_t bid = (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+		if(res > 0 && !conn->closing){
+			int interest = loop->handler->on_data(conn->state, uring_buf_ring_get(&loop->bufs, bid),
+												  (size_t)res, loop->context);
+			uring_buf_ring_recycle(&loop->bufs, bid);
+			uring_apply_interest(loop, conn, interest);
+		}else{
+			uring_buf_ring_recycle(&loop->bufs, bid);
+		}
+	}else if(res == 0 && !conn->closing){
+		uring_apply_interest(loop, conn, loop->handler->on_data(conn->state, NULL, 0, loop->context));
+	}else if(res < 0 && res != -ENOBUFS && res != -ECANCELED){
+		uring_close_conn(loop, conn);
+	}
+
+	/* Multishot recv also stops when buffers run out or after a pause; keep receiving if wanted. */
+	if(!conn->closing && !conn->recv_armed && res != 0 && (conn->interest & POLLIN)){
+		if(uring_arm_recv(loop, conn) < 0) uring_close_conn(loop, conn);
+	}
+	uring_release(loop, conn);
+}
+
+
+/**
+ * @brief Handle a completion of one linked send.
+ */
+static void uring_on_send(struct uring_loop *loop, struct uring_conn *conn, int res){
+	conn->sends--;
+
+	if(!conn->closing){
+		if(res > 0){
+			conn->interest = loop->handler->output_sent(conn->state, (size_t)res, loop->context);
+		}else if(res != -ECANCELED){
+			conn->interest = 0;
+		}
+		if(conn->sends == 0) uring_apply_interest(loop, conn, conn->interest);
+		else uring_schedule(loop, conn);
+	}
+	uring_release(loop, conn);
+}
+
+
+/**
+ * @brief Pause or resume the multishot accept according to the limits.
+ *
+ * Connections accepted while the cancellation is on its way are still served.
+ */
+static void uring_update_accept(struct uring_loop *loop){
+	if(loop->draining) return;
+
+	if(admission_full(&loop->admission) && !loop->admission.limits.reject_response){
+		if(uring_cancel_accept(loop) < 0) fprintf(stderr, "io_uring: could not pause accept\n");
+	}else if(!loop->accept_armed){
+		if(uring_arm_accept(loop) < 0) fprintf(stderr, "io_uring: could not re-arm accept\n");
+	}
+}
+
+
+/**
+ * @brief Stop accepting and ask every connection of the io_uring loop to finish.
+ */
+static void uring_drain(struct uring_loop *loop){
+	loop->draining = true;
+	uring_cancel_accept(loop);
+	if(!loop->handler->drain) return;
+
+	struct conn_link *link = loop->list.head;
+	while(link){
+		struct uring_conn *conn = SERVER_CONTAINER_OF(link, struct uring_conn, link);
+		link = link->next;
+		uring_apply_interest(loop, conn, loop->handler->drain(conn->state, loop->context));
+		uring_release(loop, conn);
+	}
+}
+
+
+/**
+ * @brief io_uring loop: drive all connections of @p worker through completions.
+ *
+ * Returns once the server drains and the last connection is released.
+ *
+ * @return 0 when the loop ends, -1 if io_uring could not be set up (nothing
+ *         was consumed from the listener, so the caller can fall back).
+ */
+static int run_uring_loop(struct server_worker *worker){
+	struct uring_loop loop = {
+		.server_sock = worker->server_sock,
+		.drain_fd 	 = worker->drain_fd,
+		.nodelay 	 = worker->nodelay,
+		.handler 	 = worker->conn_handler,
+		.context 	 = worker->context,
+		.idle_timeout_ms = worker->idle_timeout_ms,
+		.admission 	 = { .limits = worker->limits },
+		.now 		 = timer_now_ms(),
+		.timeout_at  = -1
+	};
+	timer_wheel_init(&loop.timers, SERVER_TIMER_TICK_MS, loop.now);
+
+	if(uring_init(&loop.ring, SERVER_URING_ENTRIES) < 0){
+		fprintf(stderr, "io_uring unavailable (%s), using epoll\n", strerror(errno));
+		return -1;
+	}
+	if(uring_buf_ring_init(&loop.ring, &loop.bufs, 0, SERVER_URING_BUFFERS, SERVER_URING_BUFFER_SIZE) < 0){
+		fprintf(stderr, "io_uring buffer ring unavailable (%s), using epoll\n", strerror(errno));
+		uring_exit(&loop.ring);
+		return -1;
+	}
+	if(uring_arm_accept(&loop) < 0 || uring_arm_drain(&loop) < 0){
+		uring_buf_ring_free(&loop.ring, &loop.bufs);
+		uring_exit(&loop.ring);
+		return -1;
+	}
+
+	while(!loop.draining || loop.admission.conns > 0){
+		if(uring_submit_and_wait(&loop.ring, 1) < 0){
+			perror("io_uring_enter");
+			break;
+		}
+		loop.now = timer_now_ms();
+
+		struct io_uring_cqe *cqe;
+		while((cqe = uring_peek_cqe(&loop.ring))){
+			uint64_t user_data = cqe->user_data;
+			int res = cqe->res;
+			unsigned flags = cqe->flags;
+			uring_cqe_seen(&loop.ring);
+
+			struct uring_conn *conn = (struct uring_conn*)(uintptr_t)(user_data & ~URING_OP_MASK);
+			switch((enum uring_op)(user_data & URING_OP_MASK)){
+				case URING_OP_ACCEPT: uring_on_accept(&loop, res, flags); 		break;
+				case URING_OP_RECV:   uring_on_recv(&loop, conn, res, flags); 	break;
+				case URING_OP_SEND:   uring_on_send(&loop, conn, res); 			break;
+				case URING_OP_CANCEL: 											break;
+				case URING_OP_TIMEOUT: loop.timeout_at = -1; 					break;
+				case URING_OP_DRAIN:  if(!loop.draining) uring_drain(&loop); 	break;
+			}
+		}
+
+		struct timer_node *expired;
+		while((expired = timer_wheel_expired(&loop.timers, loop.now))){
+			struct uring_conn *conn = SERVER_CONTAINER_OF(expired, struct uring_conn, timer);
+			uring_close_conn(&loop, conn);
+			uring_release(&loop, conn);
+		}
+		uring_update_accept(&loop);
+		uring_arm_timeout(&loop);
+	}
+
+	uring_buf_ring_free(&loop.ring, &loop.bufs);
+	uring_exit(&loop.ring);
+	return 0;
+}
+
+#else
+
+/**
+ * @brief Fallback without epoll: drive one connection at a time with poll(2).
+ */
+static void run_event_loop(struct server_worker *worker){
+	const struct server_conn_handler *handler = worker->conn_handler;
+	void *context = worker->context;
+
+	EXIT_ON_ERROR( set_nonblocking(worker->server_sock), 0, "fcntl server_sock" );
+
+	while(wait_for_client(worker)){
+		int client_sock = accept_client(worker->server_sock, true, worker->nodelay);
+		if(client_sock < 0) continue;
+
+		void *state = handler->open(client_sock, context);
+
+		int interest = state ? POLLIN : 0;
+		while(interest > 0){
+			int64_t now = timer_now_ms();
+			int64_t deadline = -1;
+			if(handler->deadline) deadline = handler->deadline(state, context);
+			else if(worker->idle_timeout_ms > 0) deadline = now + worker->idle_timeout_ms;
+			if(deadline >= 0 && deadline <= now) break;
+
+			struct pollfd pfd = { .fd = client_sock, .events = (short)interest };
+			int ready = poll(&pfd, 1, deadline < 0 ? -1 : (int)(deadline - now));
+			if(ready < 0){
+				if(errno == EINTR) continue;
+				break;
+			}
+			if(ready == 0) break;
+			interest = handler->on_ready(state, pfd.revents, context);
+		}
+
+		if(state) handler->close(state, context);
+		LOG_ON_ERROR( close(client_sock), 0, "close client_sock");
+	}
+}
+
+
+/**
+ * @brief io_uring is Linux-only; always fall back to the event loop.
+ */
+static int run_uring_loop(struct server_worker *worker){
+	(void)worker;
+	return -1;
+}
+
+#endif
+
+
 void server_stop(void){
+	send_command(SERVER_CMD_STOP);
+}
+
 
+void server_upgrade(void){
+	send_command(SERVER_CMD_UPGRADE);
 }
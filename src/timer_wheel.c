@@ -0,0 +1,102 @@
+#include <string.h>
+#include <time.h>
+#include "../include/timer_wheel.h"
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_WORDS (TIMER_WHEEL_SLOTS / 64)
+
+
+int64_t timer_now_ms(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+void timer_wheel_init(struct timer_wheel *wheel, unsigned tick_ms, int64_t now_ms){
+	memset(wheel, 0, sizeof(*wheel));
+	wheel->tick_ms = tick_ms > 0 ? tick_ms : 1;
+	wheel->current = now_ms / wheel->tick_ms;
+}
+
+
+void timer_wheel_cancel(struct timer_wheel *wheel, struct timer_node *node){
+	if(!node->linked) return;
+
+	size_t slot = (size_t)(node->expires & TIMER_WHEEL_MASK);
+	if(node->prev) node->prev->next = node->next;
+	else wheel->slots[slot] = node->next;
+	if(node->next) node->next->prev = node->prev;
+	if(!wheel->slots[slot]) wheel->used[slot / 64] &= ~(1ULL << (slot % 64));
+
+	node->prev = node->next = NULL;
+	node->linked = false;
+	wheel->count--;
+}
+
+
+void timer_wheel_schedule(struct timer_wheel *wheel, struct timer_node *node, int64_t deadline_ms){
+	timer_wheel_cancel(wheel, node);
+
+	/* Round up so a timer never fires before its deadline. */
+	int64_t tick = (deadline_ms + wheel->tick_ms - 1) / wheel->tick_ms;
+	if(tick < wheel->current) tick = wheel->current;
+
+	size_t slot = (size_t)(tick & TIMER_WHEEL_MASK);
+	node->expires = tick;
+	node->prev = NULL;
+	node->next = wheel->slots[slot];
+	if(node->next) node->next->prev = node;
+	wheel->slots[slot] = node;
+	wheel->used[slot / 64] |= 1ULL << (slot % 64);
+	node->linked = true;
+	wheel->count++;
+}
+
+
+struct timer_node *timer_wheel_expired(struct timer_wheel *wheel, int64_t now_ms){
+	int64_t now_tick = now_ms / wheel->tick_ms;
+
+	while(wheel->current <= now_tick){
+		if(wheel->count == 0){
+			wheel->current = now_tick + 1;
+			break;
+		}
+
+		/* Timers of later revolutions share the slot but have a larger tick. */
+		struct timer_node *node = wheel->slots[wheel->current & TIMER_WHEEL_MASK];
+		while(node && node->expires != wheel->current) node = node->next;
+		if(node){
+			timer_wheel_cancel(wheel, node);
+			return node;
+		}
+		wheel->current++;
+	}
+	return NULL;
+}
+
+
+int timer_wheel_wait_ms(const struct timer_wheel *wheel, int64_t now_ms){
+	if(wheel->count == 0) return -1;
+
+	size_t start = (size_t)(wheel->current & TIMER_WHEEL_MASK);
+	size_t distance = TIMER_WHEEL_SLOTS;
+
+	/* Scan the bitmap from the current slot, wrapping around once. */
+	for(size_t i=0; i<=TIMER_WHEEL_WORDS; i++){
+		size_t word = (start / 64 + i) % TIMER_WHEEL_WORDS;
+		uint64_t bits = wheel->used[word];
+		if(i == 0) bits &= ~0ULL << (start % 64);
+		else if(i == TIMER_WHEEL_WORDS) bits &= (1ULL << (start % 64)) - 1;
+		if(!bits) continue;
+
+		size_t slot = word * 64 + (size_t)__builtin_ctzll(bits);
+		distance = (slot - start) & TIMER_WHEEL_MASK;
+		break;
+	}
+	if(distance == TIMER_WHEEL_SLOTS) return -1;
+
+	int64_t due = (wheel->current + (int64_t)distance) * wheel->tick_ms - now_ms;
+	if(due <= 0) return 0;
+	return due > 0x7fffffff ? 0x7fffffff : (int)due;
+}
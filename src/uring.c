@@ -0,0 +1,277 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/uring.h"
+
+#ifdef __linux__
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *params){
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags){
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args){
+	return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+
+int uring_init(struct uring *ring, unsigned entries){
+	if(!ring){ errno = EINVAL; return -1; }
+	memset(ring, 0, sizeof(*ring));
+	ring->fd = -1;
+
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	int fd = sys_io_uring_setup(entries, &params);
+	if(fd < 0) return -1;
+	ring->fd = fd;
+
+	ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+	if(single_mmap){
+		if(ring->cq_ring_size > ring->sq_ring_size) ring->sq_ring_size = ring->cq_ring_size;
+		ring->cq_ring_size = ring->sq_ring_size;
+	}
+
+	ring->sq_ring_ptr = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+							 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if(ring->sq_ring_ptr == MAP_FAILED){
+		ring->sq_ring_ptr = NULL;
+		goto fail;
+	}
+
+	if(single_mmap){
+		ring->cq_ring_ptr = ring->sq_ring_ptr;
+	}else{
+		ring->cq_ring_ptr = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+								 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if(ring->cq_ring_ptr == MAP_FAILED){
+			ring->cq_ring_ptr = NULL;
+			goto fail;
+		}
+	}
+
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+					  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if(ring->sqes == MAP_FAILED){
+		ring->sqes = NULL;
+		goto fail;
+	}
+
+	char *sq = ring->sq_ring_ptr;
+	ring->sq_head  = (unsigned*)(sq + params.sq_off.head);
+	ring->sq_tail  = (unsigned*)(sq + params.sq_off.tail);
+	ring->sq_mask  = (unsigned*)(sq + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+	ring->sq_entries = params.sq_entries;
+	ring->sqe_tail = *ring->sq_tail;
+
+	char *cq = ring->cq_ring_ptr;
+	ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+	ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+	ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+	ring->cqes    = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+	return 0;
+
+fail:
+	{
+		int saved = errno;
+		uring_exit(ring);
+		errno = saved;
+	}
+	return -1;
+}
+
+
+void uring_exit(struct uring *ring){
+	if(!ring) return;
+	if(ring->sqes) munmap(ring->sqes, ring->sqes_size);
+	if(ring->cq_ring_ptr && ring->cq_ring_ptr != ring->sq_ring_ptr) munmap(ring->cq_ring_ptr, ring->cq_ring_size);
+	if(ring->sq_ring_ptr) munmap(ring->sq_ring_ptr, ring->sq_ring_size);
+	if(ring->fd >= 0) close(ring->fd);
+	memset(ring, 0, sizeof(*ring));
+	ring->fd = -1;
+}
+
+
+/**
+ * @brief Publish locally prepared SQEs to the kernel.
+ *
+ * @return Number of SQEs not yet seen by the kernel.
+ */
+static unsigned publish_sqes(struct uring *ring){
+	__atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+	return ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+}
+
+
+struct io_uring_sqe *uring_get_sqe(struct uring *ring){
+	unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+	if(ring->sqe_tail - head >= ring->sq_entries){
+		if(uring_submit_and_wait(ring, 0) < 0) return NULL;
+		head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+		if(ring->sqe_tail - head >= ring->sq_entries) return NULL;
+	}
+
+	unsigned idx = ring->sqe_tail & *ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	ring->sq_array[idx] = idx;
+	ring->sqe_tail++;
+	return sqe;
+}
+
+
+int uring_submit_and_wait(struct uring *ring, unsigned wait_nr){
+	unsigned to_submit = publish_sqes(ring);
+	unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+	if(to_submit == 0 && wait_nr == 0) return 0;
+
+	while(1){
+		int ret = sys_io_uring_enter(ring->fd, to_submit, wait_nr, flags);
+		if(ret < 0 && errno == EINTR) continue;
+		return ret;
+	}
+}
+
+
+struct io_uring_cqe *uring_peek_cqe(struct uring *ring){
+	unsigned head = *ring->cq_head;
+	unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+	if(head == tail) return NULL;
+	return &ring->cqes[head & *ring->cq_mask];
+}
+
+
+void uring_cqe_seen(struct uring *ring){
+	__atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+
+int uring_buf_ring_init(struct uring *ring, struct uring_buf_ring *bufs, uint16_t bgid,
+						unsigned entries, unsigned buf_size){
+	if(!ring || !bufs || entries == 0 || (entries & (entries - 1)) || entries > 32768 || buf_size == 0){
+		errno = EINVAL;
+		return -1;
+	}
+	memset(bufs, 0, sizeof(*bufs));
+
+	bufs->ring_size = entries * sizeof(struct io_uring_buf);
+	void *mapped = mmap(NULL, bufs->ring_size, PROT_READ | PROT_WRITE,
+						MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if(mapped == MAP_FAILED) return -1;
+	bufs->ring = mapped;
+
+	bufs->buffers = malloc((size_t)entries * buf_size);
+	if(!bufs->buffers){
+		munmap(mapped, bufs->ring_size);
+		bufs->ring = NULL;
+		errno = ENOMEM;
+		return -1;
+	}
+	bufs->entries = entries;
+	bufs->buf_size = buf_size;
+	bufs->bgid = bgid;
+
+	struct io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (uint64_t)(uintptr_t)bufs->ring;
+	reg.ring_entries = entries;
+	reg.bgid = bgid;
+	if(sys_io_uring_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0){
+		int saved = errno;
+		free(bufs->buffers);
+		munmap(bufs->ring, bufs->ring_size);
+		memset(bufs, 0, sizeof(*bufs));
+		errno = saved;
+		return -1;
+	}
+
+	for(unsigned i=0; i<entries; i++){
+		uring_buf_ring_recycle(bufs, (uint16_t)i);
+	}
+	return 0;
+}
+
+
+void *uring_buf_ring_get(struct uring_buf_ring *bufs, uint16_t bid){
+	return bufs->buffers + (size_t)bid * bufs->buf_size;
+}
+
+
+void uring_buf_ring_recycle(struct uring_buf_ring *bufs, uint16_t bid){
+	struct io_uring_buf *buf = &bufs->ring->bufs[bufs->tail & (bufs->entries - 1)];
+	buf->addr = (uint64_t)(uintptr_t)uring_buf_ring_get(bufs, bid);
+	buf->len = bufs->buf_size;
+	buf->bid = bid;
+	bufs->tail++;
+	__atomic_store_n(&bufs->ring->tail, bufs->tail, __ATOMIC_RELEASE);
+}
+
+
+void uring_buf_ring_free(struct uring *ring, struct uring_buf_ring *bufs){
+	if(!bufs || !bufs->ring) return;
+	if(ring && ring->fd >= 0){
+		struct io_uring_buf_reg reg;
+		memset(&reg, 0, sizeof(reg));
+		reg.bgid = bufs->bgid;
+		sys_io_uring_register(ring->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+	}
+	free(bufs->buffers);
+	munmap(bufs->ring, bufs->ring_size);
+	memset(bufs, 0, sizeof(*bufs));
+}
+
+#else
+
+int uring_init(struct uring *ring, unsigned entries){
+	(void)entries;
+	if(ring){
+		memset(ring, 0, sizeof(*ring));
+		ring->fd = -1;
+	}
+	errno = ENOSYS;
+	return -1;
+}
+
+void uring_exit(struct uring *ring){ (void)ring; }
+
+struct io_uring_sqe *uring_get_sqe(struct uring *ring){ (void)ring; return NULL; }
+
+int uring_submit_and_wait(struct uring *ring, unsigned wait_nr){
+	(void)ring; (void)wait_nr;
+	errno = ENOSYS;
+	return -1;
+}
+
+struct io_uring_cqe *uring_peek_cqe(struct uring *ring){ (void)ring; return NULL; }
+
+void uring_cqe_seen(struct uring *ring){ (void)ring; }
+
+int uring_buf_ring_init(struct uring *ring, struct uring_buf_ring *bufs, uint16_t bgid,
+						unsigned entries, unsigned buf_size){
+	(void)ring; (void)bufs; (void)bgid; (void)entries; (void)buf_size;
+	errno = ENOSYS;
+	return -1;
+}
+
+void *uring_buf_ring_get(struct uring_buf_ring *bufs, uint16_t bid){ (void)bufs; (void)bid; return NULL; }
+
+void uring_buf_ring_recycle(struct uring_buf_ring *bufs, uint16_t bid){ (void)bufs; (void)bid; }
+
+void uring_buf_ring_free(struct uring *ring, struct uring_buf_ring *bufs){ (void)ring; (void)bufs; }
+
+#endif